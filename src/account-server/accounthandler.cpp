@@ -1069,6 +1069,7 @@ void AccountHandler::processMessage(NetComputer *comp, MessageIn &message)
                      << message.getId());
             MessageOut result(XXMSG_INVALID);
             client.send(result);
+            rejectMessage();
             break;
     }
 }
@@ -101,6 +101,13 @@ void CharacterData::serialize(MessageOut &msg)
         msg.writeString(quest.description);
     }
 
+    // quest variables
+    msg.writeInt16(mQuestVars.size());
+    for (auto &questVar : mQuestVars) {
+        msg.writeString(questVar.first);
+        msg.writeString(questVar.second);
+    }
+
     // inventory - must be last because size isn't transmitted
     const Possessions &poss = getPossessions();
     const EquipData &equipData = poss.getEquipment();
@@ -188,6 +195,14 @@ void CharacterData::deserialize(MessageIn &msg)
         mQuests.push_back(quest);
     }
 
+    // quest variables
+    int questVarsSize = msg.readInt16();
+    mQuestVars.clear();
+    for (int i = 0; i < questVarsSize; ++i) {
+        std::string name = msg.readString();
+        setQuestVar(name, msg.readString());
+    }
+
     // inventory - must be last because size isn't transmitted
     Possessions &poss = getPossessions();
 
@@ -219,3 +234,12 @@ void CharacterData::giveAbility(int id)
 {
     mAbilities.insert(id);
 }
+
+void CharacterData::setQuestVar(const std::string &name,
+                                const std::string &value)
+{
+    if (value.empty())
+        mQuestVars.erase(name);
+    else
+        mQuestVars[name] = value;
+}
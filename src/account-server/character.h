@@ -239,6 +239,11 @@ class CharacterData
         int getCorrectionPoints() const
         { return mCorrectionPoints; }
 
+        /**
+         * Sets the value of a quest variable. An empty value removes it.
+         */
+        void setQuestVar(const std::string &name, const std::string &value);
+
     private:
         CharacterData(const CharacterData &) = delete;
         CharacterData &operator=(const CharacterData &) = delete;
@@ -270,6 +275,7 @@ class CharacterData
         std::vector<std::string> mGuilds;        //!< All the guilds the player
                                                  //!< belongs to.
         std::vector<QuestInfo> mQuests;
+        std::map<std::string, std::string> mQuestVars; //!< Quest variables
 
         friend class AccountHandler;
         friend class Storage;
@@ -0,0 +1,210 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "account-server/charactercache.h"
+
+#include "account-server/character.h"
+#include "account-server/storage.h"
+#include "utils/logger.h"
+
+#include <vector>
+
+CharacterCache::CharacterCache(Storage *storage, unsigned capacity,
+                               int maxDirtyAge, unsigned maxDirty)
+    : mStorage(storage)
+    , mCapacity(capacity)
+    , mMaxDirtyAge(maxDirtyAge)
+    , mMaxDirty(maxDirty)
+{
+}
+
+CharacterCache::~CharacterCache()
+{
+    if (!mDirty.empty())
+    {
+        LOG_WARN("Character cache: dropping changes of " << mDirty.size()
+                 << " character(s).");
+    }
+
+    for (Entries::iterator it = mEntries.begin(), it_end = mEntries.end();
+         it != it_end; ++it)
+    {
+        delete it->second.character;
+    }
+}
+
+CharacterData *CharacterCache::get(int id)
+{
+    Entries::iterator it = mEntries.find(id);
+    if (it != mEntries.end())
+    {
+        Entry &entry = it->second;
+        mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed,
+                             entry.recent);
+        return entry.character;
+    }
+
+    CharacterData *character = mStorage->getCharacter(id, nullptr);
+    if (!character)
+        return nullptr;
+
+    Entry &entry = mEntries[id];
+    entry.character = character;
+    entry.recent = mRecentlyUsed.insert(mRecentlyUsed.begin(), id);
+    entry.isDirty = false;
+    entry.dirtySince = 0;
+
+    evict();
+    return character;
+}
+
+CharacterData *CharacterCache::find(int id) const
+{
+    Entries::const_iterator it = mEntries.find(id);
+    return it != mEntries.end() ? it->second.character : nullptr;
+}
+
+void CharacterCache::setDirty(CharacterData *character)
+{
+    Entries::iterator it = mEntries.find(character->getDatabaseID());
+    if (it == mEntries.end() || it->second.character != character)
+    {
+        // Not one of ours, write it right away
+        mStorage->updateCharacter(character);
+        return;
+    }
+
+    Entry &entry = it->second;
+    if (!entry.isDirty)
+    {
+        entry.isDirty = true;
+        entry.dirtySince = time(nullptr);
+        entry.dirty = mDirty.insert(mDirty.end(), it->first);
+    }
+
+    // Bound the amount of changes that a crash could lose
+    while (mDirty.size() > mMaxDirty)
+    {
+        const size_t dirtyCount = mDirty.size();
+        write(mEntries[mDirty.front()]);
+        if (mDirty.size() == dirtyCount)
+            break;
+    }
+}
+
+void CharacterCache::write(Entry &entry)
+{
+    if (!entry.isDirty)
+        return;
+
+    try
+    {
+        mStorage->updateCharacter(entry.character);
+    }
+    catch (const std::string &)
+    {
+        // Already logged. Keep the changes and try again later.
+        entry.dirtySince = time(nullptr);
+        mDirty.splice(mDirty.end(), mDirty, entry.dirty);
+        return;
+    }
+
+    mDirty.erase(entry.dirty);
+    entry.isDirty = false;
+}
+
+void CharacterCache::evict()
+{
+    while (mEntries.size() > mCapacity)
+    {
+        const int id = mRecentlyUsed.back();
+        Entry &entry = mEntries[id];
+
+        write(entry);
+        if (entry.isDirty)
+            return;
+
+        mRecentlyUsed.pop_back();
+        delete entry.character;
+        mEntries.erase(id);
+    }
+}
+
+void CharacterCache::flush(int id)
+{
+    Entries::iterator it = mEntries.find(id);
+    if (it != mEntries.end())
+        write(it->second);
+}
+
+void CharacterCache::flushAccount(int accountId)
+{
+    // Only dirty entries matter, and there are few of them
+    std::vector<int> ids;
+    for (std::list<int>::const_iterator it = mDirty.begin(),
+         it_end = mDirty.end(); it != it_end; ++it)
+    {
+        if (mEntries[*it].character->getAccountID() == accountId)
+            ids.push_back(*it);
+    }
+
+    for (std::vector<int>::const_iterator it = ids.begin(),
+         it_end = ids.end(); it != it_end; ++it)
+    {
+        flush(*it);
+    }
+}
+
+void CharacterCache::checkpoint()
+{
+    const time_t threshold = time(nullptr) - mMaxDirtyAge;
+
+    // Entries failing to be written go to the back of the list, so only
+    // visit each of them once.
+    const size_t count = mDirty.size();
+    for (size_t i = 0; i < count && !mDirty.empty(); ++i)
+    {
+        Entry &entry = mEntries[mDirty.front()];
+        if (entry.dirtySince > threshold)
+            break;
+        write(entry);
+    }
+}
+
+void CharacterCache::flushAll()
+{
+    const size_t count = mDirty.size();
+    for (size_t i = 0; i < count && !mDirty.empty(); ++i)
+        write(mEntries[mDirty.front()]);
+}
+
+void CharacterCache::remove(int id)
+{
+    Entries::iterator it = mEntries.find(id);
+    if (it == mEntries.end())
+        return;
+
+    Entry &entry = it->second;
+    if (entry.isDirty)
+        mDirty.erase(entry.dirty);
+    mRecentlyUsed.erase(entry.recent);
+    delete entry.character;
+    mEntries.erase(it);
+}
@@ -0,0 +1,143 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHARACTERCACHE_H
+#define CHARACTERCACHE_H
+
+#include <ctime>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+class CharacterData;
+class Storage;
+
+/**
+ * A write-behind cache of the characters handled by the game servers.
+ *
+ * Characters are kept in least recently used order, up to a fixed number.
+ * Changes are only marked here and written to the database later: when they
+ * are older than the allowed age, when too many characters wait to be
+ * written, when the character goes offline or is evicted, or when the
+ * storage is closed.
+ *
+ * The cache owns the characters it returns, they must not be deleted.
+ */
+class CharacterCache
+{
+    public:
+        /**
+         * @param storage       the storage used to load and write characters.
+         * @param capacity      the number of characters kept in memory.
+         * @param maxDirtyAge   seconds a change may wait before being written.
+         * @param maxDirty      the number of changed characters allowed to
+         *                      wait at the same time.
+         */
+        CharacterCache(Storage *storage, unsigned capacity,
+                       int maxDirtyAge, unsigned maxDirty);
+
+        ~CharacterCache();
+
+        /**
+         * Gets a character, loading it from the database when it is not
+         * cached yet.
+         *
+         * @return the character, or null if it doesn't exist.
+         */
+        CharacterData *get(int id);
+
+        /**
+         * Gets a character only if it is cached.
+         */
+        CharacterData *find(int id) const;
+
+        /**
+         * Notes that a cached character was changed and should be written.
+         */
+        void setDirty(CharacterData *character);
+
+        /**
+         * Writes the changes of the given character, if any.
+         */
+        void flush(int id);
+
+        /**
+         * Writes the changes of the characters of the given account, before
+         * the account and its characters are loaded from the database.
+         */
+        void flushAccount(int accountId);
+
+        /**
+         * Writes the changes that waited for too long.
+         */
+        void checkpoint();
+
+        /**
+         * Writes all the changes.
+         */
+        void flushAll();
+
+        /**
+         * Forgets about a character without writing its changes.
+         */
+        void remove(int id);
+
+        /**
+         * Calls the given function on each cached character.
+         */
+        template< class Function >
+        void forEach(Function function)
+        {
+            for (Entries::iterator it = mEntries.begin(),
+                 it_end = mEntries.end(); it != it_end; ++it)
+            {
+                function(it->second.character);
+            }
+        }
+
+    private:
+        CharacterCache(const CharacterCache &rhs) = delete;
+        CharacterCache &operator=(const CharacterCache &rhs) = delete;
+
+        struct Entry
+        {
+            CharacterData *character;
+            std::list<int>::iterator recent;    /**< In mRecentlyUsed */
+            std::list<int>::iterator dirty;     /**< In mDirty, if dirty */
+            bool isDirty;
+            time_t dirtySince;
+        };
+
+        typedef std::unordered_map<int, Entry> Entries;
+
+        void write(Entry &entry);
+        void evict();
+
+        Storage *mStorage;
+        unsigned mCapacity;
+        int mMaxDirtyAge;
+        unsigned mMaxDirty;
+
+        Entries mEntries;
+        std::list<int> mRecentlyUsed;   /**< Most recently used first */
+        std::list<int> mDirty;          /**< Oldest change first */
+};
+
+#endif // CHARACTERCACHE_H
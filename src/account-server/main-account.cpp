@@ -41,12 +41,15 @@
 #include "net/bandwidth.h"
 #include "net/connectionhandler.h"
 #include "net/messageout.h"
+#include "net/metricsserver.h"
 #include "utils/logger.h"
 #include "utils/processorutils.h"
+#include "utils/profiler.h"
 #include "utils/stringfilter.h"
 #include "utils/time.h"
 #include "utils/timer.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <getopt.h>
 #include <signal.h>
@@ -61,6 +64,7 @@ using utils::Logger;
 #define DEFAULT_LOG_FILE          "manaserv-account.log"
 #define DEFAULT_STATS_FILE        "manaserv.stats"
 #define DEFAULT_ATTRIBUTEDB_FILE  "attributes.xml"
+#define DEFAULT_PROFILE_FILE      "manaserv-account.folded"
 
 static bool running = true;        /**< Determines if server keeps running */
 
@@ -79,6 +83,9 @@ GuildManager *guildManager;
 PostManager *postalManager;
 BandwidthMonitor *gBandwidth;
 
+/** Serves the metrics to the monitoring system */
+static MetricsServer *metricsServer;
+
 /** Callback used when SIGQUIT signal is received. */
 static void closeGracefully(int)
 {
@@ -132,6 +139,12 @@ static void initialize()
     postalManager = new PostManager;
     gBandwidth = new BandwidthMonitor;
 
+    metricsServer = new MetricsServer;
+    metricsServer->start(
+            Configuration::getValue("net_accountMetricsPort", 0),
+            Configuration::getValue("net_accountMetricsSocket",
+                                    std::string()));
+
     // --- Initialize the global handlers
     // FIXME: Make the global handlers global vars or part of a bigger
     // singleton or a local variable in the event-loop
@@ -147,6 +160,10 @@ static void initialize()
     // Initialize the processor utility functions
     utils::processor::init();
 
+    Profiler::initialize(
+            Configuration::getValue("log_accountProfileFile",
+                                    std::string(DEFAULT_PROFILE_FILE)));
+
     // Seed the random number generator
     std::srand( time(nullptr) );
 }
@@ -160,6 +177,8 @@ static void deinitializeServer()
     // Write configuration file
     Configuration::deinitialize();
 
+    delete metricsServer;
+
     // Destroy message handlers.
     AccountClientHandler::deinitialize();
     GameServerHandler::deinitialize();
@@ -365,9 +384,25 @@ int main(int argc, char *argv[])
     utils::Timer statTimer(10000);
     // Check for expired bans every 30 seconds
     utils::Timer banTimer(30000);
+    // Write buffered transactions to the journal file, and move the journal
+    // to the database in batches.
+    utils::Timer journalSyncTimer(
+            Configuration::getValue("journal_syncInterval", 1000));
+    utils::Timer journalFlushTimer(
+            Configuration::getValue("journal_flushInterval", 10000));
+    // Write the cached characters whose changes waited for too long
+    utils::Timer characterTimer(1000);
+    // Make sure the connection used for writes still works
+    utils::Timer connectionTimer(
+            std::max(1, Configuration::getValue("db_checkInterval", 30))
+            * 1000);
 
     statTimer.start();
     banTimer.start();
+    journalSyncTimer.start();
+    journalFlushTimer.start();
+    characterTimer.start();
+    connectionTimer.start();
 
     // Write startup time to database as system world state variable
     std::stringstream timestamp;
@@ -377,6 +412,8 @@ int main(int argc, char *argv[])
 
     while (running)
     {
+        Profiler::update();
+
         AccountClientHandler::process();
         GameServerHandler::process();
         chatHandler->process(50);
@@ -387,6 +424,17 @@ int main(int argc, char *argv[])
 
         if (banTimer.poll())
             storage->checkBannedAccounts();
+
+        if (journalFlushTimer.poll())
+            storage->flushTransactions();
+        else if (journalSyncTimer.poll())
+            storage->syncTransactions();
+
+        if (characterTimer.poll())
+            storage->checkpointCharacters();
+
+        if (connectionTimer.poll())
+            storage->checkConnection();
     }
 
     LOG_INFO("Received: Quit signal, closing down...");
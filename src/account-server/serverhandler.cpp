@@ -19,8 +19,10 @@
  */
 
 #include <cassert>
+#include <cstdlib>
 #include <sstream>
 #include <list>
+#include <vector>
 
 #include "account-server/serverhandler.h"
 
@@ -41,6 +43,7 @@
 #include "net/netcomputer.h"
 #include "utils/logger.h"
 #include "utils/tokendispenser.h"
+#include "utils/zlib.h"
 
 using namespace ManaServ;
 
@@ -288,15 +291,10 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
         {
             LOG_DEBUG("GAMSG_PLAYER_DATA");
             int id = msg.readInt32();
-            if (CharacterData *ptr = storage->getCharacter(id, nullptr))
+            if (CharacterData *ptr = storage->getCachedCharacter(id))
             {
                 ptr->deserialize(msg);
-                if (!storage->updateCharacter(ptr))
-                {
-                    LOG_ERROR("Failed to update character "
-                              << id << '.');
-                }
-                delete ptr;
+                storage->updateCachedCharacter(ptr);
             }
             else
             {
@@ -311,12 +309,42 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
             GameServerHandler::syncDatabase(msg);
         } break;
 
+        case GAMSG_PLAYER_SYNC_COMPRESSED:
+        {
+            LOG_DEBUG("GAMSG_PLAYER_SYNC_COMPRESSED");
+            const unsigned length = msg.readInt32();
+            std::string compressed = msg.readBytes(msg.getUnreadLength());
+
+            char *data = 0;
+            unsigned dataLength = 0;
+            if (compressed.empty() ||
+                !inflateMemory(&compressed[0], compressed.size(),
+                               data, dataLength))
+            {
+                LOG_ERROR("Could not inflate sync data.");
+                break;
+            }
+
+            if (dataLength != length || dataLength > 0xFFFF)
+            {
+                LOG_ERROR("Received sync data of unexpected length "
+                          << dataLength << '.');
+            }
+            else
+            {
+                MessageIn syncMsg(data, dataLength);
+                if (syncMsg.getId() == GAMSG_PLAYER_SYNC)
+                    GameServerHandler::syncDatabase(syncMsg);
+            }
+            free(data);
+        } break;
+
         case GAMSG_REDIRECT:
         {
             LOG_DEBUG("GAMSG_REDIRECT");
             int id = msg.readInt32();
             std::string magic_token(utils::getMagicToken());
-            if (CharacterData *ptr = storage->getCharacter(id, nullptr))
+            if (CharacterData *ptr = storage->getCachedCharacter(id))
             {
                 int mapId = ptr->getMapId();
                 if (GameServer *s = getGameServerFromMap(mapId))
@@ -334,7 +362,6 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
                     LOG_ERROR("Server Change: No game server for map " <<
                               mapId << '.');
                 }
-                delete ptr;
             }
             else
             {
@@ -349,11 +376,10 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
             int id = msg.readInt32();
             std::string magic_token = msg.readString(MAGIC_TOKEN_LENGTH);
 
-            if (CharacterData *ptr = storage->getCharacter(id, nullptr))
+            if (CharacterData *ptr = storage->getCachedCharacter(id))
             {
                 int accountID = ptr->getAccountID();
                 AccountClientHandler::prepareReconnect(magic_token, accountID);
-                delete ptr;
             }
             else
             {
@@ -362,26 +388,6 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
             }
         } break;
 
-        case GAMSG_GET_VAR_CHR:
-        {
-            int id = msg.readInt32();
-            std::string name = msg.readString();
-            std::string value = storage->getQuestVar(id, name);
-            MessageOut result(AGMSG_GET_VAR_CHR_RESPONSE);
-            result.writeInt32(id);
-            result.writeString(name);
-            result.writeString(value);
-            comp->send(result);
-        } break;
-
-        case GAMSG_SET_VAR_CHR:
-        {
-            int id = msg.readInt32();
-            std::string name = msg.readString();
-            std::string value = msg.readString();
-            storage->setQuestVar(id, name, value);
-        } break;
-
         case GAMSG_SET_VAR_WORLD:
         {
             std::string name = msg.readString();
@@ -419,7 +425,7 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
             int level = msg.readInt16();
 
             // get the character so we can get the account id
-            CharacterData *c = storage->getCharacter(id, nullptr);
+            CharacterData *c = storage->getCachedCharacter(id);
             if (c)
             {
                 storage->setAccountLevel(c->getAccountID(), level);
@@ -610,6 +616,7 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
                      << msg.getId());
             MessageOut result(XXMSG_INVALID);
             comp->send(result);
+            rejectMessage();
             break;
     }
 }
@@ -661,9 +668,19 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
     // It is safe to perform the following updates in a transaction
     dal::PerformTransaction transaction(storage->database());
 
+    // Attribute changes are stored together, before any other record so
+    // that the order of the changes of a character is kept.
+    std::vector<Storage::AttributeUpdate> attributes;
+
     while (msg.getUnreadLength() > 0)
     {
         int msgType = msg.readInt8();
+        if (msgType != SYNC_CHARACTER_ATTRIBUTE && !attributes.empty())
+        {
+            storage->updateAttributes(attributes);
+            attributes.clear();
+        }
+
         switch (msgType)
         {
             case SYNC_CHARACTER_POINTS:
@@ -678,11 +695,21 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
             case SYNC_CHARACTER_ATTRIBUTE:
             {
                 LOG_DEBUG("received SYNC_CHARACTER_ATTRIBUTE");
-                int    charId = msg.readInt32();
-                int    attrId = msg.readInt32();
-                double base   = msg.readDouble();
-                double mod    = msg.readDouble();
-                storage->updateAttribute(charId, attrId, base, mod);
+                Storage::AttributeUpdate update;
+                update.charId = msg.readInt32();
+                update.attrId = msg.readInt32();
+                update.base   = msg.readDouble();
+                update.mod    = msg.readDouble();
+                attributes.push_back(update);
+            } break;
+
+            case SYNC_CHARACTER_VAR:
+            {
+                LOG_DEBUG("received SYNC_CHARACTER_VAR");
+                int charId = msg.readInt32();
+                std::string name = msg.readString();
+                std::string value = msg.readString();
+                storage->setQuestVar(charId, name, value);
             } break;
 
             case SYNC_ONLINE_STATUS:
@@ -695,5 +722,8 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
         }
     }
 
+    if (!attributes.empty())
+        storage->updateAttributes(attributes);
+
     transaction.commit();
 }
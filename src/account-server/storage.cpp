@@ -18,6 +18,7 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <time.h>
 
@@ -25,14 +26,16 @@
 
 #include "account-server/account.h"
 #include "account-server/character.h"
+#include "account-server/charactercache.h"
 #include "account-server/flooritem.h"
+#include "account-server/transactionjournal.h"
 #include "chat-server/chatchannel.h"
 #include "chat-server/guild.h"
 #include "chat-server/post.h"
 #include "common/configuration.h"
 #include "common/manaserv_protocol.h"
 #include "dal/dalexcept.h"
-#include "dal/dataproviderfactory.h"
+#include "dal/connectionpool.h"
 #include "utils/functors.h"
 #include "utils/point.h"
 #include "utils/string.h"
@@ -43,6 +46,14 @@
 
 static const char *DEFAULT_ITEM_FILE = "items.xml";
 
+// Rows per INSERT when moving journaled transactions to the database. Each
+// row binds four parameters, which keeps us below SQLite's limit of 999.
+static const unsigned TRANSACTION_BATCH_SIZE = 100;
+
+// Maximum number of attributes stored by a single statement. Each row binds
+// four parameters, like the transactions.
+static const unsigned ATTRIBUTE_BATCH_SIZE = 100;
+
 // Defines the supported db version
 static const char *DB_VERSION_PARAMETER = "database_version";
 
@@ -94,31 +105,63 @@ static const char *TRANSACTION_TBL_NAME         =   "mana_transactions";
 static const char *FLOOR_ITEMS_TBL_NAME         =   "mana_floor_items";
 
 Storage::Storage()
-        : mDb(dal::DataProviderFactory::createDataProvider()),
-          mItemDbVersion(0)
+        : mDb(0),
+          mPool(0),
+          mReplicaPool(0),
+          mItemDbVersion(0),
+          mTransactionJournal(0),
+          mCharacterCache(0)
 {
 }
 
 Storage::~Storage()
 {
-    if (mDb->isConnected())
+    if (mDb)
         close();
 
-    delete mDb;
+    delete mCharacterCache;
+    delete mTransactionJournal;
+    delete mReplicaPool;
+    delete mPool;
 }
 
 void Storage::open()
 {
     // Do nothing if already connected.
-    if (mDb->isConnected())
+    if (mDb)
         return;
 
     using namespace dal;
 
     try
     {
-        // Open a connection to the database.
-        mDb->connect();
+        // Open the connections to the database. Storage keeps one of them
+        // for its writes, the others serve the reads that may lag behind
+        // when there is no replica.
+        const int checkInterval =
+                Configuration::getValue("db_checkInterval", 30);
+        if (!mPool)
+        {
+            mPool = new ConnectionPool(
+                    "primary", std::string(),
+                    std::max(1, Configuration::getValue("db_poolSize", 2)),
+                    checkInterval);
+        }
+        mPool->open();
+        mDb = mPool->acquire();
+
+        if (Configuration::getBoolValue("db_useReplica", false))
+        {
+            if (!mReplicaPool)
+            {
+                mReplicaPool = new ConnectionPool(
+                        "replica", "replica_",
+                        std::max(1, Configuration::getValue(
+                                        "db_replicaPoolSize", 2)),
+                        checkInterval);
+            }
+            mReplicaPool->open();
+        }
 
         // Check database version here
         int dbversion = utils::stringToInt(
@@ -149,6 +192,30 @@ void Storage::open()
             sql << "DELETE FROM " << FLOOR_ITEMS_TBL_NAME;
             mDb->execSql(sql.str());
         }
+
+        // Store what is left in the journal from the previous run
+        const std::string journalFile =
+                Configuration::getValue("journal_file",
+                                        "./manaserv-transactions.journal");
+        if (!journalFile.empty() && !mTransactionJournal)
+        {
+            mTransactionJournal = new TransactionJournal(
+                    journalFile,
+                    Configuration::getValue("journal_maxBufferedEntries", 256),
+                    Configuration::getBoolValue("journal_fsync", true));
+            flushTransactions();
+        }
+
+        if (!mCharacterCache)
+        {
+            mCharacterCache = new CharacterCache(
+                    this,
+                    std::max(1, Configuration::getValue("char_cacheSize",
+                                                        1000)),
+                    Configuration::getValue("char_cacheMaxDirtyAge", 60),
+                    std::max(0, Configuration::getValue("char_cacheMaxDirty",
+                                                        100)));
+        }
     }
     catch (const DbConnectionFailure& e)
     {
@@ -159,7 +226,23 @@ void Storage::open()
 
 void Storage::close()
 {
-    mDb->disconnect();
+    if (mCharacterCache)
+        mCharacterCache->flushAll();
+
+    if (mTransactionJournal)
+        flushTransactions();
+
+    mPool->release(mDb);
+    mDb = 0;
+    mPool->close();
+
+    if (mReplicaPool)
+        mReplicaPool->close();
+}
+
+dal::ConnectionPool &Storage::readPool()
+{
+    return mReplicaPool && mReplicaPool->isOpen() ? *mReplicaPool : *mPool;
 }
 
 Account *Storage::getAccountBySQL()
@@ -200,7 +283,11 @@ Account *Storage::getAccountBySQL()
         // NOTE: Will be deprecated and removed at some point.
         fixCharactersSlot(id);
 
-        // Load the characters associated with the account.
+        // Load the characters associated with the account, once the cached
+        // changes are in the database.
+        if (mCharacterCache)
+            mCharacterCache->flushAccount(id);
+
         std::ostringstream sql;
         sql << "select id from " << CHARACTERS_TBL_NAME << " where user_id = '"
             << id << "';";
@@ -393,8 +480,8 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
             character->setAccountID(id);
             std::ostringstream s;
             s << "select level from " << ACCOUNTS_TBL_NAME
-              << " where id = '" << id << "';";
-            const dal::RecordSet &levelInfo = mDb->execSql(s.str());
+              << " where id = ?";
+            const dal::RecordSet &levelInfo = selectById(s.str(), id);
             character->setAccountLevel(toUint(levelInfo(0, 0)), true);
         }
 
@@ -404,9 +491,10 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
         {
             s << "SELECT attr_id, attr_base, attr_mod "
               << "FROM " << CHAR_ATTR_TBL_NAME << " "
-              << "WHERE char_id = " << character->getDatabaseID();
+              << "WHERE char_id = ?";
 
-            const dal::RecordSet &attrInfo = mDb->execSql(s.str());
+            const dal::RecordSet &attrInfo = 
+                selectById(s.str(), character->getDatabaseID());
             const unsigned nRows = attrInfo.rows();
             for (unsigned row = 0; row < nRows; ++row)
             {
@@ -422,8 +510,9 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
             s.str("");
             s << "select status_id, status_time FROM "
               << CHAR_STATUS_EFFECTS_TBL_NAME
-              << " WHERE char_id = " << character->getDatabaseID();
-            const dal::RecordSet &statusInfo = mDb->execSql(s.str());
+              << " WHERE char_id = ?";
+            const dal::RecordSet &statusInfo = 
+                selectById(s.str(), character->getDatabaseID());
             const unsigned nRows = statusInfo.rows();
             for (unsigned row = 0; row < nRows; row++)
             {
@@ -438,8 +527,9 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
             s.clear();
             s.str("");
             s << "select monster_id, kills FROM " << CHAR_KILL_COUNT_TBL_NAME
-              << " WHERE char_id = " << character->getDatabaseID();
-            const dal::RecordSet &killsInfo = mDb->execSql(s.str());
+              << " WHERE char_id = ?";
+            const dal::RecordSet &killsInfo = 
+                selectById(s.str(), character->getDatabaseID());
             const unsigned nRows = killsInfo.rows();
             for (unsigned row = 0; row < nRows; row++)
             {
@@ -455,8 +545,9 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
             s.str("");
             s << "SELECT ability_id FROM "
               << CHAR_ABILITIES_TBL_NAME
-              << " WHERE char_id = " << character->getDatabaseID();
-            const dal::RecordSet &abilitiesInfo = mDb->execSql(s.str());
+              << " WHERE char_id = ?";
+            const dal::RecordSet &abilitiesInfo = 
+                selectById(s.str(), character->getDatabaseID());
             const unsigned nRows = abilitiesInfo.rows();
             for (unsigned row = 0; row < nRows; row++)
             {
@@ -470,8 +561,9 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
             s.str("");
             s << "SELECT quest_id, quest_state, quest_title, quest_description "
               << "FROM " << QUESTLOG_TBL_NAME
-              << " WHERE char_id = " << character->getDatabaseID();
-            const dal::RecordSet &quests = mDb->execSql(s.str());
+              << " WHERE char_id = ?";
+            const dal::RecordSet &quests = 
+                selectById(s.str(), character->getDatabaseID());
             const unsigned nRows = quests.rows();
             for (unsigned row = 0; row < nRows; row++)
             {
@@ -483,6 +575,20 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
                 character->mQuests.push_back(quest);
             }
         }
+
+        // Load the quest variables, so that the game server doesn't need to
+        // ask for them one by one
+        {
+            s.clear();
+            s.str("");
+            s << "SELECT name, value FROM " << QUESTS_TBL_NAME
+              << " WHERE owner_id = ?";
+            const dal::RecordSet &questVars = 
+                selectById(s.str(), character->getDatabaseID());
+            const unsigned nRows = questVars.rows();
+            for (unsigned row = 0; row < nRows; row++)
+                character->setQuestVar(questVars(row, 0), questVars(row, 1));
+        }
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
@@ -496,12 +602,13 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
     {
         std::ostringstream sql;
         sql << " select id, owner_id, slot, class_id, amount, equipped from "
-            << INVENTORIES_TBL_NAME << " where owner_id = '"
-            << character->getDatabaseID() << "' order by slot asc;";
+            << INVENTORIES_TBL_NAME << " where owner_id = ?"
+            << " order by slot asc";
 
         InventoryData inventoryData;
         EquipData equipmentData;
-        const dal::RecordSet &itemInfo = mDb->execSql(sql.str());
+        const dal::RecordSet &itemInfo =
+                selectById(sql.str(), character->getDatabaseID());
         if (!itemInfo.isEmpty())
         {
             for (int k = 0, size = itemInfo.rows(); k < size; ++k)
@@ -529,6 +636,15 @@ CharacterData *Storage::getCharacterBySQL(Account *owner)
     return character;
 }
 
+const dal::RecordSet &Storage::selectById(const std::string &sql, int id)
+{
+    if (!mDb->prepareSql(sql))
+        throw dal::DbSqlQueryExecFailure("failed to prepare: " + sql);
+
+    mDb->bindValue(1, id);
+    return mDb->processSql();
+}
+
 CharacterData *Storage::getCharacter(int id, Account *owner)
 {
     std::ostringstream sql;
@@ -581,14 +697,16 @@ bool Storage::doesUserNameExist(const std::string &name)
 {
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::ostringstream sql;
         sql << "SELECT COUNT(username) FROM " << ACCOUNTS_TBL_NAME
             << " WHERE username = ?";
 
-        if (mDb->prepareSql(sql.str()))
+        if (db->prepareSql(sql.str()))
         {
-            mDb->bindValue(1, name);
-            const dal::RecordSet &accountInfo = mDb->processSql();
+            db->bindValue(1, name);
+            const dal::RecordSet &accountInfo = db->processSql();
 
             std::istringstream ssStream(accountInfo(0, 0));
             unsigned iReturn = 1;
@@ -615,13 +733,15 @@ bool Storage::doesEmailAddressExist(const std::string &email)
 {
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::ostringstream sql;
         sql << "SELECT COUNT(email) FROM " << ACCOUNTS_TBL_NAME
             << " WHERE UPPER(email) = UPPER(?)";
-        if (mDb->prepareSql(sql.str()))
+        if (db->prepareSql(sql.str()))
         {
-            mDb->bindValue(1, email);
-            const dal::RecordSet &accountInfo = mDb->processSql();
+            db->bindValue(1, email);
+            const dal::RecordSet &accountInfo = db->processSql();
 
             std::istringstream ssStream(accountInfo(0, 0));
             unsigned iReturn = 1;
@@ -648,14 +768,16 @@ bool Storage::doesCharacterNameExist(const std::string& name)
 {
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::ostringstream sql;
         sql << "SELECT COUNT(name) FROM " << CHARACTERS_TBL_NAME
             << " WHERE name = ?";
-        if (mDb->prepareSql(sql.str()))
+        if (db->prepareSql(sql.str()))
         {
-            mDb->bindValue(1, name);
+            db->bindValue(1, name);
 
-            const dal::RecordSet &accountInfo = mDb->processSql();
+            const dal::RecordSet &accountInfo = db->processSql();
 
             std::istringstream ssStream(accountInfo(0, 0));
             int iReturn = 1;
@@ -954,7 +1076,7 @@ void Storage::flush(Account *account)
             mDb->bindValue(2, account->getPassword());
             mDb->bindValue(3, account->getEmail());
             mDb->bindValue(4, account->getLevel());
-            mDb->bindValue(5, account->getLastLogin());
+            mDb->bindValue(5, (int) account->getLastLogin());
             mDb->bindValue(6, account->getID());
 
             mDb->processSql();
@@ -1120,6 +1242,16 @@ void Storage::updateCharacterPoints(int charId,
             << " WHERE id = " << charId;
 
         mDb->execSql(sql.str());
+
+        // Keep the cached character from writing back the old values
+        if (mCharacterCache)
+        {
+            if (CharacterData *character = mCharacterCache->find(charId))
+            {
+                character->setAttributePoints(charPoints);
+                character->setCorrectionPoints(corrPoints);
+            }
+        }
     }
     catch (dal::DbSqlQueryExecFailure &e)
     {
@@ -1131,15 +1263,28 @@ void Storage::updateCharacterPoints(int charId,
 void Storage::updateAttribute(int charId, unsigned attrId,
                               double base, double mod)
 {
+    if (mCharacterCache)
+    {
+        if (CharacterData *character = mCharacterCache->find(charId))
+        {
+            character->setAttribute(attrId, base);
+            character->setModAttribute(attrId, mod);
+        }
+    }
+
     try
     {
         std::ostringstream sql;
         sql << "UPDATE " << CHAR_ATTR_TBL_NAME
-            << " SET attr_base = '" << base << "', "
-            << "attr_mod = '" << mod << "' "
-            << "WHERE char_id = '" << charId << "' "
-            << "AND attr_id = '" << attrId << "';";
-        mDb->execSql(sql.str());
+            << " SET attr_base = ?, attr_mod = ?"
+            << " WHERE char_id = ? AND attr_id = ?";
+        if (!mDb->prepareSql(sql.str()))
+            throw dal::DbSqlQueryExecFailure("failed to prepare: " + sql.str());
+        mDb->bindValue(1, base);
+        mDb->bindValue(2, mod);
+        mDb->bindValue(3, charId);
+        mDb->bindValue(4, (int) attrId);
+        mDb->processSql();
 
         // If this has modified a row, we're done, it updated sucessfully.
         if (mDb->getModifiedRows() > 0)
@@ -1150,10 +1295,14 @@ void Storage::updateAttribute(int charId, unsigned attrId,
         sql.clear();
         sql.str("");
         sql << "INSERT INTO " << CHAR_ATTR_TBL_NAME
-            << " (char_id, attr_id, attr_base, attr_mod) VALUES ( "
-            << charId << ", " << attrId << ", " << base << ", "
-            << mod << ")";
-        mDb->execSql(sql.str());
+            << " (char_id, attr_id, attr_base, attr_mod) VALUES (?, ?, ?, ?)";
+        if (!mDb->prepareSql(sql.str()))
+            throw dal::DbSqlQueryExecFailure("failed to prepare: " + sql.str());
+        mDb->bindValue(1, charId);
+        mDb->bindValue(2, (int) attrId);
+        mDb->bindValue(3, base);
+        mDb->bindValue(4, mod);
+        mDb->processSql();
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
@@ -1162,6 +1311,98 @@ void Storage::updateAttribute(int charId, unsigned attrId,
     }
 }
 
+void Storage::updateAttributes(const std::vector<AttributeUpdate> &updates)
+{
+    // Keep the last value given to each attribute
+    typedef std::map<std::pair<int, unsigned>, const AttributeUpdate *> Latest;
+    Latest latest;
+    for (std::vector<AttributeUpdate>::const_iterator it = updates.begin(),
+         it_end = updates.end(); it != it_end; ++it)
+    {
+        latest[std::make_pair(it->charId, it->attrId)] = &*it;
+    }
+
+    if (mCharacterCache)
+    {
+        for (Latest::const_iterator it = latest.begin(),
+             it_end = latest.end(); it != it_end; ++it)
+        {
+            const AttributeUpdate &update = *it->second;
+            if (CharacterData *character =
+                    mCharacterCache->find(update.charId))
+            {
+                character->setAttribute(update.attrId, update.base);
+                character->setModAttribute(update.attrId, update.mod);
+            }
+        }
+    }
+
+    try
+    {
+        dal::PerformTransaction transaction(mDb);
+
+        Latest::const_iterator it = latest.begin();
+        while (it != latest.end())
+        {
+            // Replace the rows of this batch: the attribute table has no
+            // unique key that an upsert could rely on in every backend.
+            Latest::const_iterator batchEnd = it;
+            unsigned count = 0;
+            while (count < ATTRIBUTE_BATCH_SIZE && batchEnd != latest.end())
+            {
+                ++count;
+                ++batchEnd;
+            }
+
+            std::ostringstream deleteSql;
+            std::ostringstream insertSql;
+            deleteSql << "DELETE FROM " << CHAR_ATTR_TBL_NAME << " WHERE ";
+            insertSql << "INSERT INTO " << CHAR_ATTR_TBL_NAME
+                      << " (char_id, attr_id, attr_base, attr_mod) VALUES ";
+            for (unsigned i = 0; i < count; ++i)
+            {
+                deleteSql << (i > 0 ? " OR " : "")
+                          << "(char_id = ? AND attr_id = ?)";
+                insertSql << (i > 0 ? ", " : "") << "(?, ?, ?, ?)";
+            }
+
+            // Full batches share the same text, and the same statements
+            if (!mDb->prepareSql(deleteSql.str()))
+                throw dal::DbSqlQueryExecFailure(
+                        "failed to prepare: " + deleteSql.str());
+            int place = 1;
+            for (Latest::const_iterator i = it; i != batchEnd; ++i)
+            {
+                const AttributeUpdate &update = *i->second;
+                mDb->bindValue(place++, update.charId);
+                mDb->bindValue(place++, (int) update.attrId);
+            }
+            mDb->processSql();
+
+            if (!mDb->prepareSql(insertSql.str()))
+                throw dal::DbSqlQueryExecFailure(
+                        "failed to prepare: " + insertSql.str());
+            place = 1;
+            for (; it != batchEnd; ++it)
+            {
+                const AttributeUpdate &update = *it->second;
+                mDb->bindValue(place++, update.charId);
+                mDb->bindValue(place++, (int) update.attrId);
+                mDb->bindValue(place++, update.base);
+                mDb->bindValue(place++, update.mod);
+            }
+            mDb->processSql();
+        }
+
+        transaction.commit();
+    }
+    catch (const dal::DbSqlQueryExecFailure &e)
+    {
+        utils::throwError("(DALStorage::updateAttributes) SQL query failure: ",
+                          e);
+    }
+}
+
 void Storage::updateKillCount(int charId, int monsterId, int kills)
 {
     try
@@ -1416,8 +1657,10 @@ std::map<int, Guild*> Storage::getGuildList()
     // Get the guilds stored in the db.
     try
     {
+        dal::PooledConnection db(readPool());
+
         sql << "select id, name from " << GUILDS_TBL_NAME << ";";
-        const dal::RecordSet& guildInfo = mDb->execSql(sql.str());
+        const dal::RecordSet& guildInfo = db->execSql(sql.str());
 
         // Check that at least 1 guild was returned
         if (guildInfo.isEmpty())
@@ -1440,7 +1683,7 @@ std::map<int, Guild*> Storage::getGuildList()
             memberSql << "select member_id, rights from "
                       << GUILD_MEMBERS_TBL_NAME
                       << " where guild_id = '" << it->second->getId() << "';";
-            const dal::RecordSet& memberInfo = mDb->execSql(memberSql.str());
+            const dal::RecordSet& memberInfo = db->execSql(memberSql.str());
 
             std::list<std::pair<int, int> > members;
             for (unsigned j = 0; j < memberInfo.rows(); ++j)
@@ -1461,7 +1704,7 @@ std::map<int, Guild*> Storage::getGuildList()
             }
         }
     }
-    catch (const dal::DbSqlQueryExecFailure& e)
+    catch (const std::exception &e)
     {
         utils::throwError("(DALStorage::getGuildList) SQL query failure: ", e);
     }
@@ -1469,37 +1712,6 @@ std::map<int, Guild*> Storage::getGuildList()
     return guilds;
 }
 
-std::string Storage::getQuestVar(int id, const std::string &name)
-{
-    try
-    {
-        std::ostringstream query;
-        query << "select value from " << QUESTS_TBL_NAME
-                << " WHERE owner_id = ? AND name = ?";
-        if (mDb->prepareSql(query.str()))
-        {
-            mDb->bindValue(1, id);
-            mDb->bindValue(2, name);
-            const dal::RecordSet &info = mDb->processSql();
-
-            if (!info.isEmpty())
-                return info(0, 0);
-        }
-        else
-        {
-            utils::throwError("(DALStorage:getQuestVar) "
-                              "SQL query preparation failure.");
-        }
-    }
-    catch (const dal::DbSqlQueryExecFailure &e)
-    {
-        utils::throwError("(DALStorage::getQuestVar) SQL query failure: ", e);
-    }
-
-    // Should never happen
-    return std::string();
-}
-
 std::string Storage::getWorldStateVar(const std::string &name, int mapId)
 {
     try
@@ -1644,18 +1856,33 @@ void Storage::setQuestVar(int id, const std::string &name,
     {
         std::ostringstream query1;
         query1 << "delete from " << QUESTS_TBL_NAME
-               << " where owner_id = '" << id << "' and name = '"
-               << name << "';";
-        mDb->execSql(query1.str());
+               << " where owner_id = ? and name = ?";
+        if (!mDb->prepareSql(query1.str()))
+            throw dal::DbSqlQueryExecFailure("failed to prepare: "
+                                             + query1.str());
+        mDb->bindValue(1, id);
+        mDb->bindValue(2, name);
+        mDb->processSql();
+
+        if (mCharacterCache)
+        {
+            if (CharacterData *character = mCharacterCache->find(id))
+                character->setQuestVar(name, value);
+        }
 
         if (value.empty())
             return;
 
         std::ostringstream query2;
         query2 << "insert into " << QUESTS_TBL_NAME
-               << " (owner_id, name, value) values ('"
-               << id << "', '" << name << "', '" << value << "');";
-        mDb->execSql(query2.str());
+               << " (owner_id, name, value) values (?, ?, ?)";
+        if (!mDb->prepareSql(query2.str()))
+            throw dal::DbSqlQueryExecFailure("failed to prepare: "
+                                             + query2.str());
+        mDb->bindValue(1, id);
+        mDb->bindValue(2, name);
+        mDb->bindValue(3, value);
+        mDb->processSql();
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
@@ -1695,6 +1922,9 @@ void Storage::banCharacter(int id, int duration)
 
 void Storage::delCharacter(int charId) const
 {
+    if (mCharacterCache)
+        mCharacterCache->remove(charId);
+
     try
     {
         dal::PerformTransaction transaction(mDb);
@@ -1781,6 +2011,14 @@ void Storage::setAccountLevel(int id, int level)
         << " set level = " << level
         << " where id = " << id << ";";
         mDb->execSql(sql.str());
+
+        if (mCharacterCache)
+        {
+            mCharacterCache->forEach([id, level](CharacterData *character) {
+                if (character->getAccountID() == id)
+                    character->setAccountLevel(level, true);
+            });
+        }
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
@@ -1871,11 +2109,13 @@ Post *Storage::getStoredPost(int playerId)
 
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::ostringstream sql;
         sql << "SELECT * FROM " << POST_TBL_NAME
             << " WHERE receiver_id = " << playerId;
 
-        const dal::RecordSet &post = mDb->execSql(sql.str());
+        const dal::RecordSet &post = db->execSql(sql.str());
 
         if (post.isEmpty())
         {
@@ -2076,6 +2316,10 @@ void Storage::setOnlineStatus(int charId, bool online)
             sql << "DELETE FROM " << ONLINE_USERS_TBL_NAME
                 << " WHERE char_id = " << charId;
             mDb->execSql(sql.str());
+
+            // Leaving the game is a good time to store the character
+            if (mCharacterCache)
+                mCharacterCache->flush(charId);
         }
 
 
@@ -2087,30 +2331,163 @@ void Storage::setOnlineStatus(int charId, bool online)
     }
 }
 
-void Storage::addTransaction(const Transaction &trans)
+CharacterData *Storage::getCachedCharacter(int id)
+{
+    assert(mCharacterCache);
+    return mCharacterCache->get(id);
+}
+
+void Storage::updateCachedCharacter(CharacterData *character)
+{
+    assert(mCharacterCache);
+    mCharacterCache->setDirty(character);
+}
+
+void Storage::checkpointCharacters()
+{
+    if (mCharacterCache)
+        mCharacterCache->checkpoint();
+}
+
+void Storage::checkConnection()
 {
     try
     {
-        std::stringstream sql;
-        sql << "INSERT INTO " << TRANSACTION_TBL_NAME
-            << " VALUES (NULL, " << trans.mCharacterId << ", "
-            << trans.mAction << ", "
-            << "?, "
-            << time(0) << ")";
-        if (mDb->prepareSql(sql.str()))
+        mDb = mPool->revalidate(mDb);
+    }
+    catch (const dal::DbConnectionFailure &e)
+    {
+        LOG_ERROR("(DALStorage::checkConnection) Unable to reconnect to "
+                  "the database: " << e.what());
+    }
+}
+
+void Storage::addTransaction(const Transaction &trans)
+{
+    if (mTransactionJournal)
+    {
+        mTransactionJournal->add(trans);
+        if (!mTransactionJournal->isFull())
+            return;
+
+        // The journal can't be written, store its backlog directly instead
+        // of letting it grow
+        std::vector<Transaction> transactions;
+        mTransactionJournal->takeBuffered(transactions);
+        LOG_WARN("Transaction journal full, storing " << transactions.size()
+                 << " transactions directly.");
+
+        try
         {
-            mDb->bindValue(1, trans.mMessage);
-            mDb->processSql();
+            dal::PerformTransaction transaction(mDb);
+            insertTransactions(transactions);
+            transaction.commit();
+            return;
         }
-        else
+        catch (const std::string &)
         {
-            utils::throwError("(DALStorage::SyncDatabase) "
-                              "SQL query preparation failure.");
+            // Already logged
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("(DALStorage::addTransaction) " << e.what());
+        }
+
+        // Kept for the next attempt, rather than lost
+        LOG_ERROR("Could not store " << transactions.size()
+                  << " transactions, keeping them in memory.");
+        mTransactionJournal->restoreBuffered(transactions);
+        checkConnection();
+        return;
+    }
+
+    insertTransactions(std::vector<Transaction>(1, trans));
+}
+
+void Storage::syncTransactions()
+{
+    if (mTransactionJournal)
+        mTransactionJournal->sync();
+}
+
+void Storage::flushTransactions()
+{
+    if (!mTransactionJournal)
+        return;
+
+    // The first round may only store a segment left sealed by an earlier
+    // failure, the second one then takes care of the active segment.
+    for (int round = 0; round < 2 && mTransactionJournal->seal(); ++round)
+    {
+        std::vector<Transaction> transactions;
+        mTransactionJournal->readSealed(transactions);
+
+        try
+        {
+            dal::PerformTransaction transaction(mDb);
+            insertTransactions(transactions);
+            transaction.commit();
+        }
+        catch (const std::string &)
+        {
+            // Already logged, the segment is retried at the next flush
+            checkConnection();
+            return;
+        }
+        catch (const std::runtime_error &e)
+        {
+            LOG_ERROR("(DALStorage::flushTransactions) " << e.what());
+            checkConnection();
+            return;
+        }
+
+        mTransactionJournal->removeSealed();
+    }
+}
+
+void Storage::insertTransactions(const std::vector<Transaction> &transactions)
+{
+    try
+    {
+        for (size_t start = 0; start < transactions.size();
+             start += TRANSACTION_BATCH_SIZE)
+        {
+            const size_t end = std::min<size_t>(transactions.size(),
+                                                start + TRANSACTION_BATCH_SIZE);
+
+            std::stringstream sql;
+            sql << "INSERT INTO " << TRANSACTION_TBL_NAME << " VALUES ";
+            for (size_t i = start; i < end; ++i)
+            {
+                sql << (i > start ? ", " : "") << "(NULL, ?, ?, ?, ?)";
+            }
+
+            // Full batches share the same text, and the same statement
+            if (mDb->prepareSql(sql.str()))
+            {
+                const time_t now = time(0);
+                int place = 1;
+                for (size_t i = start; i < end; ++i)
+                {
+                    const Transaction &trans = transactions[i];
+                    mDb->bindValue(place++, (int) trans.mCharacterId);
+                    mDb->bindValue(place++, (int) trans.mAction);
+                    mDb->bindValue(place++, trans.mMessage);
+                    mDb->bindValue(place++,
+                                   (int) (trans.mTime ? trans.mTime : now));
+                }
+                mDb->processSql();
+            }
+            else
+            {
+                utils::throwError("(DALStorage::insertTransactions) "
+                                  "SQL query preparation failure.");
+            }
         }
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
-        utils::throwError("(DALStorage::addTransaction) SQL query failure: ",
+        utils::throwError("(DALStorage::insertTransactions) SQL query failure: ",
                           e);
     }
 }
@@ -2122,9 +2499,11 @@ std::vector<Transaction> Storage::getTransactions(unsigned num)
 
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::stringstream sql;
         sql << "SELECT * FROM " << TRANSACTION_TBL_NAME;
-        const dal::RecordSet &rec = mDb->execSql(sql.str());
+        const dal::RecordSet &rec = db->execSql(sql.str());
 
         int size = rec.rows();
         int start = size - num;
@@ -2135,10 +2514,11 @@ std::vector<Transaction> Storage::getTransactions(unsigned num)
             trans.mCharacterId = toUint(rec(i, 1));
             trans.mAction = toUint(rec(i, 2));
             trans.mMessage = rec(i, 3);
+            trans.mTime = toUint(rec(i, 4));
             transactions.push_back(trans);
         }
     }
-    catch (const dal::DbSqlQueryExecFailure &e)
+    catch (const std::exception &e)
     {
         utils::throwError("(DALStorage::getTransactions) SQL query failure: ",
                           e);
@@ -2154,10 +2534,12 @@ std::vector<Transaction> Storage::getTransactions(time_t date)
 
     try
     {
+        dal::PooledConnection db(readPool());
+
         std::stringstream sql;
         sql << "SELECT * FROM " << TRANSACTION_TBL_NAME << " WHERE time > "
             << date;
-        const dal::RecordSet &rec = mDb->execSql(sql.str());
+        const dal::RecordSet &rec = db->execSql(sql.str());
 
         for (unsigned i = 0; i < rec.rows(); ++i)
         {
@@ -2165,10 +2547,11 @@ std::vector<Transaction> Storage::getTransactions(time_t date)
             trans.mCharacterId = toUint(rec(i, 1));
             trans.mAction = toUint(rec(i, 2));
             trans.mMessage = rec(i, 3);
+            trans.mTime = toUint(rec(i, 4));
             transactions.push_back(trans);
         }
     }
-    catch (const dal::DbSqlQueryExecFailure &e)
+    catch (const std::exception &e)
     {
         utils::throwError("(DALStorage::getTransactions) SQL query failure: ",
                           e);
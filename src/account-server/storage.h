@@ -29,13 +29,20 @@
 
 #include "common/transaction.h"
 
+namespace dal
+{
+    class ConnectionPool;
+}
+
 class Account;
+class CharacterCache;
 class CharacterData;
 class ChatChannel;
 class FloorItem;
 class Guild;
 class Letter;
 class Post;
+class TransactionJournal;
 
 /**
  * The high level interface to the database. Through the storage you can access
@@ -76,7 +83,9 @@ class Storage
         Account *getAccount(int accountId);
 
         /**
-         * Gets a character by database Id.
+         * Gets a character by database Id. Changes still waiting in the
+         * character cache are not included, which is fine for the chat and
+         * guild lookups.
          *
          * @param id the ID of the character.
          * @param owner the account the character is in.
@@ -86,7 +95,8 @@ class Storage
         CharacterData *getCharacter(int id, Account *owner);
 
         /**
-         * Gets a character by character name.
+         * Gets a character by character name. Like the above, changes still
+         * waiting in the character cache are not included.
          *
          * @param name of the character
          *
@@ -146,6 +156,21 @@ class Storage
         void updateAttribute(int charId, unsigned attrId,
                              double base, double mod);
 
+        struct AttributeUpdate
+        {
+            int charId;
+            unsigned attrId;
+            double base;
+            double mod;
+        };
+
+        /**
+         * Stores several attribute changes at once, using a few multi-row
+         * statements rather than one or two per attribute. When the same
+         * attribute is given more than once, the last value wins.
+         */
+        void updateAttributes(const std::vector<AttributeUpdate> &updates);
+
         /**
          * Write a modification message about kill counts to the database.
          *
@@ -231,6 +256,35 @@ class Storage
          */
         bool updateCharacter(CharacterData *ptr);
 
+        /**
+         * Gets a character through the character cache. The returned
+         * character stays owned by the storage and must not be deleted.
+         *
+         * @param id the ID of the character.
+         *
+         * @return the character, or null if it doesn't exist.
+         */
+        CharacterData *getCachedCharacter(int id);
+
+        /**
+         * Notes changes made to a character obtained through
+         * getCachedCharacter. They are written to the database later, see
+         * checkpointCharacters.
+         */
+        void updateCachedCharacter(CharacterData *character);
+
+        /**
+         * Writes the character changes that waited for too long.
+         */
+        void checkpointCharacters();
+
+        /**
+         * Checks the connection used for writes, which never goes back to
+         * the pool, and reconnects it when it was lost. Meant to be called
+         * every db_checkInterval seconds.
+         */
+        void checkConnection();
+
         /**
          * Add a new guild.
          *
@@ -316,14 +370,6 @@ class Storage
          */
         void flush(Account *);
 
-        /**
-         * Gets the value of a quest variable.
-         *
-         * @param id character id.
-         * @param name quest var name to get.
-         */
-        std::string getQuestVar(int id, const std::string &);
-
         /**
          * Sets the value of a quest variable.
          *
@@ -411,12 +457,24 @@ class Storage
         void setOnlineStatus(int charId, bool online);
 
         /**
-         * Store a transaction.
+         * Store a transaction. When the transaction journal is enabled, it is
+         * only queued there and written to the database by the next
+         * flushTransactions(), unless the journal is full.
          *
          * @param trans The transaction to add in the logs.
          */
         void addTransaction(const Transaction &trans);
 
+        /**
+         * Appends the transactions buffered in memory to the journal file.
+         */
+        void syncTransactions();
+
+        /**
+         * Moves the journaled transactions to the database in batches.
+         */
+        void flushTransactions();
+
         /**
          * Retrieve the last \a num transactions that were stored.
          *
@@ -432,7 +490,8 @@ class Storage
         std::vector<Transaction> getTransactions(time_t date);
 
         /**
-         * Provides direct access to the database. Use with care!
+         * Provides direct access to the database connection used for
+         * writes. Use with care!
          *
          * @return a database provider object.
          */
@@ -459,6 +518,21 @@ class Storage
          */
         CharacterData *getCharacterBySQL(Account *owner);
 
+        /**
+         * Returns the pool to take a connection from for reads that may lag
+         * a bit behind the writes: the replica when there is one, the main
+         * database otherwise.
+         */
+        dal::ConnectionPool &readPool();
+
+        /**
+         * Runs a query taking an ID as its only parameter, so that the
+         * statement is prepared once for all the characters or accounts.
+         *
+         * @exception dal::DbSqlQueryExecFailure if the query fails.
+         */
+        const dal::RecordSet &selectById(const std::string &sql, int id);
+
         /**
          * Fix improper character slots
          *
@@ -478,8 +552,17 @@ class Storage
          */
         void syncDatabase();
 
-        dal::DataProvider *mDb;         /**< the data provider */
+        /**
+         * Inserts the given transactions using multi-row statements.
+         */
+        void insertTransactions(const std::vector<Transaction> &transactions);
+
+        dal::DataProvider *mDb;         /**< taken from mPool while open */
+        dal::ConnectionPool *mPool;     /**< the main database */
+        dal::ConnectionPool *mReplicaPool; /**< null without a replica */
         unsigned mItemDbVersion;        /**< Version of the item database. */
+        TransactionJournal *mTransactionJournal; /**< null when disabled */
+        CharacterCache *mCharacterCache; /**< created by open() */
 };
 
 extern Storage *storage;
@@ -0,0 +1,283 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "account-server/transactionjournal.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * Fixed part of a journal record, followed by the message bytes. Segments
+ * never leave the machine that wrote them, so the host byte order is used.
+ */
+struct RecordHeader
+{
+    uint32_t characterId;
+    uint32_t action;
+    int64_t time;
+    uint32_t messageLength;
+};
+
+/**
+ * Messages are limited by the protocol's string length. Longer ones are cut
+ * when written, so a larger length can only come from a damaged segment.
+ */
+static const uint32_t MAX_MESSAGE_LENGTH = 0xFFFF;
+
+static void syncFile(std::FILE *file)
+{
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+static bool truncateFile(const std::string &path, long size)
+{
+#ifdef _WIN32
+    const int fd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (fd < 0)
+        return false;
+    const bool truncated = _chsize(fd, size) == 0;
+    _close(fd);
+    return truncated;
+#else
+    return truncate(path.c_str(), size) == 0;
+#endif
+}
+
+TransactionJournal::TransactionJournal(const std::string &path,
+                                       unsigned maxBuffered,
+                                       bool syncToDisk)
+    : mPath(path)
+    , mSealedPath(path + ".sealed")
+    , mMaxBuffered(maxBuffered > 0 ? maxBuffered : 1)
+    , mSyncToDisk(syncToDisk)
+    , mActive(0)
+    , mActiveSize(0)
+    , mActiveDamaged(false)
+{
+    mBuffer.reserve(mMaxBuffered);
+    openActive();
+}
+
+TransactionJournal::~TransactionJournal()
+{
+    sync();
+
+    if (mActive)
+        std::fclose(mActive);
+}
+
+bool TransactionJournal::openActive()
+{
+    if (mActive)
+        return true;
+
+    // A damaged segment has to be sealed before anything is appended to it
+    if (mActiveDamaged)
+        return false;
+
+    mActive = std::fopen(mPath.c_str(), "ab");
+    if (!mActive)
+    {
+        LOG_ERROR("Transaction journal: could not open " << mPath);
+        return false;
+    }
+
+    std::fseek(mActive, 0, SEEK_END);
+    mActiveSize = std::ftell(mActive);
+    return true;
+}
+
+void TransactionJournal::add(const Transaction &trans)
+{
+    mBuffer.push_back(trans);
+    if (!mBuffer.back().mTime)
+        mBuffer.back().mTime = time(0);
+
+    if (mBuffer.size() >= mMaxBuffered)
+        sync();
+}
+
+bool TransactionJournal::sync()
+{
+    if (mBuffer.empty())
+        return true;
+
+    // When the segment can't be written, the transactions stay in memory
+    // for the next attempt rather than being dropped.
+    if (!openActive())
+        return false;
+
+    bool written = true;
+    for (std::vector<Transaction>::const_iterator it = mBuffer.begin(),
+         it_end = mBuffer.end(); it != it_end; ++it)
+    {
+        RecordHeader header;
+        header.characterId = it->mCharacterId;
+        header.action = it->mAction;
+        header.time = it->mTime;
+        header.messageLength = std::min<size_t>(it->mMessage.size(),
+                                                MAX_MESSAGE_LENGTH);
+
+        if (std::fwrite(&header, sizeof(header), 1, mActive) != 1 ||
+            std::fwrite(it->mMessage.data(), 1, header.messageLength,
+                        mActive) != header.messageLength)
+        {
+            written = false;
+            break;
+        }
+    }
+
+    if (!written || std::fflush(mActive) != 0)
+    {
+        LOG_ERROR("Transaction journal: could not write to " << mPath);
+        discardFailedWrite();
+        return false;
+    }
+
+    if (mSyncToDisk)
+        syncFile(mActive);
+
+    mActiveSize = std::ftell(mActive);
+    mBuffer.clear();
+    return true;
+}
+
+/**
+ * Cuts what a failed sync() managed to write, back to the last complete
+ * record. When that fails too, nothing more is appended to the segment until
+ * it is sealed; the partial record then simply ends it.
+ */
+void TransactionJournal::discardFailedWrite()
+{
+    std::fclose(mActive);
+    mActive = 0;
+
+    if (!truncateFile(mPath, mActiveSize))
+    {
+        LOG_ERROR("Transaction journal: could not truncate " << mPath);
+        mActiveDamaged = true;
+    }
+}
+
+void TransactionJournal::takeBuffered(std::vector<Transaction> &transactions)
+{
+    transactions.insert(transactions.end(), mBuffer.begin(), mBuffer.end());
+    mBuffer.clear();
+}
+
+void TransactionJournal::restoreBuffered(
+        const std::vector<Transaction> &transactions)
+{
+    mBuffer.insert(mBuffer.begin(), transactions.begin(), transactions.end());
+}
+
+bool TransactionJournal::seal()
+{
+    if (std::FILE *sealed = std::fopen(mSealedPath.c_str(), "rb"))
+    {
+        std::fclose(sealed);
+        return true;
+    }
+
+    sync();
+
+    // A damaged segment is closed already, and sealed even when empty
+    if (!mActiveDamaged)
+    {
+        if (!mActive || mActiveSize == 0)
+            return false;
+
+        std::fclose(mActive);
+        mActive = 0;
+    }
+
+    if (std::rename(mPath.c_str(), mSealedPath.c_str()) != 0)
+    {
+        LOG_ERROR("Transaction journal: could not seal " << mPath);
+        openActive();
+        return false;
+    }
+
+    mActiveDamaged = false;
+    openActive();
+    return true;
+}
+
+void TransactionJournal::readSealed(std::vector<Transaction> &transactions) const
+{
+    std::FILE *sealed = std::fopen(mSealedPath.c_str(), "rb");
+    if (!sealed)
+        return;
+
+    bool truncated = false;
+    RecordHeader header;
+    while (size_t read = std::fread(&header, 1, sizeof(header), sealed))
+    {
+        if (read != sizeof(header) ||
+            header.messageLength > MAX_MESSAGE_LENGTH)
+        {
+            truncated = true;
+            break;
+        }
+
+        Transaction trans;
+        trans.mCharacterId = header.characterId;
+        trans.mAction = header.action;
+        trans.mTime = header.time;
+        trans.mMessage.resize(header.messageLength);
+
+        if (header.messageLength > 0 &&
+            std::fread(&trans.mMessage[0], 1, header.messageLength,
+                       sealed) != header.messageLength)
+        {
+            truncated = true;
+            break;
+        }
+
+        transactions.push_back(trans);
+    }
+
+    if (truncated)
+    {
+        LOG_WARN("Transaction journal: ignoring damaged record at the end "
+                 "of " << mSealedPath);
+    }
+
+    std::fclose(sealed);
+}
+
+void TransactionJournal::removeSealed()
+{
+    if (std::remove(mSealedPath.c_str()) != 0)
+        LOG_ERROR("Transaction journal: could not remove " << mSealedPath);
+}
@@ -0,0 +1,141 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSACTIONJOURNAL_H
+#define TRANSACTIONJOURNAL_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/transaction.h"
+
+/**
+ * An append-only journal of transactions waiting to be written to the
+ * database.
+ *
+ * New transactions are kept in a small memory buffer and appended to the
+ * active segment file when the buffer is full or when sync() is called. To
+ * move them to the database, the active segment is sealed (renamed aside),
+ * read back, bulk-inserted and finally removed. A sealed segment that could
+ * not be inserted stays on disk and is retried, while new transactions keep
+ * going to a fresh active segment.
+ *
+ * Segments left behind by a crash are picked up the same way on the next
+ * start. A crash between committing a sealed segment and removing it can
+ * insert its transactions twice; they are never lost.
+ *
+ * When the active segment can't be written, the transactions stay in memory
+ * for the next attempt, up to MAX_UNWRITTEN_FACTOR times the buffer size.
+ * Past that the journal is full, and the caller is expected to take them
+ * back with takeBuffered() and store them some other way.
+ */
+class TransactionJournal
+{
+    public:
+        static const unsigned MAX_UNWRITTEN_FACTOR = 4;
+
+        /**
+         * @param path          the active segment file, the sealed segment
+         *                      uses the same name with ".sealed" appended.
+         * @param maxBuffered   number of transactions kept in memory before
+         *                      they are appended to the active segment.
+         * @param syncToDisk    whether each append is followed by an fsync.
+         */
+        TransactionJournal(const std::string &path,
+                           unsigned maxBuffered,
+                           bool syncToDisk);
+
+        ~TransactionJournal();
+
+        /**
+         * Queues a transaction. Stamps it with the current time when it has
+         * none yet.
+         */
+        void add(const Transaction &trans);
+
+        /**
+         * Appends the buffered transactions to the active segment. A failed
+         * write is cut from the segment, so that the transactions can be
+         * appended again by the next attempt.
+         *
+         * @return whether the buffer could be written.
+         */
+        bool sync();
+
+        /**
+         * Returns whether the active segment could not be written for so
+         * long that the buffer reached its limit.
+         */
+        bool isFull() const
+        { return mBuffer.size() >= mMaxBuffered * MAX_UNWRITTEN_FACTOR; }
+
+        /**
+         * Moves the buffered transactions to the given vector.
+         */
+        void takeBuffered(std::vector<Transaction> &transactions);
+
+        /**
+         * Puts transactions taken with takeBuffered() back in front of the
+         * buffer, when they could not be stored some other way either.
+         */
+        void restoreBuffered(const std::vector<Transaction> &transactions);
+
+        /**
+         * Makes sure there is a sealed segment to load, if possible: when no
+         * segment is sealed yet and the active one holds transactions, the
+         * active segment is synced and sealed.
+         *
+         * @return whether a sealed segment is waiting to be loaded.
+         */
+        bool seal();
+
+        /**
+         * Reads the transactions of the sealed segment. A record cut short
+         * by a crash ends the segment.
+         */
+        void readSealed(std::vector<Transaction> &transactions) const;
+
+        /**
+         * Removes the sealed segment once its content has been stored.
+         */
+        void removeSealed();
+
+    private:
+        TransactionJournal(const TransactionJournal &rhs) = delete;
+        TransactionJournal &operator=(const TransactionJournal &rhs) = delete;
+
+        bool openActive();
+        void discardFailedWrite();
+
+        std::string mPath;
+        std::string mSealedPath;
+        unsigned mMaxBuffered;
+        bool mSyncToDisk;
+
+        std::vector<Transaction> mBuffer;
+        std::FILE *mActive;         /**< Open active segment, or null */
+        long mActiveSize;           /**< Bytes in the active segment */
+
+        /** Whether the active segment ends with a record cut short. */
+        bool mActiveDamaged;
+};
+
+#endif // TRANSACTIONJOURNAL_H
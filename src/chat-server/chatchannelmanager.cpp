@@ -49,12 +49,14 @@ int ChatChannelManager::createNewChannel(const std::string &channelName,
     int channelId = nextUsable();
 
     // Register channel
-    mChatChannels.insert(std::make_pair(channelId,
-                                        ChatChannel(channelId,
-                                                    channelName,
-                                                    channelAnnouncement,
-                                                    channelPassword,
-                                                    joinable)));
+    ChatChannels::iterator i =
+            mChatChannels.insert(std::make_pair(channelId,
+                                                ChatChannel(channelId,
+                                                            channelName,
+                                                            channelAnnouncement,
+                                                            channelPassword,
+                                                            joinable))).first;
+    mChatChannelsByName.insert(channelId, channelName, &i->second);
     return channelId;
 }
 
@@ -93,6 +95,7 @@ bool ChatChannelManager::removeChannel(int channelId)
     if (i == mChatChannels.end())
         return false;
     i->second.removeAllUsers();
+    mChatChannelsByName.remove(channelId);
     mChatChannels.erase(i);
     mChannelsNoLongerUsed.push_back(channelId);
     return true;
@@ -117,14 +120,8 @@ std::list<const ChatChannel*> ChatChannelManager::getPublicChannels() const
 
 int ChatChannelManager::getChannelId(const std::string &channelName) const
 {
-    for (ChatChannels::const_iterator i = mChatChannels.begin(),
-            i_end = mChatChannels.end();
-         i != i_end; ++i)
-    {
-        if (i->second.getName() == channelName)
-            return i->first;
-    }
-    return 0;
+    const ChatChannel *channel = mChatChannelsByName.findByName(channelName);
+    return channel ? channel->getId() : 0;
 }
 
 ChatChannel *ChatChannelManager::getChannel(int channelId)
@@ -137,14 +134,7 @@ ChatChannel *ChatChannelManager::getChannel(int channelId)
 
 ChatChannel *ChatChannelManager::getChannel(const std::string &name)
 {
-    for (ChatChannels::iterator i = mChatChannels.begin();
-         i != mChatChannels.end(); ++i)
-    {
-        if (i->second.getName() == name)
-            return &(i->second);
-    }
-
-    return 0;
+    return mChatChannelsByName.findByName(name);
 }
 
 void ChatChannelManager::setChannelTopic(int channelId, const std::string &topic)
@@ -181,13 +171,7 @@ bool ChatChannelManager::channelExists(int channelId) const
 
 bool ChatChannelManager::channelExists(const std::string &channelName) const
 {
-    for (ChatChannels::const_iterator i = mChatChannels.begin();
-         i != mChatChannels.end(); ++i)
-    {
-        if (i->second.getName() == channelName)
-            return true;
-    }
-    return false;
+    return mChatChannelsByName.findByName(channelName) != 0;
 }
 
 int ChatChannelManager::nextUsable()
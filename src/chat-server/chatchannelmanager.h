@@ -26,6 +26,7 @@
 #include <deque>
 
 #include "chat-server/chatchannel.h"
+#include "utils/nameindex.h"
 
 /**
  * The chat channel manager takes care of registering and removing public and
@@ -122,6 +123,7 @@ class ChatChannelManager
          * unique.
          */
         ChatChannels mChatChannels;
+        utils::NameIndex<ChatChannel *> mChatChannelsByName;
         int mNextChannelId;
         std::deque<int> mChannelsNoLongerUsed;
 };
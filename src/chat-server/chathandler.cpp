@@ -145,7 +145,11 @@ void ChatHandler::processMessage(NetComputer *comp, MessageIn &message)
 
     if (computer.characterName.empty())
     {
-        if (message.getId() != PCMSG_CONNECT) return;
+        if (message.getId() != PCMSG_CONNECT)
+        {
+            rejectMessage();
+            return;
+        }
 
         std::string magic_token = message.readString(MAGIC_TOKEN_LENGTH);
         mTokenCollector.addPendingClient(magic_token, &computer);
@@ -238,6 +242,7 @@ void ChatHandler::processMessage(NetComputer *comp, MessageIn &message)
                      << message.getId());
             MessageOut result(XXMSG_INVALID);
             computer.send(result);
+            rejectMessage();
             break;
     }
 }
@@ -622,14 +627,8 @@ void ChatHandler::sayToPlayer(ChatClient &computer,
     MessageOut result(CPMSG_PRIVMSG);
     result.writeString(computer.characterName);
     result.writeString(text);
-    for (NetComputers::iterator i = clients.begin(), i_end = clients.end();
-         i != i_end; ++i) {
-        if (static_cast< ChatClient * >(*i)->characterName == playerName)
-        {
-            (*i)->send(result);
-            break;
-        }
-    }
+    if (ChatClient *client = getClient(playerName))
+        client->send(result);
 }
 
 void ChatHandler::warnUsersAboutPlayerEventInChat(ChatChannel *channel,
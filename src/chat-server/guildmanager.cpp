@@ -32,6 +32,11 @@ using namespace ManaServ;
 GuildManager::GuildManager():
         mGuilds(storage->getGuildList())
 {
+    for (std::map<int, Guild*>::iterator it = mGuilds.begin();
+            it != mGuilds.end(); ++it)
+    {
+        mGuildsByName.insert(it->first, it->second->getName(), it->second);
+    }
 }
 
 GuildManager::~GuildManager()
@@ -51,6 +56,7 @@ Guild* GuildManager::createGuild(const std::string &name, int playerId)
 
     // Add guild
     mGuilds[guild->getId()] = guild;
+    mGuildsByName.insert(guild->getId(), name, guild);
 
     // put the owner in the guild
     addGuildMember(guild, playerId);
@@ -67,6 +73,7 @@ void GuildManager::removeGuild(Guild *guild)
 {
     storage->removeGuild(guild);
     mGuilds.erase(guild->getId());
+    mGuildsByName.remove(guild->getId());
     delete guild;
 }
 
@@ -117,15 +124,7 @@ Guild *GuildManager::findById(short id) const
 
 Guild *GuildManager::findByName(const std::string &name) const
 {
-    for (std::map<int, Guild*>::const_iterator it = mGuilds.begin(),
-            it_end = mGuilds.end();
-            it != it_end; ++it)
-    {
-        Guild *guild = it->second;
-        if (guild->getName() == name)
-            return guild;
-    }
-    return 0;
+    return mGuildsByName.findByName(name);
 }
 
 bool GuildManager::doesExist(const std::string &name) const
@@ -26,6 +26,8 @@
 #include <vector>
 #include <map>
 
+#include "utils/nameindex.h"
+
 class Guild;
 class ChatClient;
 
@@ -105,6 +107,7 @@ class GuildManager
 
     private:
         std::map<int, Guild*> mGuilds;
+        utils::NameIndex<Guild *> mGuildsByName;
 };
 
 extern GuildManager *guildManager;
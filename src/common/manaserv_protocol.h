@@ -269,9 +269,10 @@ enum {
     AGMSG_REDIRECT_RESPONSE     = 0x0531, // D id, B*32 token, S game address, W game port
     GAMSG_PLAYER_RECONNECT      = 0x0532, // D id, B*32 token
     GAMSG_PLAYER_SYNC           = 0x0533, // serialised sync data
-    GAMSG_SET_VAR_CHR           = 0x0540, // D id, S name, S value
-    GAMSG_GET_VAR_CHR           = 0x0541, // D id, S name
-    AGMSG_GET_VAR_CHR_RESPONSE  = 0x0542, // D id, S name, S value
+    GAMSG_PLAYER_SYNC_COMPRESSED = 0x0534, // D length, deflated GAMSG_PLAYER_SYNC message
+    //reserved GAMSG_SET_VAR_CHR           = 0x0540, // D id, S name, S value
+    //reserved GAMSG_GET_VAR_CHR           = 0x0541, // D id, S name
+    //reserved AGMSG_GET_VAR_CHR_RESPONSE  = 0x0542, // D id, S name, S value
     //reserved GAMSG_SET_VAR_ACC           = 0x0543, // D charid, S name, S value
     //reserved GAMSG_GET_VAR_ACC           = 0x0544, // D charid, S name
     //reserved AGMSG_GET_VAR_ACC_RESPONSE  = 0x0545, // D charid, S name, S value
@@ -330,7 +331,8 @@ enum {
 enum {
     SYNC_CHARACTER_POINTS    = 0x01,       // D charId, D charPoints, D corrPoints
     SYNC_CHARACTER_ATTRIBUTE = 0x02,       // D charId, D attrId, DF base, DF mod
-    SYNC_ONLINE_STATUS       = 0x04        // D charId, B 0 = offline, 1 = online
+    SYNC_ONLINE_STATUS       = 0x04,       // D charId, B 0 = offline, 1 = online
+    SYNC_CHARACTER_VAR       = 0x08        // D charId, S name, S value
 };
 
 // Login specific return values
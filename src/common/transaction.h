@@ -21,11 +21,21 @@
 #ifndef TRANSACTION_H
 #define TRANSACTION_H
 
+#include <ctime>
+#include <string>
+
 struct Transaction
 {
+    Transaction()
+        : mAction(0)
+        , mCharacterId(0)
+        , mTime(0)
+    {}
+
     unsigned mAction;
     unsigned mCharacterId;
     std::string mMessage;
+    time_t mTime;           /**< When it happened, 0 means "now". */
 };
 
 enum
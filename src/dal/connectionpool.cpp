@@ -0,0 +1,207 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "connectionpool.h"
+
+#include "dataprovider.h"
+#include "dataproviderfactory.h"
+
+#include "utils/logger.h"
+
+namespace dal
+{
+
+ConnectionPool::ConnectionPool(const std::string &name,
+                               const std::string &configPrefix,
+                               unsigned size, int checkInterval)
+    : mName(name)
+    , mConfigPrefix(configPrefix)
+    , mSize(size > 0 ? size : 1)
+    , mCheckInterval(checkInterval)
+    , mIsOpen(false)
+    , mInUse(0)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    close();
+
+    if (mInUse > 0)
+        LOG_WARN("Connection pool " << mName << ": destroyed with "
+                 << mInUse << " connection(s) in use.");
+}
+
+void ConnectionPool::open()
+{
+    if (mIsOpen)
+        return;
+
+    mIsOpen = true;
+    try
+    {
+        while (mIdle.size() < mSize)
+        {
+            Idle idle = { connect(), time(0) };
+            mIdle.push_back(idle);
+        }
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+
+    LOG_INFO("Connection pool " << mName << ": " << mSize
+             << " connection(s) open.");
+}
+
+void ConnectionPool::close()
+{
+    for (std::vector<Idle>::iterator it = mIdle.begin(),
+         it_end = mIdle.end(); it != it_end; ++it)
+    {
+        destroy(it->db);
+    }
+    mIdle.clear();
+    mIsOpen = false;
+}
+
+DataProvider *ConnectionPool::acquire()
+{
+    DataProvider *db = 0;
+
+    if (!mIdle.empty())
+    {
+        // The most recently used connection is the least likely to have
+        // been dropped by the server.
+        const Idle idle = mIdle.back();
+        mIdle.pop_back();
+        db = idle.db;
+
+        if (time(0) - idle.since >= mCheckInterval && !check(db))
+        {
+            LOG_WARN("Connection pool " << mName << ": reconnecting.");
+            destroy(db);
+            db = 0;
+        }
+    }
+    else if (mIsOpen)
+    {
+        LOG_DEBUG("Connection pool " << mName << ": all " << mSize
+                  << " connection(s) in use, opening another one.");
+    }
+
+    if (!db)
+        db = connect();
+
+    ++mInUse;
+    return db;
+}
+
+void ConnectionPool::release(DataProvider *db)
+{
+    --mInUse;
+
+    if (db->inTransaction())
+    {
+        LOG_WARN("Connection pool " << mName << ": rolling back a "
+                 "transaction left open.");
+        try
+        {
+            db->rollbackTransaction();
+        }
+        catch (const std::exception &)
+        {
+            destroy(db);
+            return;
+        }
+    }
+
+    if (!mIsOpen || mIdle.size() >= mSize)
+    {
+        destroy(db);
+        return;
+    }
+
+    Idle idle = { db, time(0) };
+    mIdle.push_back(idle);
+}
+
+DataProvider *ConnectionPool::revalidate(DataProvider *db)
+{
+    if (check(db))
+        return db;
+
+    LOG_WARN("Connection pool " << mName << ": reconnecting.");
+    DataProvider *replacement = connect();
+    destroy(db);
+    return replacement;
+}
+
+DataProvider *ConnectionPool::connect()
+{
+    DataProvider *db = DataProviderFactory::createDataProvider();
+    db->setConfigPrefix(mConfigPrefix);
+
+    try
+    {
+        db->connect();
+    }
+    catch (...)
+    {
+        delete db;
+        throw;
+    }
+    return db;
+}
+
+bool ConnectionPool::check(DataProvider *db)
+{
+    if (!db->isConnected())
+        return false;
+
+    try
+    {
+        db->execSql("SELECT 1", true);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        LOG_WARN("Connection pool " << mName << ": connection check failed: "
+                 << e.what());
+        return false;
+    }
+}
+
+void ConnectionPool::destroy(DataProvider *db)
+{
+    try
+    {
+        db->disconnect();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_WARN("Connection pool " << mName << ": " << e.what());
+    }
+    delete db;
+}
+
+} // namespace dal
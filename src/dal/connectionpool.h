@@ -0,0 +1,152 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace dal
+{
+
+class DataProvider;
+
+/**
+ * Keeps a number of connections to one database open, and hands them out
+ * one at a time.
+ *
+ * A connection is checked before it is handed out when it stayed idle for
+ * too long, and reconnected when the check fails. When all the connections
+ * are in use an extra one is opened, and closed again when it comes back.
+ */
+class ConnectionPool
+{
+    public:
+        /**
+         * @param name          the name used in the logs.
+         * @param configPrefix  prefix of the connection options, so that
+         *                      "replica_" reads "replica_mysql_hostname" and
+         *                      so on. Empty for the main database.
+         * @param size          the number of connections kept open.
+         * @param checkInterval seconds a connection may stay idle before
+         *                      being checked again.
+         */
+        ConnectionPool(const std::string &name,
+                       const std::string &configPrefix,
+                       unsigned size, int checkInterval);
+
+        ~ConnectionPool();
+
+        /**
+         * Opens the connections.
+         *
+         * @exception DbConnectionFailure if a connection fails.
+         */
+        void open();
+
+        /**
+         * Closes the idle connections. Connections still in use are closed
+         * when they are released.
+         */
+        void close();
+
+        bool isOpen() const
+        { return mIsOpen; }
+
+        /**
+         * Takes a working connection out of the pool.
+         *
+         * @exception DbConnectionFailure if no connection could be made.
+         */
+        DataProvider *acquire();
+
+        /**
+         * Gives back a connection taken with acquire(). A transaction left
+         * open is rolled back.
+         */
+        void release(DataProvider *db);
+
+        /**
+         * Checks a connection taken with acquire() and kept for a long time,
+         * and replaces it with a new one when the check fails.
+         *
+         * @return the connection to use from now on.
+         * @exception DbConnectionFailure if no new connection could be made,
+         *            the given connection is then still the one to use.
+         */
+        DataProvider *revalidate(DataProvider *db);
+
+    private:
+        ConnectionPool(const ConnectionPool &) = delete;
+        ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+        DataProvider *connect();
+        bool check(DataProvider *db);
+        void destroy(DataProvider *db);
+
+        struct Idle
+        {
+            DataProvider *db;
+            time_t since;
+        };
+
+        std::string mName;
+        std::string mConfigPrefix;
+        unsigned mSize;
+        int mCheckInterval;
+        bool mIsOpen;
+
+        std::vector<Idle> mIdle;    /**< Most recently released last */
+        unsigned mInUse;
+};
+
+/**
+ * Takes a connection out of a pool for the lifetime of this object.
+ */
+class PooledConnection
+{
+    public:
+        PooledConnection(ConnectionPool &pool)
+            : mPool(pool)
+            , mDb(pool.acquire())
+        {}
+
+        ~PooledConnection()
+        { mPool.release(mDb); }
+
+        DataProvider *operator->() const
+        { return mDb; }
+
+        DataProvider *get() const
+        { return mDb; }
+
+    private:
+        PooledConnection(const PooledConnection &) = delete;
+        PooledConnection &operator=(const PooledConnection &) = delete;
+
+        ConnectionPool &mPool;
+        DataProvider *mDb;
+};
+
+} // namespace dal
+
+#endif // CONNECTION_POOL_H
@@ -21,6 +21,7 @@
 #include "dataprovider.h"
 
 #include "utils/logger.h"
+#include "utils/metrics.h"
 
 namespace dal
 {
@@ -88,4 +89,13 @@ std::string DataProvider::getDbName() const
     return mDbName;
 }
 
+Metrics::Histogram &DataProvider::getQueryHistogram()
+{
+    static Metrics::Histogram &histogram =
+            Metrics::histogram("manaserv_db_query_seconds",
+                               "Time spent executing database queries.",
+                               std::string(), 1e-6);
+    return histogram;
+}
+
 } // namespace dal
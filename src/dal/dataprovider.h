@@ -27,6 +27,11 @@
 
 #include "recordset.h"
 
+namespace Metrics
+{
+    class Histogram;
+}
+
 namespace dal
 {
 
@@ -88,6 +93,13 @@ class DataProvider
         bool isConnected() const
             throw();
 
+        /**
+         * Sets the prefix of the options read by connect(), so that another
+         * database can be configured next to the main one.
+         */
+        void setConfigPrefix(const std::string &prefix)
+        { mConfigPrefix = prefix; }
+
         /**
          * Get the name of the database backend.
          *
@@ -178,7 +190,9 @@ class DataProvider
         virtual unsigned getLastId() const = 0;
 
         /**
-         * Prepare SQL statement
+         * Prepare SQL statement. Statements are kept by SQL text and only
+         * parsed the first time, so values should be bound rather than
+         * written in the text.
          */
         virtual bool prepareSql(const std::string &sql) = 0;
 
@@ -203,7 +217,21 @@ class DataProvider
          */
         virtual void bindValue(int place, int value) = 0;
 
+        /**
+         * Bind Value (Double)
+         * @param place - which parameter to bind to
+         * @param value - the double to bind
+         */
+        virtual void bindValue(int place, double value) = 0;
+
     protected:
+        /**
+         * Returns the histogram of the time spent executing queries, for
+         * the backends to record into.
+         */
+        static Metrics::Histogram &getQueryHistogram();
+
+        std::string mConfigPrefix; /**< prefix of the connection options */
         std::string mDbName;  /**< the database name */
         bool mIsConnected;    /**< the connection status */
         std::string mSql;     /**< cache the last SQL query */
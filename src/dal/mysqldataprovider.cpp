@@ -22,6 +22,10 @@
 
 #include "dalexcept.h"
 
+#include "utils/metrics.h"
+
+#include <algorithm>
+
 namespace dal
 {
 
@@ -41,7 +45,8 @@ MySqlDataProvider::MySqlDataProvider()
     throw()
         : mDb(0),
           mStmt(0),
-          mBind(0),
+          mStatements(releaseStatement),
+          mModifiedRows(0),
           mInTransaction(false)
 {
 }
@@ -77,15 +82,20 @@ void MySqlDataProvider::connect()
 
     // retrieve configuration from config file
     const std::string hostname
-        = Configuration::getValue(CFGPARAM_MYSQL_HOST, CFGPARAM_MYSQL_HOST_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_MYSQL_HOST,
+                                  CFGPARAM_MYSQL_HOST_DEF);
     const std::string dbName
-        = Configuration::getValue(CFGPARAM_MYSQL_DB, CFGPARAM_MYSQL_DB_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_MYSQL_DB,
+                                  CFGPARAM_MYSQL_DB_DEF);
     const std::string username
-        = Configuration::getValue(CFGPARAM_MYSQL_USER, CFGPARAM_MYSQL_USER_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_MYSQL_USER,
+                                  CFGPARAM_MYSQL_USER_DEF);
     const std::string password
-        = Configuration::getValue(CFGPARAM_MYSQL_PWD, CFGPARAM_MYSQL_PWD_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_MYSQL_PWD,
+                                  CFGPARAM_MYSQL_PWD_DEF);
     const unsigned tcpPort
-        = Configuration::getValue(CFGPARAM_MYSQL_PORT, CFGPARAM_MYSQL_PORT_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_MYSQL_PORT,
+                                  CFGPARAM_MYSQL_PORT_DEF);
 
     // allocate and initialize a new MySQL object suitable
     // for mysql_real_connect().
@@ -120,8 +130,8 @@ void MySqlDataProvider::connect()
     // Save the Db Name.
     mDbName = dbName;
 
-    // Initialize statement structure
-    mStmt = mysql_stmt_init(mDb);
+    mStatements.setCapacity(
+            Configuration::getValue("db_statementCacheSize", 64));
 
     mIsConnected = true;
     LOG_INFO("Connection to mySQL was sucessfull.");
@@ -138,6 +148,8 @@ const RecordSet &MySqlDataProvider::execSql(const std::string& sql,
 
     LOG_DEBUG("MySqlDataProvider::execSql Performing SQL query: " << sql);
 
+    Metrics::ScopedTimer timer(getQueryHistogram());
+
     // do something only if the query is different from the previous
     // or if the cache must be refreshed
     // otherwise just return the recordset from cache.
@@ -149,6 +161,8 @@ const RecordSet &MySqlDataProvider::execSql(const std::string& sql,
         if (mysql_query(mDb, sql.c_str()) != 0)
             throw DbSqlQueryExecFailure(mysql_error(mDb));
 
+        mModifiedRows = mysql_affected_rows(mDb);
+
         if (mysql_field_count(mDb) > 0)
         {
             MYSQL_RES* res;
@@ -194,19 +208,17 @@ void MySqlDataProvider::disconnect()
     if (!mIsConnected)
         return;
 
+    // Close the prepared statements while the connection is still open.
+    mStatements.clear();
+    mStmt = 0;
+
     // mysql_close() closes the connection and deallocates the connection
     // handle allocated by mysql_init().
     mysql_close(mDb);
 
-    // Clean possible statement.
-    mysql_stmt_close(mStmt);
-
     // deinitialize the MySQL client library.
     mysql_library_end();
 
-    // Clean potential active binds
-    cleanBinds();
-
     mDb = 0;
     mIsConnected = false;
 }
@@ -324,7 +336,7 @@ unsigned MySqlDataProvider::getModifiedRows() const
         throw std::runtime_error(error);
     }
 
-    const my_ulonglong affected = mysql_affected_rows(mDb);
+    const my_ulonglong affected = mModifiedRows;
 
     if (affected > INT_MAX)
         throw std::runtime_error(
@@ -356,21 +368,51 @@ unsigned MySqlDataProvider::getLastId() const
     return (unsigned) lastId;
 }
 
+void MySqlDataProvider::releaseStatement(Statement *statement)
+{
+    mysql_stmt_close(statement->stmt);
+    delete statement;
+}
+
 bool MySqlDataProvider::prepareSql(const std::string &sql)
 {
     if (!mIsConnected)
         return false;
 
-    LOG_DEBUG("MySqlDataProvider::prepareSql Preparing SQL statement: " << sql);
+    mStmt = mStatements.find(sql);
+    if (mStmt)
+    {
+        // Reuse the statement prepared earlier, with fresh parameters
+        mysql_stmt_reset(mStmt->stmt);
+        std::fill(mStmt->binds.begin(), mStmt->binds.end(), MYSQL_BIND());
+        return true;
+    }
 
-    cleanBinds();
+    LOG_DEBUG("MySqlDataProvider::prepareSql Preparing SQL statement: " << sql);
 
-    if (mysql_stmt_prepare(mStmt, sql.c_str(), sql.size()) != 0)
+    MYSQL_STMT *stmt = mysql_stmt_init(mDb);
+    if (!stmt)
         return false;
 
-    // Allocate bind memory now that the prepared state is done.
-    mBind = new MYSQL_BIND[(int)mysql_stmt_param_count(mStmt)];
+    if (mysql_stmt_prepare(stmt, sql.c_str(), sql.size()) != 0)
+    {
+        LOG_ERROR("MySqlDataProvider::prepareSql: " << mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return false;
+    }
 
+    // Allocate the parameter storage now that the prepared state is done.
+    const unsigned paramCount = mysql_stmt_param_count(stmt);
+    Statement *statement = new Statement;
+    statement->stmt = stmt;
+    statement->binds.resize(paramCount);
+    statement->strings.resize(paramCount);
+    statement->lengths.resize(paramCount);
+    statement->ints.resize(paramCount);
+    statement->doubles.resize(paramCount);
+
+    mStatements.insert(sql, statement);
+    mStmt = statement;
     return true;
 }
 
@@ -379,36 +421,40 @@ const RecordSet &MySqlDataProvider::processSql()
     if (!mIsConnected)
         throw std::runtime_error("not connected to database");
 
+    Metrics::ScopedTimer timer(getQueryHistogram());
+
     // Since we'll have to return something in all cases,
     // we clear the result member first.
     mRecordSet.clear();
+    mModifiedRows = 0;
 
-    if (!mBind)
+    if (!mStmt)
     {
         LOG_ERROR("MySqlDataProvider::processSql: "
-                  "No bind done before processing.");
+                  "No statement prepared before processing.");
         return mRecordSet;
     }
 
-    if (mysql_stmt_bind_param(mStmt, mBind))
+    if (!mStmt->binds.empty() &&
+        mysql_stmt_bind_param(mStmt->stmt, &mStmt->binds[0]))
     {
         LOG_ERROR("MySqlDataProvider::processSql Bind params failed: "
-                  << mysql_stmt_error(mStmt));
+                  << mysql_stmt_error(mStmt->stmt));
         return mRecordSet;
     }
 
-    if (mysql_stmt_field_count(mStmt) > 0)
+    if (mysql_stmt_field_count(mStmt->stmt) > 0)
     {
         MYSQL_BIND* resultBind;
         MYSQL_RES* res;
 
-        if (mysql_stmt_execute(mStmt))
+        if (mysql_stmt_execute(mStmt->stmt))
         {
             LOG_ERROR("MySqlDataProvider::processSql Execute failed: "
-                      << mysql_stmt_error(mStmt));
+                      << mysql_stmt_error(mStmt->stmt));
         }
 
-        res = mysql_stmt_result_metadata(mStmt);
+        res = mysql_stmt_result_metadata(mStmt->stmt);
 
         // set the field names.
         unsigned nFields = mysql_num_fields(res);
@@ -428,10 +474,10 @@ const RecordSet &MySqlDataProvider::processSql()
             resultBind[i].error = new my_bool;
         }
 
-        if (mysql_stmt_bind_result(mStmt, resultBind))
+        if (mysql_stmt_bind_result(mStmt->stmt, resultBind))
         {
             LOG_ERROR("MySqlDataProvider::processSql Bind result failed: "
-                      << mysql_stmt_error(mStmt));
+                      << mysql_stmt_error(mStmt->stmt));
         }
 
         for (i = 0; i < nFields; ++i)
@@ -440,11 +486,11 @@ const RecordSet &MySqlDataProvider::processSql()
         mRecordSet.setColumnHeaders(fieldNames);
 
         // store the result of the query.
-        if (mysql_stmt_store_result(mStmt))
-            throw DbSqlQueryExecFailure(mysql_stmt_error(mStmt));
+        if (mysql_stmt_store_result(mStmt->stmt))
+            throw DbSqlQueryExecFailure(mysql_stmt_error(mStmt->stmt));
 
         // populate the RecordSet.
-        while (!mysql_stmt_fetch(mStmt))
+        while (!mysql_stmt_fetch(mStmt->stmt))
         {
             Row r;
 
@@ -458,62 +504,81 @@ const RecordSet &MySqlDataProvider::processSql()
     }
     else
     {
-        if (mysql_stmt_execute(mStmt))
+        if (mysql_stmt_execute(mStmt->stmt))
         {
             LOG_ERROR("MySqlDataProvider::processSql Execute failed: "
-                      << mysql_stmt_error(mStmt));
+                      << mysql_stmt_error(mStmt->stmt));
         }
     }
 
+    mModifiedRows = mysql_stmt_affected_rows(mStmt->stmt);
+
     // Free memory
-    mysql_stmt_free_result(mStmt);
+    mysql_stmt_free_result(mStmt->stmt);
 
     return mRecordSet;
 }
 
-void MySqlDataProvider::bindValue(int place, const std::string &value)
+MYSQL_BIND *MySqlDataProvider::getBind(int place)
 {
-    unsigned long* size = new unsigned long;
-    *size = value.size();
-    MYSQL_BIND* bind = new MYSQL_BIND;
-    bind->buffer_type= MYSQL_TYPE_STRING;
-    bind->buffer= (void*) value.c_str();
-    bind->buffer_length= value.size();
-    bind->length = size;
-    bind->is_null = 0;
+    if (!mStmt)
+    {
+        LOG_ERROR("MySqlDataProvider::bindValue: "
+                  "Attempted to use an unprepared bind!");
+        return 0;
+    }
 
-    bindValue(place, bind);
+    if (place <= 0 || place > (int)mStmt->binds.size())
+    {
+        LOG_ERROR("MySqlDataProvider::bindValue: "
+                  "Attempted bind index out of range");
+        return 0;
+    }
+
+    return &mStmt->binds[place - 1];
 }
 
-void MySqlDataProvider::bindValue(int place, int value)
+void MySqlDataProvider::bindValue(int place, const std::string &value)
 {
-    MYSQL_BIND* bind = new MYSQL_BIND;
-    bind->buffer_type= MYSQL_TYPE_LONG;
-    bind->buffer= &value;
-    bind->is_null = 0;
+    MYSQL_BIND *bind = getBind(place);
+    if (!bind)
+        return;
 
-    bindValue(place, bind);
+    std::string &buffer = mStmt->strings[place - 1];
+    unsigned long &length = mStmt->lengths[place - 1];
+    buffer = value;
+    length = buffer.size();
+    bind->buffer_type = MYSQL_TYPE_STRING;
+    bind->buffer = (void*) buffer.c_str();
+    bind->buffer_length = length;
+    bind->length = &length;
+    bind->is_null = 0;
 }
 
-void MySqlDataProvider::bindValue(int place, MYSQL_BIND* bind)
+void MySqlDataProvider::bindValue(int place, int value)
 {
-    if (!mBind)
-        LOG_ERROR("MySqlDataProvider::bindValue: "
-                  "Attempted to use an unprepared bind!");
-    else if (place > 0 && place <= (int)mysql_stmt_param_count(mStmt))
-        mBind[place - 1] = *bind;
-    else
-        LOG_ERROR("MySqlDataProvider::bindValue: "
-                  "Attempted bind index out of range");
+    MYSQL_BIND *bind = getBind(place);
+    if (!bind)
+        return;
+
+    int &buffer = mStmt->ints[place - 1];
+    buffer = value;
+    bind->buffer_type = MYSQL_TYPE_LONG;
+    bind->buffer = &buffer;
+    bind->is_null = 0;
 }
 
-void MySqlDataProvider::cleanBinds()
+void MySqlDataProvider::bindValue(int place, double value)
 {
-    if (mBind)
-    {
-        delete[] mBind;
-        mBind = 0;
-    }
+    MYSQL_BIND *bind = getBind(place);
+    if (!bind)
+        return;
+
+    double &buffer = mStmt->doubles[place - 1];
+    buffer = value;
+    bind->buffer_type = MYSQL_TYPE_DOUBLE;
+    bind->buffer = &buffer;
+    bind->is_null = 0;
 }
 
 } // namespace dal
@@ -29,8 +29,10 @@
 #endif
 #include <mysql/mysql.h>
 #include <climits>
+#include <vector>
 
 #include "dataprovider.h"
+#include "statementcache.h"
 #include "common/configuration.h"
 #include "utils/logger.h"
 
@@ -167,16 +169,35 @@ class MySqlDataProvider: public DataProvider
          */
         void bindValue(int place, int value);
 
-    private:
         /**
-         * Bind Value (MYSQL_BIND*)
+         * Bind Value (Double)
          * @param place - which parameter to bind to
-         * @param value - the MySQL bind structure itself
+         * @param value - the double to bind
+         */
+        void bindValue(int place, double value);
+
+    private:
+        /**
+         * A prepared statement along with the storage of its parameters,
+         * which has to stay valid until the statement is executed.
          */
-        void bindValue(int place, MYSQL_BIND* bind);
+        struct Statement
+        {
+            MYSQL_STMT *stmt;
+            std::vector<MYSQL_BIND> binds;
+            std::vector<std::string> strings;
+            std::vector<unsigned long> lengths;
+            std::vector<int> ints;
+            std::vector<double> doubles;
+        };
+
+        static void releaseStatement(Statement *statement);
 
-        /** Clean potential binds */
-        void cleanBinds();
+        /**
+         * Returns the bind structure of the given parameter of the current
+         * statement, or null if there is no such parameter.
+         */
+        MYSQL_BIND *getBind(int place);
 
         /** defines the name of the hostname config parameter */
         static const std::string CFGPARAM_MYSQL_HOST;
@@ -204,9 +225,11 @@ class MySqlDataProvider: public DataProvider
         /** The handle to the database connection */
         MYSQL *mDb;
         /** The prepared statement to process */
-        MYSQL_STMT *mStmt;
-        /** The Bind structure used in prepared statement */
-        MYSQL_BIND* mBind;
+        Statement *mStmt;
+        /** The statements prepared so far, by SQL text */
+        StatementCache<Statement *> mStatements;
+        /** Rows changed by the last query or statement */
+        my_ulonglong mModifiedRows;
         /** Tells whether we're in the middle of a transaction */
         bool mInTransaction;
 };
@@ -21,6 +21,8 @@
 #include "pqdataprovider.h"
 #include "dalexcept.h"
 
+#include "utils/metrics.h"
+
 namespace dal
 {
 
@@ -85,6 +87,8 @@ const RecordSet &PqDataProvider::execSql(const std::string& sql,
     if (!mIsConnected)
         throw std::runtime_error("not connected to database");
 
+    Metrics::ScopedTimer timer(getQueryHistogram());
+
     if (refresh || (sql != mSql))
     {
         mRecordSet.clear();
@@ -24,7 +24,12 @@
 
 #include "common/configuration.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
+#include "utils/string.h"
 
+#include <chrono>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <limits.h>
 
@@ -40,10 +45,24 @@ namespace dal
 const std::string SqLiteDataProvider::CFGPARAM_SQLITE_DB     = "sqlite_database";
 const std::string SqLiteDataProvider::CFGPARAM_SQLITE_DB_DEF = "mana.db";
 
+/**
+ * The databases with a checkpoint thread, so that pooled connections to the
+ * same file don't start one each.
+ */
+static std::set<std::string> checkpointedDatabases;
+static std::mutex checkpointedDatabasesMutex;
+
+static void finalizeStatement(sqlite3_stmt *statement)
+{
+    sqlite3_finalize(statement);
+}
+
 SqLiteDataProvider::SqLiteDataProvider()
     throw()
         : mDb(0)
         , mStmt(0)
+        , mStatements(finalizeStatement)
+        , mStopCheckpointer(false)
 {
 }
 
@@ -80,7 +99,8 @@ void SqLiteDataProvider::connect()
 {
     // get configuration parameter for sqlite
     const std::string dbName
-        = Configuration::getValue(CFGPARAM_SQLITE_DB, CFGPARAM_SQLITE_DB_DEF);
+        = Configuration::getValue(mConfigPrefix + CFGPARAM_SQLITE_DB,
+                                  CFGPARAM_SQLITE_DB_DEF);
 
     LOG_INFO("Trying to connect with SQLite database file '"
         << dbName << "'");
@@ -108,9 +128,25 @@ void SqLiteDataProvider::connect()
     // transaction failures due to locked databases are very rare.
     sqlite3_busy_timeout(mDb, 1000);
 
+    mStatements.setCapacity(
+            Configuration::getValue("db_statementCacheSize", 64));
+
     // Save the Db Name.
     mDbName = dbName;
 
+    if (applySettings())
+    {
+        // Checkpoint from another thread, rather than at the end of the
+        // commit that happens to fill the log.
+        const int interval =
+                Configuration::getValue("sqlite_checkpointInterval", 1000);
+        if (interval > 0 && sqlite3_threadsafe() &&
+            startCheckpointer(interval))
+        {
+            pragma("PRAGMA wal_autocheckpoint = 0");
+        }
+    }
+
     mIsConnected = true;
     LOG_INFO("Connection to database successful.");
 }
@@ -126,6 +162,8 @@ const RecordSet &SqLiteDataProvider::execSql(const std::string& sql,
 
     LOG_DEBUG("Performing SQL query: " << sql);
 
+    Metrics::ScopedTimer timer(getQueryHistogram());
+
     // do something only if the query is different from the previous
     // or if the cache must be refreshed
     // otherwise just return the recordset from cache.
@@ -194,6 +232,12 @@ void SqLiteDataProvider::disconnect()
     if (!isConnected())
         return;
 
+    stopCheckpointer();
+
+    // The connection can't be closed while statements are left
+    mStatements.clear();
+    mStmt = 0;
+
     // sqlite3_close() closes the connection and deallocates the connection
     // handle.
     if (sqlite3_close(mDb) != SQLITE_OK)
@@ -352,19 +396,170 @@ unsigned SqLiteDataProvider::getLastId() const
     return (unsigned) lastId;
 }
 
+std::string SqLiteDataProvider::pragma(const std::string &statement)
+{
+    char **result;
+    int nRows;
+    int nCols;
+    char *errMsg;
+
+    std::string value;
+    if (sqlite3_get_table(mDb, statement.c_str(), &result, &nRows, &nCols,
+                          &errMsg) != SQLITE_OK)
+    {
+        LOG_WARN("SQLite: " << statement << " failed: " << errMsg);
+    }
+    else if (nRows > 0 && nCols > 0 && result[nCols])
+    {
+        // The first row holds the column names
+        value = result[nCols];
+    }
+
+    sqlite3_free_table(result);
+    sqlite3_free(errMsg);
+    return value;
+}
+
+bool SqLiteDataProvider::applySettings()
+{
+    const std::string journalMode =
+            Configuration::getValue("sqlite_journalMode", "WAL");
+    const std::string synchronous =
+            Configuration::getValue("sqlite_synchronous", "NORMAL");
+    const int cacheSize = Configuration::getValue("sqlite_cacheSize", 8192);
+    const int mmapSize = Configuration::getValue("sqlite_mmapSize", 64);
+
+    const std::string mode = pragma("PRAGMA journal_mode = " + journalMode);
+    if (utils::compareStrI(mode, journalMode) != 0)
+    {
+        LOG_WARN("SQLite: journal mode " << journalMode << " refused, "
+                 "using " << mode);
+    }
+
+    pragma("PRAGMA synchronous = " + synchronous);
+
+    // A negative size is in KiB rather than in pages
+    std::ostringstream cache;
+    cache << "PRAGMA cache_size = -" << cacheSize;
+    pragma(cache.str());
+
+    std::ostringstream mmap;
+    mmap << "PRAGMA mmap_size = " << (sqlite3_int64) mmapSize * 1024 * 1024;
+    pragma(mmap.str());
+
+    LOG_INFO("SQLite: journal mode " << mode << ", synchronous "
+             << synchronous << ", " << cacheSize << " KiB cache, "
+             << mmapSize << " MiB memory map.");
+
+    return utils::compareStrI(mode, "wal") == 0;
+}
+
+bool SqLiteDataProvider::startCheckpointer(int interval)
+{
+    {
+        std::lock_guard<std::mutex> lock(checkpointedDatabasesMutex);
+        if (!checkpointedDatabases.insert(mDbName).second)
+            return false;
+    }
+
+    // Opened here, so that the automatic checkpoints stay enabled when the
+    // thread could not checkpoint anything
+    sqlite3 *db;
+    if (sqlite3_open_v2(mDbName.c_str(), &db, SQLITE_OPEN_READWRITE,
+                        nullptr) != SQLITE_OK)
+    {
+        LOG_ERROR("SQLite: the checkpoint thread could not open the "
+                  "database: " << sqlite3_errmsg(db));
+        sqlite3_close(db);
+
+        std::lock_guard<std::mutex> lock(checkpointedDatabasesMutex);
+        checkpointedDatabases.erase(mDbName);
+        return false;
+    }
+
+    mStopCheckpointer = false;
+    mCheckpointer = std::thread(&SqLiteDataProvider::runCheckpointer, this,
+                                db, interval);
+    return true;
+}
+
+void SqLiteDataProvider::stopCheckpointer()
+{
+    if (!mCheckpointer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mCheckpointerMutex);
+        mStopCheckpointer = true;
+    }
+    mCheckpointerWake.notify_one();
+    mCheckpointer.join();
+
+    std::lock_guard<std::mutex> lock(checkpointedDatabasesMutex);
+    checkpointedDatabases.erase(mDbName);
+}
+
+void SqLiteDataProvider::runCheckpointer(sqlite3 *db, int interval)
+{
+    std::unique_lock<std::mutex> lock(mCheckpointerMutex);
+    while (!mStopCheckpointer)
+    {
+        mCheckpointerWake.wait_for(lock, std::chrono::milliseconds(interval));
+        if (mStopCheckpointer)
+            break;
+
+        lock.unlock();
+
+        // A passive checkpoint copies what it can without waiting for the
+        // readers and writers of the main connection.
+        int logFrames = 0;
+        int checkpointed = 0;
+        if (sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE,
+                                      &logFrames, &checkpointed) != SQLITE_OK)
+        {
+            LOG_WARN("SQLite: checkpoint failed: " << sqlite3_errmsg(db));
+        }
+        else if (logFrames > 0)
+        {
+            LOG_DEBUG("SQLite: checkpointed " << checkpointed << " of "
+                      << logFrames << " log frames.");
+        }
+
+        lock.lock();
+    }
+
+    sqlite3_close(db);
+}
+
 bool SqLiteDataProvider::prepareSql(const std::string &sql)
 {
     if (!mIsConnected)
         return false;
 
-    LOG_DEBUG("Preparing SQL statement: "<<sql);
-
     mRecordSet.clear();
 
+    if (sqlite3_stmt *statement = mStatements.find(sql))
+    {
+        // Reuse the statement parsed earlier, with fresh parameters
+        sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+        mStmt = statement;
+        return true;
+    }
+
+    LOG_DEBUG("Preparing SQL statement: "<<sql);
+
+    mStmt = 0;
+    sqlite3_stmt *statement;
     if (sqlite3_prepare_v2(mDb, sql.c_str(), sql.size(),
-            &mStmt, nullptr) != SQLITE_OK)
+            &statement, nullptr) != SQLITE_OK)
+    {
+        LOG_ERROR("Error in SQL: " << sql << "\n" << sqlite3_errmsg(mDb));
         return false;
+    }
 
+    mStatements.insert(sql, statement);
+    mStmt = statement;
     return true;
 }
 
@@ -373,6 +568,11 @@ const RecordSet &SqLiteDataProvider::processSql()
     if (!mIsConnected)
         throw std::runtime_error("not connected to database");
 
+    if (!mStmt)
+        throw std::runtime_error("no statement prepared");
+
+    Metrics::ScopedTimer timer(getQueryHistogram());
+
     int totalCols = sqlite3_column_count(mStmt);
 
     // ensure we set column headers before adding a row
@@ -383,7 +583,8 @@ const RecordSet &SqLiteDataProvider::processSql()
     }
     mRecordSet.setColumnHeaders(fieldNames);
 
-    while (sqlite3_step(mStmt) == SQLITE_ROW)
+    int result;
+    while ((result = sqlite3_step(mStmt)) == SQLITE_ROW)
     {
         Row r;
         for (int col = 0; col < totalCols; ++col)
@@ -395,14 +596,20 @@ const RecordSet &SqLiteDataProvider::processSql()
         mRecordSet.add(r);
     }
 
-    sqlite3_finalize(mStmt);
+    if (result != SQLITE_DONE)
+        LOG_ERROR("Error in SQL: " << sqlite3_sql(mStmt) << "\n"
+                  << sqlite3_errmsg(mDb));
+
+    // Keep the statement for the next time, but release its locks now
+    sqlite3_reset(mStmt);
 
     return mRecordSet;
 }
 
 void SqLiteDataProvider::bindValue(int place, const std::string &value)
 {
-    sqlite3_bind_text(mStmt, place, value.c_str(), value.size(), SQLITE_STATIC);
+    sqlite3_bind_text(mStmt, place, value.c_str(), value.size(),
+                      SQLITE_TRANSIENT);
 }
 
 void SqLiteDataProvider::bindValue(int place, int value)
@@ -410,4 +617,9 @@ void SqLiteDataProvider::bindValue(int place, int value)
     sqlite3_bind_int(mStmt, place, value);
 }
 
+void SqLiteDataProvider::bindValue(int place, double value)
+{
+    sqlite3_bind_double(mStmt, place, value);
+}
+
 } // namespace dal
@@ -22,9 +22,13 @@
 #define SQLITE_DATA_PROVIDER_H
 
 #include "dataprovider.h"
+#include "statementcache.h"
 
+#include <condition_variable>
 #include <iosfwd>
+#include <mutex>
 #include <sqlite3.h>
+#include <thread>
 
 namespace dal
 {
@@ -151,7 +155,38 @@ class SqLiteDataProvider: public DataProvider
          */
         void bindValue(int place, int value);
 
+        /**
+         * Bind Value (Double)
+         * @param place - which parameter to bind to
+         * @param value - the double to bind
+         */
+        void bindValue(int place, double value);
+
     private:
+        /**
+         * Applies the journal, synchronous, cache and memory map settings
+         * read from the configuration to the new connection.
+         *
+         * @return whether the database is in write-ahead log mode.
+         */
+        bool applySettings();
+
+        /**
+         * Executes a pragma and returns its first result, if any.
+         */
+        std::string pragma(const std::string &statement);
+
+        /**
+         * Starts the thread moving the write-ahead log into the database,
+         * so that the main loop never waits for a checkpoint.
+         *
+         * @return false if another connection already does it, or if its
+         *         connection could not be opened.
+         */
+        bool startCheckpointer(int interval);
+        void stopCheckpointer();
+        void runCheckpointer(sqlite3 *db, int interval);
+
         /** defines the name of the database config parameter */
         static const std::string CFGPARAM_SQLITE_DB;
         /** defines the default value of the CFGPARAM_SQLITE_DB parameter */
@@ -159,6 +194,12 @@ class SqLiteDataProvider: public DataProvider
 
         sqlite3 *mDb; /**< the handle to the database connection */
         sqlite3_stmt *mStmt; /**< the prepared statement to process */
+        StatementCache<sqlite3_stmt *> mStatements; /**< by SQL text */
+
+        std::thread mCheckpointer; /**< with its own connection */
+        std::mutex mCheckpointerMutex;
+        std::condition_variable mCheckpointerWake;
+        bool mStopCheckpointer;
 };
 
 
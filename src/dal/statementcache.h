@@ -0,0 +1,118 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace dal
+{
+
+/**
+ * Keeps the prepared statements of a data provider by SQL text, so that a
+ * query is only parsed the first time it is used.
+ *
+ * The least recently used statement is released when the cache is full.
+ * Statement is meant to be a pointer or handle, a default constructed
+ * Statement is returned when nothing matches.
+ */
+template< class Statement >
+class StatementCache
+{
+    public:
+        typedef void (*Release)(Statement);
+
+        StatementCache(Release release, unsigned capacity = 64)
+            : mRelease(release)
+            , mCapacity(capacity > 0 ? capacity : 1)
+        {}
+
+        ~StatementCache()
+        { clear(); }
+
+        /**
+         * Returns the statement prepared for the given SQL text, and marks
+         * it as recently used.
+         */
+        Statement find(const std::string &sql)
+        {
+            typename Index::iterator it = mIndex.find(sql);
+            if (it == mIndex.end())
+                return Statement();
+
+            mStatements.splice(mStatements.begin(), mStatements, it->second);
+            return it->second->second;
+        }
+
+        /**
+         * Adds a statement for the given SQL text, which must not be cached
+         * yet. Releases the least recently used one when the cache is full.
+         */
+        void insert(const std::string &sql, Statement statement)
+        {
+            mStatements.push_front(std::make_pair(sql, statement));
+            mIndex[sql] = mStatements.begin();
+
+            while (mStatements.size() > mCapacity)
+            {
+                mIndex.erase(mStatements.back().first);
+                mRelease(mStatements.back().second);
+                mStatements.pop_back();
+            }
+        }
+
+        /**
+         * Releases all the statements, needed before the connection closes.
+         */
+        void clear()
+        {
+            for (typename Statements::iterator it = mStatements.begin(),
+                 it_end = mStatements.end(); it != it_end; ++it)
+            {
+                mRelease(it->second);
+            }
+            mStatements.clear();
+            mIndex.clear();
+        }
+
+        void setCapacity(unsigned capacity)
+        { mCapacity = capacity > 0 ? capacity : 1; }
+
+    private:
+        StatementCache(const StatementCache &) = delete;
+        StatementCache &operator=(const StatementCache &) = delete;
+
+        typedef std::list< std::pair<std::string, Statement> > Statements;
+        typedef std::unordered_map< std::string,
+                                    typename Statements::iterator > Index;
+
+        Release mRelease;
+        unsigned mCapacity;
+        Statements mStatements;     /**< Most recently used first */
+        Index mIndex;
+};
+
+} // namespace dal
+
+#endif // STATEMENTCACHE_H
@@ -59,11 +59,10 @@ void AbilityManager::readAbilityNode(xmlNodePtr abilityNode,
         return;
     }
 
-    AbilitiesInfo::iterator it = mAbilitiesInfo.find(id);
-    if (it != mAbilitiesInfo.end())
+    if (AbilityInfo *other = mAbilitiesInfo.value(id))
     {
         LOG_WARN("AbilityManager: The same id: " << id
-                 << " is given for ability names: " << it->first
+                 << " is given for ability names: " << other->name
                  << " and " << name);
         LOG_WARN("The ability reference: " << id
                  << ": '" << name << "' will be ignored.");
@@ -77,7 +76,7 @@ void AbilityManager::readAbilityNode(xmlNodePtr abilityNode,
     newInfo->target = getTargetByString(XML::getProperty(abilityNode, "target",
                                                          std::string()));
 
-    mAbilitiesInfo[newInfo->id] = newInfo;
+    mAbilitiesInfo.insert(newInfo->id, newInfo);
 
     mNamedAbilitiesInfo[name] = newInfo;
 }
@@ -94,7 +93,7 @@ void AbilityManager::reload()
 
 void AbilityManager::clear()
 {
-    for (AbilitiesInfo::iterator it = mAbilitiesInfo.begin(),
+    for (AbilitiesInfo::const_iterator it = mAbilitiesInfo.begin(),
          it_end = mAbilitiesInfo.end(); it != it_end; ++it)
     {
         delete it->second;
@@ -103,6 +102,19 @@ void AbilityManager::clear()
     mNamedAbilitiesInfo.clear();
 }
 
+void AbilityManager::copyCallbacks(const AbilityManager &other)
+{
+    for (AbilitiesInfo::const_iterator it = mAbilitiesInfo.begin(),
+         it_end = mAbilitiesInfo.end(); it != it_end; ++it)
+    {
+        if (AbilityInfo *otherInfo = other.getAbilityInfo(it->first))
+        {
+            it->second->rechargedCallback = otherInfo->rechargedCallback;
+            it->second->useCallback = otherInfo->useCallback;
+        }
+    }
+}
+
 unsigned AbilityManager::getId(const std::string &abilityName) const
 {
     if (mNamedAbilitiesInfo.contains(abilityName))
@@ -113,14 +125,13 @@ unsigned AbilityManager::getId(const std::string &abilityName) const
 
 const std::string AbilityManager::getAbilityName(int id) const
 {
-    AbilitiesInfo::const_iterator it = mAbilitiesInfo.find(id);
-    return it != mAbilitiesInfo.end() ? it->second->name : "";
+    AbilityInfo *info = mAbilitiesInfo.value(id);
+    return info ? info->name : "";
 }
 
 AbilityManager::AbilityInfo *AbilityManager::getAbilityInfo(int id) const
 {
-    AbilitiesInfo::const_iterator it = mAbilitiesInfo.find(id);
-    return it != mAbilitiesInfo.end() ? it->second : 0;
+    return mAbilitiesInfo.value(id);
 }
 
 AbilityManager::AbilityInfo *AbilityManager::getAbilityInfo(
@@ -22,6 +22,7 @@
 #ifndef ABILITYMANAGER_H
 #define ABILITYMANAGER_H
 
+#include "utils/idregistry.h"
 #include "utils/string.h"
 #include "utils/xml.h"
 
@@ -84,13 +85,19 @@ public:
 
     void readAbilityNode(xmlNodePtr skillNode, const std::string &filename);
 
+    /**
+     * Takes over the script callbacks of the abilities with the same ID in
+     * another manager, after the game data was reloaded.
+     */
+    void copyCallbacks(const AbilityManager &other);
+
 private:
     /**
      * Clears up the ability maps.
      */
     void clear();
 
-    typedef std::map<unsigned, AbilityInfo*> AbilitiesInfo;
+    typedef utils::IdRegistry<AbilityInfo*> AbilitiesInfo;
     AbilitiesInfo mAbilitiesInfo;
     typedef utils::NameMap<AbilityInfo*> NamedAbilitiesInfo;
     NamedAbilitiesInfo mNamedAbilitiesInfo;
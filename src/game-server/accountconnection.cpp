@@ -29,28 +29,36 @@
 #include "game-server/item.h"
 #include "game-server/itemmanager.h"
 #include "game-server/postman.h"
-#include "game-server/quest.h"
 #include "game-server/state.h"
 #include "net/messagein.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
 #include "utils/tokendispenser.h"
 #include "utils/tokencollector.h"
+#include "utils/zlib.h"
 
-/** Maximum size of sync buffer in bytes. */
-const unsigned SYNC_BUFFER_SIZE = 1024;
+#include <cstdlib>
 
-/** Maximum number of messages in sync buffer. */
-const int SYNC_BUFFER_LIMIT = 20;
+/**
+ * Maximum number of changed values waiting to be sent. Keeps the sync
+ * message well below the 64 KiB limit of a message.
+ */
+const size_t SYNC_BUFFER_LIMIT = 1000;
+
+/**
+ * Maximum number of bytes of quest variables waiting to be sent, since their
+ * values can be of any length.
+ */
+const size_t SYNC_QUEST_VAR_BYTES = 16 * 1024;
 
 AccountConnection::AccountConnection():
-    mSyncBuffer(0),
-    mSyncMessages(0)
+    mPendingQuestVarBytes(0),
+    mCompressionThreshold(0)
 {
 }
 
 AccountConnection::~AccountConnection()
 {
-    delete mSyncBuffer;
 }
 
 bool AccountConnection::start(int gameServerPort)
@@ -94,15 +102,17 @@ bool AccountConnection::start(int gameServerPort)
     msg.writeInt32(itemManager->getDatabaseVersion());
     send(msg);
 
-    // initialize sync buffer
-    if (!mSyncBuffer)
-        mSyncBuffer = new MessageOut(GAMSG_PLAYER_SYNC);
+    mCompressionThreshold =
+        Configuration::getValue("net_syncCompressionThreshold", 1024);
 
     return true;
 }
 
 void AccountConnection::sendCharacterData(Entity *p)
 {
+    // Pending changes are older than this data, they must not overwrite it
+    syncChanges(true);
+
     MessageOut msg(GAMSG_PLAYER_DATA);
     auto *characterComponent = p->getComponent<CharacterComponent>();
     msg.writeInt32(characterComponent->getDatabaseID());
@@ -164,46 +174,70 @@ void AccountConnection::processMessage(MessageIn &msg)
         case AGMSG_ACTIVE_MAP:
         {
             int mapId = msg.readInt16();
-            if (MapManager::activateMap(mapId))
+
+            // The map is read by the loader threads, so the data in the
+            // message is kept until the map gets activated.
+            std::vector< std::pair<std::string, std::string> > mapVars;
+            int mapVarsNumber = msg.readInt16();
+            for(int i = 0; i < mapVarsNumber; ++i)
+            {
+                std::string key = msg.readString();
+                std::string value = msg.readString();
+                if (!key.empty() && !value.empty())
+                    mapVars.push_back(std::make_pair(key, value));
+            }
+
+            struct FloorItem
             {
+                int itemId;
+                int amount;
+                int posX;
+                int posY;
+            };
+            std::vector<FloorItem> floorItems;
+            int floorItemsNumber = msg.readInt16();
+            for (int i = 0; i < floorItemsNumber; ++i)
+            {
+                FloorItem floorItem;
+                floorItem.itemId = msg.readInt32();
+                floorItem.amount = msg.readInt16();
+                floorItem.posX = msg.readInt16();
+                floorItem.posY = msg.readInt16();
+                floorItems.push_back(floorItem);
+            }
+
+            MapManager::activateMap(mapId, [=] (MapComposite *m) {
+                if (!m)
+                    return;
+
                 // Set map variables
-                MapComposite *m = MapManager::getMap(mapId);
-                int mapVarsNumber = msg.readInt16();
-                for(int i = 0; i < mapVarsNumber; ++i)
-                {
-                    std::string key = msg.readString();
-                    std::string value = msg.readString();
-                    if (!key.empty() && !value.empty())
-                        m->setVariableFromDbserver(key, value);
-                }
+                for (unsigned i = 0; i < mapVars.size(); ++i)
+                    m->setVariableFromDbserver(mapVars[i].first,
+                                               mapVars[i].second);
 
                 // Recreate potential persistent floor items
                 LOG_DEBUG("Recreate persistant items on map " << mapId);
-                int floorItemsNumber = msg.readInt16();
-
-                for (int i = 0; i < floorItemsNumber; ++i)
+                for (unsigned i = 0; i < floorItems.size(); ++i)
                 {
-                    int itemId = msg.readInt32();
-                    int amount = msg.readInt16();
-                    int posX = msg.readInt16();
-                    int posY = msg.readInt16();
-
-                    if (ItemClass *ic = itemManager->getItem(itemId))
+                    const FloorItem &floorItem = floorItems[i];
+                    if (ItemClass *ic = itemManager->getItem(floorItem.itemId))
                     {
                         Entity *item = Item::create(m,
-                                                    Point(posX, posY),
-                                                    ic, amount);
+                                                    Point(floorItem.posX,
+                                                          floorItem.posY),
+                                                    ic, floorItem.amount);
 
                         if (!GameState::insertOrDelete(item))
                         {
                             // The map is full.
-                            LOG_WARN("Couldn't add floor item(s) " << itemId
+                            LOG_WARN("Couldn't add floor item(s) "
+                                     << floorItem.itemId
                                      << " into map " << mapId);
                             return;
                         }
                     }
                 }
-            }
+            });
         } break;
 
         case AGMSG_SET_VAR_WORLD:
@@ -224,14 +258,6 @@ void AccountConnection::processMessage(MessageIn &msg)
             gameHandler->completeServerChange(id, token, address, port);
         } break;
 
-        case AGMSG_GET_VAR_CHR_RESPONSE:
-        {
-            int id = msg.readInt32();
-            std::string name = msg.readString();
-            std::string value = msg.readString();
-            recoveredQuestVar(id, name, value);
-        } break;
-
         case CGMSG_CHANGED_PARTY:
         {
             // Character DB id
@@ -291,24 +317,14 @@ void AccountConnection::playerReconnectAccount(int id,
     send(msg);
 }
 
-void AccountConnection::requestCharacterVar(Entity *ch,
-                                            const std::string &name)
-{
-    MessageOut msg(GAMSG_GET_VAR_CHR);
-    msg.writeInt32(ch->getComponent<CharacterComponent>()->getDatabaseID());
-    msg.writeString(name);
-    send(msg);
-}
-
 void AccountConnection::updateCharacterVar(Entity *ch,
                                            const std::string &name,
                                            const std::string &value)
 {
-    MessageOut msg(GAMSG_SET_VAR_CHR);
-    msg.writeInt32(ch->getComponent<CharacterComponent>()->getDatabaseID());
-    msg.writeString(name);
-    msg.writeString(value);
-    send(msg);
+    const int charId = ch->getComponent<CharacterComponent>()->getDatabaseID();
+    mPendingQuestVars[QuestVarKey(charId, name)] = value;
+    mPendingQuestVarBytes += name.size() + value.size();
+    syncChanges();
 }
 
 void AccountConnection::updateMapVar(MapComposite *map,
@@ -425,62 +441,120 @@ void AccountConnection::changeAccountLevel(Entity *c, int level)
 
 void AccountConnection::syncChanges(bool force)
 {
-    if (mSyncMessages == 0)
+    const size_t pending = mPendingPoints.size() +
+                           mPendingAttributes.size() +
+                           mPendingQuestVars.size() +
+                           mPendingOnlineStatus.size();
+    if (pending == 0)
+        return;
+
+    if (!force && pending <= SYNC_BUFFER_LIMIT &&
+        mPendingQuestVarBytes <= SYNC_QUEST_VAR_BYTES)
         return;
 
-    // send buffer if:
-    //    a.) forced by any process
-    //    b.) every 10 seconds
-    //    c.) buffer reaches size of 1kb
-    //    d.) buffer holds more then 20 messages
-    if (force ||
-        mSyncMessages > SYNC_BUFFER_LIMIT ||
-        mSyncBuffer->getLength() > SYNC_BUFFER_SIZE )
+    LOG_DEBUG("Sending GAMSG_PLAYER_SYNC with " << pending << " changes.");
+
+    static Metrics::Histogram &syncChangeCount =
+            Metrics::histogram("manaserv_sync_changes",
+                               "Changes sent in a GAMSG_PLAYER_SYNC.");
+    static Metrics::Histogram &syncSize =
+            Metrics::histogram("manaserv_sync_bytes",
+                               "Size of a GAMSG_PLAYER_SYNC, after "
+                               "compression.");
+    syncChangeCount.record(pending);
+
+    // The online status comes last, so that the account server stores the
+    // other changes of a character before it leaves.
+    MessageOut msg(GAMSG_PLAYER_SYNC);
+
+    for (std::map<int, CharacterPoints>::const_iterator
+         it = mPendingPoints.begin(), it_end = mPendingPoints.end();
+         it != it_end; ++it)
     {
-        LOG_DEBUG("Sending GAMSG_PLAYER_SYNC with "
-                << mSyncMessages << " messages." );
+        msg.writeInt8(SYNC_CHARACTER_POINTS);
+        msg.writeInt32(it->first);
+        msg.writeInt32(it->second.first);
+        msg.writeInt32(it->second.second);
+    }
 
-        send(*mSyncBuffer);
-        delete mSyncBuffer;
+    for (std::map<AttributeKey, AttributeValue>::const_iterator
+         it = mPendingAttributes.begin(), it_end = mPendingAttributes.end();
+         it != it_end; ++it)
+    {
+        msg.writeInt8(SYNC_CHARACTER_ATTRIBUTE);
+        msg.writeInt32(it->first.first);
+        msg.writeInt32(it->first.second);
+        msg.writeDouble(it->second.first);
+        msg.writeDouble(it->second.second);
+    }
 
-        mSyncBuffer = new MessageOut(GAMSG_PLAYER_SYNC);
-        mSyncMessages = 0;
+    for (std::map<QuestVarKey, std::string>::const_iterator
+         it = mPendingQuestVars.begin(), it_end = mPendingQuestVars.end();
+         it != it_end; ++it)
+    {
+        msg.writeInt8(SYNC_CHARACTER_VAR);
+        msg.writeInt32(it->first.first);
+        msg.writeString(it->first.second);
+        msg.writeString(it->second);
     }
-    else
+
+    for (std::map<int, bool>::const_iterator
+         it = mPendingOnlineStatus.begin(), it_end = mPendingOnlineStatus.end();
+         it != it_end; ++it)
     {
-        LOG_DEBUG("No changes to sync with account server.");
+        msg.writeInt8(SYNC_ONLINE_STATUS);
+        msg.writeInt32(it->first);
+        msg.writeInt8(it->second ? 1 : 0);
     }
+
+    mPendingPoints.clear();
+    mPendingAttributes.clear();
+    mPendingQuestVars.clear();
+    mPendingQuestVarBytes = 0;
+    mPendingOnlineStatus.clear();
+
+    char *compressed = 0;
+    unsigned compressedLength = 0;
+    if (mCompressionThreshold > 0 &&
+        msg.getLength() > mCompressionThreshold &&
+        deflateMemory(msg.getData(), msg.getLength(),
+                      compressed, compressedLength))
+    {
+        if (compressedLength < msg.getLength())
+        {
+            MessageOut compressedMsg(GAMSG_PLAYER_SYNC_COMPRESSED);
+            compressedMsg.writeInt32(msg.getLength());
+            compressedMsg.writeBytes(compressed, compressedLength);
+            syncSize.record(compressedMsg.getLength());
+            send(compressedMsg);
+            free(compressed);
+            return;
+        }
+        free(compressed);
+    }
+
+    syncSize.record(msg.getLength());
+    send(msg);
 }
 
 void AccountConnection::updateCharacterPoints(int charId, int charPoints,
                                               int corrPoints)
 {
-    ++mSyncMessages;
-    mSyncBuffer->writeInt8(SYNC_CHARACTER_POINTS);
-    mSyncBuffer->writeInt32(charId);
-    mSyncBuffer->writeInt32(charPoints);
-    mSyncBuffer->writeInt32(corrPoints);
+    mPendingPoints[charId] = CharacterPoints(charPoints, corrPoints);
     syncChanges();
 }
 
 void AccountConnection::updateAttributes(int charId, int attrId, double base,
                                          double mod)
 {
-    ++mSyncMessages;
-    mSyncBuffer->writeInt8(SYNC_CHARACTER_ATTRIBUTE);
-    mSyncBuffer->writeInt32(charId);
-    mSyncBuffer->writeInt32(attrId);
-    mSyncBuffer->writeDouble(base);
-    mSyncBuffer->writeDouble(mod);
+    mPendingAttributes[AttributeKey(charId, attrId)] =
+            AttributeValue(base, mod);
     syncChanges();
 }
 
 void AccountConnection::updateOnlineStatus(int charId, bool online)
 {
-    ++mSyncMessages;
-    mSyncBuffer->writeInt8(SYNC_ONLINE_STATUS);
-    mSyncBuffer->writeInt32(charId);
-    mSyncBuffer->writeInt8(online ? 1 : 0);
+    mPendingOnlineStatus[charId] = online;
     syncChanges();
 }
 
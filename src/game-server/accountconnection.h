@@ -24,6 +24,10 @@
 #include "net/messageout.h"
 #include "net/connection.h"
 
+#include <map>
+#include <string>
+#include <utility>
+
 class Entity;
 class MapComposite;
 
@@ -53,12 +57,8 @@ class AccountConnection : public Connection
         void playerReconnectAccount(int id, const std::string &magic_token);
 
         /**
-         * Requests the value of a character-bound variable from the database.
-         */
-        void requestCharacterVar(Entity *, const std::string &);
-
-        /**
-         * Pushes a new character-bound value to the database.
+         * Pushes a new character-bound value to the database. It is sent
+         * along with the other changes, see syncChanges.
          */
         void updateCharacterVar(Entity *, const std::string &name,
                                 const std::string &value);
@@ -104,19 +104,21 @@ class AccountConnection : public Connection
          * Sends all changed player data to the account server to minimize
          * dataloss due to failure of one server component.
          *
-         * The gameserver holds a buffer with all changes made by a character.
-         * The changes are added at the time they occur. When the buffer
-         * reaches one of the following limits, the buffer is sent to the
-         * account server and applied to the database.
+         * The gameserver collects the changes made to characters as they
+         * occur. Repeated changes to the same value only keep the latest
+         * one, so that the account server applies each value once per
+         * window.
          *
-         * The sync buffer is sent when:
+         * The changes are sent when:
          * - forced by any process (param force = true)
          * - every 10 seconds
-         * - buffer reaches size of 1kb (SYNC_BUFFER_SIZE)
-         * - buffer holds more then 20 messages (SYNC_BUFFER_LIMIT)
+         * - more than SYNC_BUFFER_LIMIT values are waiting
+         * - more than SYNC_QUEST_VAR_BYTES of quest variables are waiting
+         *
+         * Large batches are deflated, see net_syncCompressionThreshold.
          *
-         * @param force Send changes even if buffer hasn't reached its size
-         *              or message limit. (used to send in timed schedules)
+         * @param force Send changes even if the limit hasn't been reached.
+         *              (used to send in timed schedules)
          */
         void syncChanges(bool force = false);
 
@@ -176,8 +178,24 @@ class AccountConnection : public Connection
         virtual void processMessage(MessageIn &);
 
     private:
-        MessageOut* mSyncBuffer;     /**< Message buffer to store sync data. */
-        int mSyncMessages;           /**< Number of messages in the sync buffer. */
+        typedef std::pair<int, int> CharacterPoints;
+        typedef std::pair<int, int> AttributeKey;       /**< charId, attrId */
+        typedef std::pair<double, double> AttributeValue; /**< base, mod */
+        typedef std::pair<int, std::string> QuestVarKey; /**< charId, name */
+
+        /** Latest character points, by character ID. */
+        std::map<int, CharacterPoints> mPendingPoints;
+        /** Latest attribute values, by character and attribute ID. */
+        std::map<AttributeKey, AttributeValue> mPendingAttributes;
+        /** Latest quest variable values, by character ID and name. */
+        std::map<QuestVarKey, std::string> mPendingQuestVars;
+        /** Bytes given to updateCharacterVar since the last sync. */
+        size_t mPendingQuestVarBytes;
+        /** Latest online status, by character ID. */
+        std::map<int, bool> mPendingOnlineStatus;
+
+        /** Size above which sync messages are deflated, 0 to never do it. */
+        unsigned mCompressionThreshold;
 };
 
 extern AccountConnection *accountHandler;
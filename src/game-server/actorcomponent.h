@@ -134,6 +134,16 @@ class ActorComponent : public Component
         void setBlockType(BlockType blockType)
         { mBlockType = blockType; }
 
+        /**
+         * Gets the index of the map zone the actor is stored in. Zones
+         * overlap, so it cannot be derived from the position alone.
+         */
+        unsigned getZone() const
+        { return mZone; }
+
+        void setZone(unsigned zone)
+        { mZone = zone; }
+
         /**
          * Overridden in order to update the walkmap.
          */
@@ -155,6 +165,8 @@ class ActorComponent : public Component
 
         unsigned char mWalkMask;
         BlockType mBlockType;
+
+        unsigned mZone;             /**< Map zone containing the actor. */
 };
 
 #endif // ACTORCOMPONENT_H
@@ -40,21 +40,14 @@ void AttributeManager::deinitialize()
     mTagMap.clear();
 
     mAttributeNameMap.clear();
-    for (auto &it : mAttributeMap)
+    for (auto &it : mAttributes)
         delete it.second;
-    mAttributeMap.clear();
+    mAttributes.clear();
 
     for (unsigned i = 0; i < MaxScope; ++i)
         mAttributeScopes[i].clear();
-}
 
-AttributeInfo *AttributeManager::getAttributeInfo(
-        int id) const
-{
-    auto ret = mAttributeMap.find(id);
-    if (ret == mAttributeMap.end())
-        return 0;
-    return ret->second;
+    resolveCoreAttributes();
 }
 
 AttributeInfo *AttributeManager::getAttributeInfo(
@@ -167,22 +160,34 @@ void AttributeManager::readAttributeNode(xmlNodePtr attributeNode)
         }
     }
 
-    mAttributeMap[id] = attribute;
+    mAttributes.insert(id, attribute);
     mAttributeNameMap[name] = attribute;
 }
 
+void AttributeManager::resolveCoreAttributes()
+{
+    mCoreAttributes.hp = getAttributeInfo(ATTR_HP);
+    mCoreAttributes.maxHp = getAttributeInfo(ATTR_MAX_HP);
+    mCoreAttributes.hpRegen = getAttributeInfo(ATTR_HP_REGEN);
+    mCoreAttributes.moveSpeedTps = getAttributeInfo(ATTR_MOVE_SPEED_TPS);
+    mCoreAttributes.moveSpeedRaw = getAttributeInfo(ATTR_MOVE_SPEED_RAW);
+    mCoreAttributes.gp = getAttributeInfo(ATTR_GP);
+}
+
 /**
  * Check the status of recently loaded configuration.
  */
 void AttributeManager::checkStatus()
 {
+    resolveCoreAttributes();
+
     LOG_DEBUG("attribute map:");
     LOG_DEBUG("Stackable is " << Stackable << ", NonStackable is " << NonStackable
               << ", NonStackableBonus is " << NonStackableBonus << ".");
     LOG_DEBUG("Additive is " << Additive << ", Multiplicative is " << Multiplicative << ".");
     const std::string *tag;
     unsigned count = 0;
-    for (auto &attributeIt : mAttributeMap)
+    for (auto &attributeIt : mAttributes)
     {
         unsigned lCount = 0;
         LOG_DEBUG("  "<< attributeIt.first<<" : ");
@@ -197,7 +202,7 @@ void AttributeManager::checkStatus()
             ++count;
         }
     }
-    LOG_INFO("Loaded '" << mAttributeMap.size() << "' attributes with '"
+    LOG_INFO("Loaded '" << mAttributes.size() << "' attributes with '"
              << count << "' modifier layers.");
 
     for (auto &tagIt : mTagMap)
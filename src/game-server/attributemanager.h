@@ -26,6 +26,7 @@
 #include <string>
 #include <vector>
 
+#include "utils/idregistry.h"
 #include "utils/string.h"
 #include "utils/xml.h"
 
@@ -58,11 +59,25 @@ struct ModifierLocation
     { return attributeId == other.attributeId && layer == other.layer; }
 };
 
+/**
+ * The attributes the server itself relies on, resolved once when the
+ * attributes are read. A missing attribute is left null.
+ */
+struct CoreAttributes
+{
+    AttributeInfo *hp;
+    AttributeInfo *maxHp;
+    AttributeInfo *hpRegen;
+    AttributeInfo *moveSpeedTps;
+    AttributeInfo *moveSpeedRaw;
+    AttributeInfo *gp;
+};
+
 class AttributeManager
 {
     public:
         AttributeManager()
-        {}
+        { resolveCoreAttributes(); }
 
         /**
          * Loads attribute reference file.
@@ -75,9 +90,14 @@ class AttributeManager
         void reload();
         void deinitialize();
 
-        AttributeInfo *getAttributeInfo(int id) const;
+        AttributeInfo *getAttributeInfo(int id) const
+        { return mAttributes.value(id); }
+
         AttributeInfo *getAttributeInfo(const std::string &name) const;
 
+        const CoreAttributes &getCoreAttributes() const
+        { return mCoreAttributes; }
+
         const std::set<AttributeInfo *> &getAttributeScope(ScopeType) const;
 
         ModifierLocation getLocation(const std::string &tag) const;
@@ -92,9 +112,12 @@ class AttributeManager
         void readModifierNode(xmlNodePtr modifierNode, int attributeId,
                               AttributeInfo *info);
 
+        void resolveCoreAttributes();
+
         std::set<AttributeInfo *> mAttributeScopes[MaxScope];
 
-        std::map<int, AttributeInfo *> mAttributeMap;
+        utils::IdRegistry<AttributeInfo *> mAttributes;
+        CoreAttributes mCoreAttributes;
         utils::NameMap<AttributeInfo *> mAttributeNameMap;
 
         std::map<std::string, ModifierLocation> mTagMap;
@@ -86,9 +86,9 @@ void BeingComponent::triggerEmote(Entity &entity, int id)
 
 void BeingComponent::heal(Entity &entity)
 {
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
     Attribute &hp = mAttributes.at(hpAttribute);
-    Attribute &maxHp = mAttributes.at(attributeManager->getAttributeInfo(ATTR_MAX_HP));
+    Attribute &maxHp = mAttributes.at(attributeManager->getCoreAttributes().maxHp);
     if (maxHp.getModifiedAttribute() == hp.getModifiedAttribute())
         return; // Full hp, do nothing.
 
@@ -99,8 +99,8 @@ void BeingComponent::heal(Entity &entity)
 
 void BeingComponent::heal(Entity &entity, int gain)
 {
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
-    auto *maxHpAttribute = attributeManager->getAttributeInfo(ATTR_MAX_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
+    auto *maxHpAttribute = attributeManager->getCoreAttributes().maxHp;
     Attribute &hp = mAttributes.at(hpAttribute);
     Attribute &maxHp = mAttributes.at(maxHpAttribute);
     if (maxHp.getModifiedAttribute() == hp.getModifiedAttribute())
@@ -158,8 +158,9 @@ Path BeingComponent::findPath(Entity &entity)
     int startY = actorComponent->getPosition().y / tileHeight;
     int destX = mDst.x / tileWidth, destY = mDst.y / tileHeight;
 
-    return map->findPath(startX, startY, destX, destY,
-                         actorComponent->getWalkMask());
+    // Beings chasing the same target share a single search
+    return map->findSharedPath(startX, startY, destX, destY,
+                               actorComponent->getWalkMask());
 }
 
 void BeingComponent::updateDirection(Entity &entity,
@@ -184,8 +185,8 @@ void BeingComponent::updateDirection(Entity &entity,
 void BeingComponent::move(Entity &entity)
 {
     // Immobile beings cannot move.
-    if (!checkAttributeExists(attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_RAW))
-        || !getModifiedAttribute(attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_RAW)))
+    if (!checkAttributeExists(attributeManager->getCoreAttributes().moveSpeedRaw)
+        || !getModifiedAttribute(attributeManager->getCoreAttributes().moveSpeedRaw))
           return;
 
     // Remember the current position before moving. This is used by
@@ -268,7 +269,7 @@ void BeingComponent::move(Entity &entity)
         Point next = mPath.front();
         mPath.pop_front();
 
-        auto *rawSpeedAttribute = attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_RAW);
+        auto *rawSpeedAttribute = attributeManager->getCoreAttributes().moveSpeedRaw;
         // SQRT2 is used for diagonal movement.
         mMoveTime += (prev.x == next.x || prev.y == next.y) ?
                        getModifiedAttribute(rawSpeedAttribute) :
@@ -416,9 +417,9 @@ void BeingComponent::recalculateBaseAttribute(Entity &entity,
     }
 
     // Handle speed conversion inside the engine
-    if (attribute == attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_RAW))
+    if (attribute == attributeManager->getCoreAttributes().moveSpeedRaw)
     {
-        auto *speedTpsAttribute = attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_TPS);
+        auto *speedTpsAttribute = attributeManager->getCoreAttributes().moveSpeedTps;
         double newBase = utils::tpsToRawSpeed(
                                     getModifiedAttribute(speedTpsAttribute));
         if (newBase != getAttributeBase(attribute))
@@ -455,7 +456,7 @@ void BeingComponent::updateDerivedAttributes(Entity &entity,
         // Does not make a lot of sense to have in the scripts.
         // So handle it here:
         recalculateBaseAttribute(entity,
-                                 attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_RAW));
+                                 attributeManager->getCoreAttributes().moveSpeedRaw);
         break;
     }
 
@@ -474,7 +475,7 @@ void BeingComponent::applyStatusEffect(int id, int timer)
     if (mAction == DEAD)
         return;
 
-    if (StatusEffect *statusEffect = StatusManager::getStatus(id))
+    if (StatusEffect *statusEffect = statusManager->getStatus(id))
     {
         Status newStatus;
         newStatus.status = statusEffect;
@@ -515,19 +516,25 @@ void BeingComponent::setStatusEffectTime(int id, int time)
     if (it != mStatus.end()) it->second.time = time;
 }
 
+void BeingComponent::setStatusEffect(int id, StatusEffect *status)
+{
+    StatusEffects::iterator it = mStatus.find(id);
+    if (it != mStatus.end()) it->second.status = status;
+}
+
 void BeingComponent::update(Entity &entity)
 {
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
 
     int oldHP = getModifiedAttribute(hpAttribute);
     int newHP = oldHP;
-    int maxHP = getModifiedAttribute(attributeManager->getAttributeInfo(ATTR_MAX_HP));
+    int maxHP = getModifiedAttribute(attributeManager->getCoreAttributes().maxHp);
 
     // Regenerate HP
     if (mAction != DEAD && mHealthRegenerationTimeout.expired())
     {
         mHealthRegenerationTimeout.set(TICKS_PER_HP_REGENERATION);
-        newHP += getModifiedAttribute(attributeManager->getAttributeInfo(ATTR_HP_REGEN));
+        newHP += getModifiedAttribute(attributeManager->getCoreAttributes().hpRegen);
     }
     // Cap HP at maximum
     if (newHP > maxHP)
@@ -240,6 +240,12 @@ class BeingComponent : public Component
          */
         void setStatusEffectTime(int id, int time);
 
+        /**
+         * Changes the version of the status effect (if in effect), after the
+         * game data was reloaded
+         */
+        void setStatusEffect(int id, StatusEffect *status);
+
         /** Gets the name of the being. */
         const std::string &getName() const
         { return mName; }
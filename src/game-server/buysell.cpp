@@ -31,7 +31,7 @@
 #include <algorithm>
 
 BuySell::BuySell(Entity *c, bool sell)
-    : mCurrency(attributeManager->getAttributeInfo(ATTR_GP))
+    : mCurrency(attributeManager->getCoreAttributes().gp)
     , mChar(c)
     , mSell(sell)
 {
@@ -65,6 +65,7 @@ CharacterComponent::CharacterComponent(Entity &entity, MessageIn &msg):
     mClient(nullptr),
     mConnected(true),
     mTransactionHandler(nullptr),
+    mItemEffectsSource(itemManager),
     mDatabaseID(-1),
     mHairStyle(0),
     mHairColor(0),
@@ -187,6 +188,14 @@ void CharacterComponent::deserialize(Entity &entity, MessageIn &msg)
         setQuestlog(id, state, title, description);
     }
 
+    // quest variables
+    int questVarsSize = msg.readInt16();
+    questCache.clear();
+    for (int i = 0; i < questVarsSize; ++i) {
+        std::string name = msg.readString();
+        questCache[name] = msg.readString();
+    }
+
     Possessions &poss = getPossessions();
 
     // Loads inventory - must be last because size isn't transmitted
@@ -276,6 +285,13 @@ void CharacterComponent::serialize(Entity &entity, MessageOut &msg)
         msg.writeString(quest.description);
     }
 
+    // quest variables
+    msg.writeInt16(questCache.size());
+    for (auto &questVar : questCache) {
+        msg.writeString(questVar.first);
+        msg.writeString(questVar.second);
+    }
+
     // inventory - must be last because size isn't transmitted
     const Possessions &poss = getPossessions();
 
@@ -315,9 +331,9 @@ void CharacterComponent::respawn(Entity &entity)
 
     // No script respawn callback set - fall back to hardcoded logic
     const double maxHp = beingComponent->getModifiedAttribute(
-            attributeManager->getAttributeInfo(ATTR_MAX_HP));
+            attributeManager->getCoreAttributes().maxHp);
     beingComponent->setAttribute(entity,
-                                 attributeManager->getAttributeInfo(ATTR_HP),
+                                 attributeManager->getCoreAttributes().hp,
                                  maxHp);
     // Warp back to spawn point.
     int spawnMap = Configuration::getValue("char_respawnMap", 1);
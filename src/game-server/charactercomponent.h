@@ -41,6 +41,7 @@
 #include <vector>
 
 class BuySell;
+class ItemManager;
 struct GameClient;
 class MessageIn;
 class MessageOut;
@@ -119,6 +120,16 @@ class CharacterComponent : public Component
         Possessions &getPossessions()
         { return mPossessions; }
 
+        /**
+         * Gets the item manager whose item types applied the effects of the
+         * inventory and equipment.
+         */
+        ItemManager *getItemEffectsSource() const
+        { return mItemEffectsSource; }
+
+        void setItemEffectsSource(ItemManager *source)
+        { mItemEffectsSource = source; }
+
         /**
          * Gets the Trade object the character is involved in.
          */
@@ -201,8 +212,8 @@ class CharacterComponent : public Component
         void disconnected(Entity &entity);
 
         /**
-         * Associative array containing all the quest variables known by the
-         * server.
+         * Associative array containing all the quest variables of the
+         * character, received along with its data.
          */
         std::map< std::string, std::string > questCache;
 
@@ -344,6 +355,7 @@ class CharacterComponent : public Component
         void *mTransactionHandler;
 
         Possessions mPossessions;    /**< Possesssions of the character. */
+        ItemManager *mItemEffectsSource; /**< Item data of the applied effects. */
 
         /** Attributes modified since last update. */
         std::set<AttributeInfo *> mModifiedAttributes;
@@ -21,6 +21,7 @@
 #include "game-server/collisiondetection.h"
 
 #include <cmath>
+#include <cstdlib>
 
 #include "utils/mathutils.h"
 #include "utils/point.h"
@@ -174,3 +175,55 @@ bool Collision::circleWithCircle(const Point &center1, int radius1,
 
     return distSquared < touchDistance * touchDistance;
 }
+
+bool Collision::lineOfSight(const Map &map, const Point &from, const Point &to,
+                            unsigned char blockmask)
+{
+    const int tileWidth = map.getTileWidth();
+    const int tileHeight = map.getTileHeight();
+
+    // Walk the line from top to bottom, one row of tiles at a time
+    const Point &top = from.y <= to.y ? from : to;
+    const Point &bottom = from.y <= to.y ? to : from;
+    const int dx = bottom.x - top.x;
+    const int dy = bottom.y - top.y;
+
+    const int fromTileX = from.x / tileWidth, fromTileY = from.y / tileHeight;
+    const int toTileX = to.x / tileWidth, toTileY = to.y / tileHeight;
+
+    for (int row = top.y / tileHeight; row <= bottom.y / tileHeight; ++row)
+    {
+        // Part of the line inside this row
+        double x1 = top.x, x2 = bottom.x;
+        if (dy)
+        {
+            const int y1 = std::max(top.y, row * tileHeight);
+            const int y2 = std::min(bottom.y, (row + 1) * tileHeight);
+            x1 = top.x + double(y1 - top.y) * dx / dy;
+            x2 = top.x + double(y2 - top.y) * dx / dy;
+        }
+
+        const int first = int(std::floor(std::min(x1, x2))) / tileWidth;
+        const int last = int(std::floor(std::max(x1, x2))) / tileWidth;
+
+        // Test the tiles of the row, up to 64 at once
+        for (int column = first; column <= last; column += 64)
+        {
+            uint64_t blocked = map.getBlockedTiles(column, row, blockmask);
+            if (last - column < 63)
+                blocked &= (uint64_t(1) << (last - column + 1)) - 1;
+
+            if (row == fromTileY && fromTileX >= column &&
+                    fromTileX - column < 64)
+                blocked &= ~(uint64_t(1) << (fromTileX - column));
+            if (row == toTileY && toTileX >= column &&
+                    toTileX - column < 64)
+                blocked &= ~(uint64_t(1) << (toTileX - column));
+
+            if (blocked)
+                return false;
+        }
+    }
+
+    return true;
+}
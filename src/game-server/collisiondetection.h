@@ -21,7 +21,7 @@
 #ifndef COLLISIONDETECTION_H
 #define COLLISIONDETECTION_H
 
-class Point;
+#include "game-server/map.h"
 
 /**
  * This namespace collects all needed collision detection functions
@@ -50,6 +50,17 @@ namespace Collision
      */
     bool circleWithCircle(const Point &center1, int radius1,
                           const Point &center2, int radius2);
+
+    /**
+     * Checks if nothing blocks the straight line between two pixel
+     * positions. Every tile touched by the line is tested, except the tiles
+     * of both end points, so beings do not hide themselves.
+     *
+     * @param blockmask
+     *        The kinds of blockers that stop the line, walls by default.
+     */
+    bool lineOfSight(const Map &map, const Point &from, const Point &to,
+                     unsigned char blockmask = Map::BLOCKMASK_WALL);
 }
 
 #endif
@@ -18,6 +18,7 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iomanip>
 #include <sstream>
 
 #include "game-server/commandhandler.h"
@@ -33,6 +34,7 @@
 #include "game-server/monster.h"
 #include "game-server/monstermanager.h"
 #include "game-server/abilitymanager.h"
+#include "game-server/settingsmanager.h"
 #include "game-server/state.h"
 
 #include "scripting/scriptmanager.h"
@@ -41,6 +43,7 @@
 #include "common/permissionmanager.h"
 #include "common/transaction.h"
 
+#include "utils/profiler.h"
 #include "utils/string.h"
 
 struct CmdRef
@@ -87,6 +90,8 @@ static void handleRechargeAbility(Entity*, std::string&);
 static void handleListAbility(Entity*, std::string&);
 static void handleSetAttributePoints(Entity*, std::string&);
 static void handleSetCorrectionPoints(Entity*, std::string&);
+static void handleTraffic(Entity*, std::string&);
+static void handleProfile(Entity*, std::string&);
 
 static CmdRef const cmdRef[] =
 {
@@ -170,6 +175,10 @@ static CmdRef const cmdRef[] =
         "Sets the attribute points of a character.", &handleSetAttributePoints},
     {"setcorrectionpoints", "<character> <amount>",
         "Sets the correction points of a character.", &handleSetCorrectionPoints},
+    {"traffic", "[number of clients]",
+        "Lists the clients exchanging the most with the server.", &handleTraffic},
+    {"profile", "[start [frequency] | stop]",
+        "Starts or stops profiling the server, or tells whether it is profiled.", &handleProfile},
     {nullptr, nullptr, nullptr, nullptr}
 
 };
@@ -415,7 +424,7 @@ static void handleCharWarp(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid or offline character <" + character + ">.", player);
@@ -518,7 +527,7 @@ static void handleItem(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid character or they are offline", player);
@@ -657,7 +666,7 @@ static void handleMoney(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid character or they are offline", player);
@@ -677,7 +686,7 @@ static void handleMoney(Entity *player, std::string &args)
 
     auto *beingComponent = other->getComponent<BeingComponent>();
 
-    auto *moneyAttribute = attributeManager->getAttributeInfo(ATTR_GP);
+    auto *moneyAttribute = attributeManager->getCoreAttributes().gp;
 
     // change how much money the player has
     const double previousMoney = beingComponent->getAttributeBase(moneyAttribute);
@@ -783,7 +792,7 @@ static void handleGoto(Entity *player, std::string &args)
     }
 
     // check for valid player
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character, or player is offline.", player);
@@ -820,7 +829,7 @@ static void handleRecall(Entity *player, std::string &args)
     }
 
     // check for valid player
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character, or player is offline.", player);
@@ -833,11 +842,12 @@ static void handleRecall(Entity *player, std::string &args)
     GameState::warp(other, map, pos);
 }
 
-static void handleReload(Entity *, std::string &)
+static void handleReload(Entity *player, std::string &)
 {
-    // reload the items and monsters
-    itemManager->reload();
-    monsterManager->reload();
+    if (settingsManager->reload())
+        say("Reloading the game data.", player);
+    else
+        say("The game data is being reloaded already.", player);
 }
 
 static void handleBan(Entity *player, std::string &args)
@@ -859,7 +869,7 @@ static void handleBan(Entity *player, std::string &args)
     }
 
     // check for valid player
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character", player);
@@ -927,7 +937,7 @@ static void handlePermissions(Entity *player, std::string &args)
         return;
     }
 
-    Entity *other = gameHandler->getCharacterByNameSlow(character);
+    Entity *other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character", player);
@@ -962,7 +972,7 @@ static void handleGivePermission(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid character", player);
@@ -1030,7 +1040,7 @@ static void handleTakePermission(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid character", player);
@@ -1095,7 +1105,7 @@ static void handleAttribute(Entity *player, std::string &args)
     else
     {
         // check for valid player
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
         if (!other)
         {
             say("Invalid character", player);
@@ -1224,7 +1234,7 @@ static void handleMute(Entity *player, std::string &args)
 
 
     // Check for a valid player.
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character", player);
@@ -1285,7 +1295,7 @@ static void handleMute(Entity *player, std::string &args)
 
 static void handleDie(Entity *player, std::string &)
 {
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
     player->getComponent<BeingComponent>()->setAttribute(*player, hpAttribute, 0);
     say("You've killed yourself.", player);
 }
@@ -1298,7 +1308,7 @@ static void handleKill(Entity *player, std::string &args)
     std::string character = getArgument(args);
 
     // check for valid player
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character", player);
@@ -1306,7 +1316,7 @@ static void handleKill(Entity *player, std::string &args)
     }
 
     // kill the player
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
     other->getComponent<BeingComponent>()->setAttribute(*player, hpAttribute, 0);
 
     // feedback
@@ -1336,7 +1346,7 @@ static void handleKick(Entity *player, std::string &args)
     std::string character = getArgument(args);
 
     // check for valid player
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character", player);
@@ -1516,7 +1526,7 @@ static void handleGetPos(Entity *player, std::string &args)
         return;
     }
     Entity *other;
-    other = gameHandler->getCharacterByNameSlow(character);
+    other = gameHandler->getCharacterByName(character);
     if (!other)
     {
         say("Invalid character, or player is offline.", player);
@@ -1553,7 +1563,7 @@ static void handleEffect(Entity *player, std::string &args)
     else if (arguments.size() == 2)
     {
         int id = utils::stringToInt(arguments[0]);
-        Entity *p = gameHandler->getCharacterByNameSlow(arguments[1]);
+        Entity *p = gameHandler->getCharacterByName(arguments[1]);
         if (!p)
         {
             say("Invalid target player.", player);
@@ -1591,7 +1601,7 @@ static void handleGiveAbility(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1628,7 +1638,7 @@ static void handleTakeAbility(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1670,7 +1680,7 @@ static void handleRechargeAbility(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1709,7 +1719,7 @@ static void handleListAbility(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1745,7 +1755,7 @@ static void handleSetAttributePoints(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1779,7 +1789,7 @@ static void handleSetCorrectionPoints(Entity *player, std::string &args)
     if (character == "#")
         other = player;
     else
-        other = gameHandler->getCharacterByNameSlow(character);
+        other = gameHandler->getCharacterByName(character);
 
     if (!other)
     {
@@ -1798,6 +1808,123 @@ static void handleSetCorrectionPoints(Entity *player, std::string &args)
     characterComponent->setCorrectionPoints(utils::stringToInt(correctionPoints));
 }
 
+static void handleTraffic(Entity *player, std::string &args)
+{
+    std::string countStr = getArgument(args);
+    int count = 5;
+    if (!countStr.empty())
+    {
+        if (!utils::isNumeric(countStr))
+        {
+            say("Invalid number of clients.", player);
+            return;
+        }
+        count = utils::stringToInt(countStr);
+    }
+
+    const std::vector<NetComputer *> talkers =
+            gameHandler->getTopTalkers(count);
+    if (talkers.empty())
+    {
+        say("No clients connected.", player);
+        return;
+    }
+
+    for (std::vector<NetComputer *>::const_iterator it = talkers.begin(),
+         it_end = talkers.end(); it != it_end; ++it)
+    {
+        const GameClient *client = static_cast<GameClient *>(*it);
+        const TrafficStats &traffic = client->getTraffic();
+
+        std::stringstream str;
+        str << std::fixed << std::setprecision(1);
+        if (Entity *character = client->character)
+            str << character->getComponent<BeingComponent>()->getName();
+        else
+            str << "(not logged in)";
+        str << " " << *client
+            << ": in " << traffic.getInputRate() / 1024 << " KiB/s"
+            << " (" << traffic.getBytesIn() / 1024 << " KiB, "
+            << traffic.getPacketsIn() << " packets)"
+            << ", out " << traffic.getOutputRate() / 1024 << " KiB/s"
+            << " (" << traffic.getBytesOut() / 1024 << " KiB, "
+            << traffic.getPacketsOut() << " packets)"
+            << ", RTT " << client->getRoundTripTime() << " ms"
+            << ", loss " << client->getPacketLoss() * 100 << "%";
+        say(str.str(), player);
+
+        const std::vector<TrafficStats::MessageTraffic> messages =
+                traffic.getTopMessages(3);
+        for (std::vector<TrafficStats::MessageTraffic>::const_iterator
+             m = messages.begin(), m_end = messages.end(); m != m_end; ++m)
+        {
+            std::stringstream line;
+            if (m->id == TrafficStats::UNKNOWN_MESSAGE)
+                line << "  unknown";
+            else
+                line << "  0x" << std::hex << std::setw(4)
+                     << std::setfill('0') << m->id << std::dec;
+            line << ": in " << m->packetsIn << " (" << m->bytesIn << " B)"
+                 << ", out " << m->packetsOut << " (" << m->bytesOut << " B)";
+            say(line.str(), player);
+        }
+    }
+}
+
+static void handleProfile(Entity *player, std::string &args)
+{
+    const std::string action = getArgument(args);
+    const std::string value = getArgument(args);
+
+    if (action.empty())
+    {
+        std::stringstream str;
+        str << "The profiler is " << (Profiler::isRunning() ? "running"
+                                                            : "stopped")
+            << ", " << Profiler::getSampleCount() << " samples taken, "
+            << Profiler::getDroppedCount() << " dropped.";
+        say(str.str(), player);
+    }
+    else if (action == "start")
+    {
+        int frequency = 0;
+        if (!value.empty())
+        {
+            if (!utils::isNumeric(value))
+            {
+                say("Invalid frequency.", player);
+                return;
+            }
+            frequency = utils::stringToInt(value);
+        }
+
+        if (Profiler::start(frequency))
+            say("Profiler started.", player);
+        else if (Profiler::isRunning())
+            say("The profiler is running already.", player);
+        else
+            say("The profiler could not be started.", player);
+    }
+    else if (action == "stop")
+    {
+        if (!Profiler::isRunning())
+        {
+            say("The profiler is not running.", player);
+            return;
+        }
+
+        Profiler::stop();
+        if (Profiler::write())
+            say("Profile written.", player);
+        else
+            say("The profile could not be written.", player);
+    }
+    else
+    {
+        say("Invalid action, use start or stop.", player);
+    }
+}
+
 void CommandHandler::handleCommand(Entity *player,
                                    const std::string &command)
 {
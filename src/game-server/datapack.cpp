@@ -0,0 +1,376 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/datapack.h"
+
+#include "common/resourcemanager.h"
+#include "utils/logger.h"
+#include "utils/xml.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+/**
+ * Layout of a pack file: the header, the source files, the elements, the
+ * attributes and the string table. Packs never leave the machine that wrote
+ * them, so the host byte order is used.
+ */
+static const uint32_t MAGIC = 0x4b50534d;   // "MSPK" on little endian hosts
+
+/**
+ * Increase whenever the layout changes.
+ */
+static const uint32_t VERSION = 1;
+
+struct PackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileCount;
+    uint32_t elementCount;
+    uint32_t attributeCount;
+    uint32_t stringsSize;
+};
+
+template< typename T >
+static void append(std::string &buffer, const T *data, size_t count)
+{
+    buffer.append(reinterpret_cast<const char *>(data), sizeof(T) * count);
+}
+
+template< typename T >
+static void extract(const char *&data, std::vector<T> &records, size_t count)
+{
+    const T *begin = reinterpret_cast<const T *>(data);
+    records.assign(begin, begin + count);
+    data += sizeof(T) * count;
+}
+
+static std::string hashFile(const std::string &filename)
+{
+    int size;
+    char *data = ResourceManager::loadFile(filename, size);
+    if (!data)
+        return std::string();
+
+    const std::string hash = sha256(std::string(data, size));
+    free(data);
+    return hash;
+}
+
+void DataPack::clear()
+{
+    mElements.clear();
+    mAttributes.clear();
+    mFiles.clear();
+    mStrings.clear();
+    mStringOffsets.clear();
+}
+
+bool DataPack::compile(const std::string &settingsFile)
+{
+    clear();
+
+    std::set<std::string> includeStack;
+    const bool result = compileFile(settingsFile, includeStack);
+
+    mStringOffsets.clear();
+    return result;
+}
+
+bool DataPack::compileFile(const std::string &filename,
+                           std::set<std::string> &includeStack)
+{
+    XML::Document doc(filename);
+    xmlNodePtr node = doc.rootNode();
+
+    // FIXME: check root node's name when bjorn decides it's time
+    if (!node /*|| !xmlStrEqual(node->name, BAD_CAST "settings") */)
+    {
+        LOG_ERROR("Data pack: " << filename
+                  << " is not a valid database file!");
+        return false;
+    }
+
+    SourceFile file;
+    file.path = addString(filename);
+    const std::string hash = hashFile(filename);
+    std::memset(file.hash, 0, sizeof(file.hash));
+    std::memcpy(file.hash, hash.data(),
+                std::min(hash.size(), sizeof(file.hash)));
+
+    const uint32_t fileIndex = mFiles.size();
+    mFiles.push_back(file);
+
+    includeStack.insert(filename);
+
+    for_each_xml_child_node(childNode, node)
+    {
+        if (childNode->type != XML_ELEMENT_NODE)
+            continue;
+
+        if (!xmlStrEqual(childNode->name, BAD_CAST "include"))
+        {
+            compileElement(childNode, fileIndex, NO_PARENT);
+            continue;
+        }
+
+        const std::string includeFile =
+                XML::getProperty(childNode, "file", std::string());
+        if (includeFile.empty())
+            continue;
+
+        // build absolute path path
+        const ResourceManager::splittedPath splittedPath =
+                ResourceManager::splitFileNameAndPath(filename);
+        const std::string realIncludeFile = ResourceManager::cleanPath(
+                ResourceManager::joinPaths(splittedPath.path, includeFile));
+
+        // check if we're not entering a loop
+        if (includeStack.find(realIncludeFile) != includeStack.end())
+        {
+            LOG_ERROR("Circular include loop detecting while including "
+                      << includeFile << " from " << filename);
+        }
+        else if (!compileFile(realIncludeFile, includeStack))
+        {
+            return false;
+        }
+    }
+
+    includeStack.erase(filename);
+    return true;
+}
+
+void DataPack::compileElement(xmlNodePtr node, uint32_t file,
+                              uint32_t parent)
+{
+    Element element;
+    element.name = addString((const char *) node->name);
+    element.file = file;
+    element.parent = parent;
+    element.firstAttribute = mAttributes.size();
+
+    for (xmlAttrPtr attr = node->properties; attr; attr = attr->next)
+    {
+        xmlChar *value = xmlNodeListGetString(node->doc, attr->children, 1);
+        Attribute attribute;
+        attribute.name = addString((const char *) attr->name);
+        attribute.value = addString(value ? (const char *) value : "");
+        mAttributes.push_back(attribute);
+        xmlFree(value);
+    }
+
+    element.attributeCount = mAttributes.size() - element.firstAttribute;
+
+    const uint32_t index = mElements.size();
+    mElements.push_back(element);
+
+    for_each_xml_child_node(childNode, node)
+    {
+        if (childNode->type == XML_ELEMENT_NODE)
+            compileElement(childNode, file, index);
+    }
+}
+
+uint32_t DataPack::addString(const std::string &string)
+{
+    std::map<std::string, uint32_t>::const_iterator it =
+            mStringOffsets.find(string);
+    if (it != mStringOffsets.end())
+        return it->second;
+
+    const uint32_t offset = mStrings.size();
+    mStrings.append(string.c_str(), string.size() + 1);
+    mStringOffsets[string] = offset;
+    return offset;
+}
+
+bool DataPack::read(const std::string &packFile)
+{
+    clear();
+
+    std::ifstream file(packFile.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    const std::string buffer = stream.str();
+
+    if (buffer.size() < sizeof(PackHeader))
+        return false;
+
+    PackHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION)
+        return false;
+
+    const uint64_t expectedSize = sizeof(PackHeader) +
+            uint64_t(header.fileCount) * sizeof(SourceFile) +
+            uint64_t(header.elementCount) * sizeof(Element) +
+            uint64_t(header.attributeCount) * sizeof(Attribute) +
+            header.stringsSize;
+
+    if (buffer.size() != expectedSize || header.stringsSize == 0 ||
+        header.fileCount == 0 || buffer[buffer.size() - 1] != '\0')
+    {
+        LOG_WARN("Data pack: " << packFile << " is damaged.");
+        return false;
+    }
+
+    const char *data = buffer.data() + sizeof(PackHeader);
+    extract(data, mFiles, header.fileCount);
+    extract(data, mElements, header.elementCount);
+    extract(data, mAttributes, header.attributeCount);
+    mStrings.assign(data, header.stringsSize);
+
+    // Check all the references before trusting them
+    bool valid = true;
+    for (unsigned i = 0; i < mFiles.size(); ++i)
+        valid &= mFiles[i].path < header.stringsSize;
+    for (unsigned i = 0; i < mAttributes.size(); ++i)
+        valid &= mAttributes[i].name < header.stringsSize &&
+                 mAttributes[i].value < header.stringsSize;
+    for (unsigned i = 0; i < mElements.size(); ++i)
+    {
+        const Element &element = mElements[i];
+        valid &= element.name < header.stringsSize &&
+                 element.file < header.fileCount &&
+                 (element.parent == NO_PARENT || element.parent < i) &&
+                 element.firstAttribute <= header.attributeCount &&
+                 element.attributeCount <=
+                     header.attributeCount - element.firstAttribute;
+    }
+
+    if (!valid)
+    {
+        LOG_WARN("Data pack: " << packFile << " is damaged.");
+        clear();
+    }
+    return valid;
+}
+
+bool DataPack::write(const std::string &packFile) const
+{
+    PackHeader header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.fileCount = mFiles.size();
+    header.elementCount = mElements.size();
+    header.attributeCount = mAttributes.size();
+    header.stringsSize = mStrings.size();
+
+    std::string buffer;
+    append(buffer, &header, 1);
+    append(buffer, mFiles.data(), mFiles.size());
+    append(buffer, mElements.data(), mElements.size());
+    append(buffer, mAttributes.data(), mAttributes.size());
+    buffer += mStrings;
+
+    // Written aside first, so that a server never reads half a pack
+    const std::string tempFile = packFile + ".new";
+    {
+        std::ofstream file(tempFile.c_str(),
+                           std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(buffer.data(), buffer.size()))
+        {
+            LOG_WARN("Data pack: unable to write " << tempFile);
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(packFile.c_str());
+#endif
+    if (std::rename(tempFile.c_str(), packFile.c_str()) != 0)
+    {
+        LOG_WARN("Data pack: unable to write " << packFile << ": "
+                 << std::strerror(errno));
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    LOG_INFO("Data pack: wrote " << mElements.size() << " elements from "
+             << mFiles.size() << " files to " << packFile);
+    return true;
+}
+
+bool DataPack::isUpToDate(const std::string &settingsFile) const
+{
+    if (mFiles.empty() || settingsFile != getString(mFiles.front().path))
+        return false;
+
+    for (std::vector<SourceFile>::const_iterator it = mFiles.begin(),
+         it_end = mFiles.end(); it != it_end; ++it)
+    {
+        const std::string hash = hashFile(getString(it->path));
+        if (hash.compare(0, std::string::npos, it->hash, sizeof(it->hash)))
+        {
+            LOG_INFO("Data pack: " << getString(it->path) << " changed.");
+            return false;
+        }
+    }
+    return true;
+}
+
+void DataPack::visit(const Visitor &visitor) const
+{
+    // The managers read XML nodes, so the elements are turned back into a
+    // tree. This is cheap next to parsing the files.
+    xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
+    xmlNodePtr root = xmlNewDocNode(doc, 0, BAD_CAST "settings", 0);
+    xmlDocSetRootElement(doc, root);
+
+    std::vector<xmlNodePtr> nodes(mElements.size());
+    for (unsigned i = 0; i < mElements.size(); ++i)
+    {
+        const Element &element = mElements[i];
+        xmlNodePtr node = xmlNewDocNode(doc, 0,
+                                        BAD_CAST getString(element.name), 0);
+
+        for (uint32_t a = element.firstAttribute,
+             a_end = element.firstAttribute + element.attributeCount;
+             a < a_end; ++a)
+        {
+            xmlNewProp(node, BAD_CAST getString(mAttributes[a].name),
+                       BAD_CAST getString(mAttributes[a].value));
+        }
+
+        xmlAddChild(element.parent == NO_PARENT ? root
+                                                : nodes[element.parent],
+                    node);
+        nodes[i] = node;
+    }
+
+    for (unsigned i = 0; i < mElements.size(); ++i)
+    {
+        const Element &element = mElements[i];
+        if (element.parent == NO_PARENT)
+            visitor(nodes[i], getString(mFiles[element.file].path));
+    }
+
+    xmlFreeDoc(doc);
+}
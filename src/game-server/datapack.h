@@ -0,0 +1,132 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATAPACK_H
+#define DATAPACK_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <libxml/tree.h>
+
+#include "utils/sha256.h"
+
+/**
+ * The game settings with all their includes resolved, kept as flat tables of
+ * elements and attributes referring to a string table.
+ *
+ * A pack is either compiled from the settings files or read back from a
+ * file written earlier, which takes a single read instead of parsing every
+ * included file. The pack remembers the hash of every file it was compiled
+ * from so that a stale pack can be told apart.
+ */
+class DataPack
+{
+    public:
+        typedef std::function<void (xmlNodePtr node,
+                                    const std::string &filename)> Visitor;
+
+        /**
+         * Reads the settings file and the files it includes.
+         * @return false when one of the files is missing or invalid.
+         */
+        bool compile(const std::string &settingsFile);
+
+        /**
+         * Reads a pack written with write().
+         * @return false when the pack is missing, damaged or was written by
+         *         another version.
+         */
+        bool read(const std::string &packFile);
+
+        /**
+         * Writes the pack to a file.
+         */
+        bool write(const std::string &packFile) const;
+
+        /**
+         * Tells whether the pack was made from the given settings file and
+         * none of the files it was made from changed since.
+         */
+        bool isUpToDate(const std::string &settingsFile) const;
+
+        /**
+         * Calls the visitor for each element found at the top of the
+         * settings files, in the order they are read. The includes are
+         * resolved already and are not visited.
+         */
+        void visit(const Visitor &visitor) const;
+
+        unsigned getFileCount() const
+        { return mFiles.size(); }
+
+        unsigned getElementCount() const
+        { return mElements.size(); }
+
+    private:
+        struct Element
+        {
+            uint32_t name;
+            uint32_t file;
+            uint32_t parent;            /**< Index, or NO_PARENT */
+            uint32_t firstAttribute;
+            uint32_t attributeCount;
+        };
+
+        struct Attribute
+        {
+            uint32_t name;
+            uint32_t value;
+        };
+
+        struct SourceFile
+        {
+            uint32_t path;
+            char hash[SHA256_HASH_LENGTH];
+        };
+
+        static const uint32_t NO_PARENT = 0xFFFFFFFF;
+
+        void clear();
+
+        bool compileFile(const std::string &filename,
+                         std::set<std::string> &includeStack);
+
+        void compileElement(xmlNodePtr node, uint32_t file, uint32_t parent);
+
+        uint32_t addString(const std::string &string);
+
+        const char *getString(uint32_t offset) const
+        { return mStrings.c_str() + offset; }
+
+        std::vector<Element> mElements;     /**< Parents before children */
+        std::vector<Attribute> mAttributes;
+        std::vector<SourceFile> mFiles;     /**< Settings file first */
+        std::string mStrings;
+
+        /** Offsets of the strings added while compiling. */
+        std::map<std::string, uint32_t> mStringOffsets;
+};
+
+#endif // DATAPACK_H
@@ -82,6 +82,9 @@ class Entity : public sigc::trackable
         static IdManager<Entity> mIdManager;
 
         friend Entity *findEntity(unsigned id);
+
+        template <typename Function>
+        friend void forEachEntity(Function function);
 };
 
 /**
@@ -92,6 +95,16 @@ inline Entity *findEntity(unsigned id)
     return Entity::mIdManager.find(id);
 }
 
+/**
+ * Calls the function for every entity, including those not on a map. The
+ * function must not create or delete entities.
+ */
+template <typename Function>
+inline void forEachEntity(Function function)
+{
+    Entity::mIdManager.forEach(function);
+}
+
 inline unsigned Entity::getId() const
 {
     return mId;
@@ -0,0 +1,252 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/flightrecorder.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
+#include "utils/logger.h"
+#include "utils/metrics.h"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEFAULT_SLOW_TICK_FILE "manaserv-slowticks.log"
+
+namespace FlightRecorder
+{
+
+/**
+ * What is known about one tick. Durations are in microseconds.
+ */
+struct TickRecord
+{
+    int tick;
+    int skipped;
+    uint64_t start;
+    uint64_t total;
+    uint64_t phases[PHASE_COUNT];
+
+    int mapId;
+    uint64_t mapTime;
+    int scriptRef;
+    uint64_t scriptTime;
+    int messageId;
+    uint64_t messageTime;
+    unsigned messageCount;
+};
+
+static const char *phaseNames[PHASE_COUNT] =
+{
+    "account",
+    "messages",
+    "scripts",
+    "map_update",
+    "move",
+    "inform",
+    "delayed_events",
+    "flush"
+};
+
+static std::vector<TickRecord> records;   /**< Ring buffer of the ticks */
+static unsigned nextRecord = 0;
+static TickRecord *current = 0;           /**< Tick being recorded */
+static int lastDumpedTick = -1;
+static uint64_t budget;
+static std::string dumpFile;
+
+void initialize()
+{
+    budget = Configuration::getValue("game_slowTickBudget",
+                                     WORLD_TICK_MS) * 1000;
+    dumpFile = Configuration::getValue("log_slowTickFile",
+                                       std::string(DEFAULT_SLOW_TICK_FILE));
+
+    const int history = Configuration::getValue("game_slowTickHistory", 50);
+    records.assign(history > 0 ? history : 1, TickRecord());
+    for (unsigned i = 0; i < records.size(); ++i)
+        records[i].tick = -1;
+    nextRecord = 0;
+    current = 0;
+}
+
+void beginTick(int tick, int skipped)
+{
+    if (records.empty())
+        return;
+
+    current = &records[nextRecord];
+    nextRecord = (nextRecord + 1) % records.size();
+
+    current->tick = tick;
+    current->skipped = skipped;
+    current->start = Metrics::now();
+    current->total = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i)
+        current->phases[i] = 0;
+    current->mapId = -1;
+    current->mapTime = 0;
+    current->scriptRef = -1;
+    current->scriptTime = 0;
+    current->messageId = -1;
+    current->messageTime = 0;
+    current->messageCount = 0;
+}
+
+static std::string formatMs(uint64_t duration)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << duration / 1000.0;
+    return out.str();
+}
+
+static void writeRecord(std::ostream &out, const TickRecord &record,
+                        uint64_t steadyNow, time_t wallNow)
+{
+    char date[32];
+    const time_t started =
+            wallNow - time_t((steadyNow - record.start) / 1000000);
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S",
+                  std::localtime(&started));
+
+    out << "tick=" << record.tick << " time=\"" << date << "\""
+        << " total=" << formatMs(record.total);
+    if (record.skipped)
+        out << " skipped=" << record.skipped;
+
+    uint64_t accounted = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        out << ' ' << phaseNames[i] << '=' << formatMs(record.phases[i]);
+        accounted += record.phases[i];
+    }
+    out << " other="
+        << formatMs(record.total > accounted ? record.total - accounted : 0);
+
+    if (record.mapId != -1)
+    {
+        const MapComposite *map = MapManager::getMap(record.mapId);
+        out << " map=" << record.mapId;
+        if (map)
+            out << '(' << map->getName() << ')';
+        out << ':' << formatMs(record.mapTime);
+    }
+    if (record.scriptRef != -1)
+        out << " script=" << record.scriptRef << ':'
+            << formatMs(record.scriptTime);
+    if (record.messageId != -1)
+        out << " message=0x" << std::hex << std::setw(4) << std::setfill('0')
+            << record.messageId << std::dec << std::setfill(' ') << ':'
+            << formatMs(record.messageTime)
+            << " messages=" << record.messageCount;
+    out << '\n';
+}
+
+/**
+ * Appends the recorded ticks that were not written yet to the dump file.
+ */
+static void dump()
+{
+    std::ofstream out(dumpFile.c_str(), std::ios::app);
+    if (!out)
+    {
+        LOG_WARN("Flight recorder: unable to write to " << dumpFile);
+        return;
+    }
+
+    const uint64_t steadyNow = Metrics::now();
+    const time_t wallNow = std::time(0);
+
+    out << "# Tick " << current->tick << " took "
+        << formatMs(current->total) << " ms, budget " << formatMs(budget)
+        << " ms (times in ms)\n";
+
+    // Oldest first, starting right after the tick just recorded
+    for (unsigned i = 0; i < records.size(); ++i)
+    {
+        const TickRecord &record =
+                records[(nextRecord + i) % records.size()];
+        if (record.tick > lastDumpedTick)
+            writeRecord(out, record, steadyNow, wallNow);
+    }
+
+    lastDumpedTick = current->tick;
+}
+
+void endTick()
+{
+    if (!current)
+        return;
+
+    current->total = Metrics::now() - current->start;
+    if (budget > 0 && current->total > budget)
+    {
+        LOG_WARN("Tick " << current->tick << " took "
+                 << formatMs(current->total) << " ms, recorded in "
+                 << dumpFile);
+        dump();
+    }
+    current = 0;
+}
+
+void addPhaseTime(Phase phase, uint64_t duration)
+{
+    if (current)
+        current->phases[phase] += duration;
+}
+
+void noteMap(const MapComposite *map, uint64_t duration)
+{
+    if (current && duration >= current->mapTime)
+    {
+        current->mapId = map->getID();
+        current->mapTime = duration;
+    }
+}
+
+void noteScript(int ref, uint64_t duration)
+{
+    if (current && duration >= current->scriptTime)
+    {
+        current->scriptRef = ref;
+        current->scriptTime = duration;
+    }
+}
+
+void noteMessage(int id, uint64_t duration)
+{
+    if (!current)
+        return;
+
+    ++current->messageCount;
+    if (duration >= current->messageTime)
+    {
+        current->messageId = id;
+        current->messageTime = duration;
+    }
+}
+
+} // namespace FlightRecorder
@@ -0,0 +1,86 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <stdint.h>
+
+class MapComposite;
+
+/**
+ * Remembers where the time went during the last world ticks, and writes it
+ * to a file whenever a tick takes longer than its budget, so that lag spikes
+ * can be explained after the fact.
+ *
+ * Only a few durations are stored per tick: the time spent in each phase,
+ * and the map, script function and message type that took the longest.
+ * Everything is meant to be called from the main thread.
+ */
+namespace FlightRecorder
+{
+    enum Phase
+    {
+        PHASE_ACCOUNT,          /**< Account server messages and syncs */
+        PHASE_MESSAGES,         /**< Client messages */
+        PHASE_SCRIPTS,          /**< Script update callback */
+        PHASE_MAP_UPDATE,       /**< Entities and map scripts */
+        PHASE_MOVE,             /**< Moving beings and their zones */
+        PHASE_INFORM,           /**< Telling clients about the changes */
+        PHASE_DELAYED_EVENTS,   /**< Inserting, removing and warping */
+        PHASE_FLUSH,            /**< Sending the client messages */
+        PHASE_COUNT
+    };
+
+    /**
+     * Reads the budget, history length and dump file from the
+     * configuration.
+     */
+    void initialize();
+
+    /**
+     * Starts recording a tick.
+     *
+     * @param skipped the number of ticks skipped just before this one.
+     */
+    void beginTick(int tick, int skipped);
+
+    /**
+     * Ends recording the current tick, and dumps the recorded ticks when it
+     * went over budget.
+     */
+    void endTick();
+
+    /**
+     * Adds time spent in a phase of the current tick, in microseconds.
+     */
+    void addPhaseTime(Phase phase, uint64_t duration);
+
+    /**
+     * Report time spent on a map, a script function or a client message
+     * during the current tick, in microseconds. Only the longest of each
+     * kind is kept. Ignored outside of ticks.
+     */
+    void noteMap(const MapComposite *map, uint64_t duration);
+    void noteScript(int ref, uint64_t duration);
+    void noteMessage(int id, uint64_t duration);
+}
+
+#endif // FLIGHTRECORDER_H
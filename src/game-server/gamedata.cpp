@@ -0,0 +1,218 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/gamedata.h"
+
+#include "game-server/abilitycomponent.h"
+#include "game-server/being.h"
+#include "game-server/charactercomponent.h"
+#include "game-server/entity.h"
+#include "game-server/inventory.h"
+#include "game-server/item.h"
+#include "game-server/monster.h"
+#include "game-server/spawnareacomponent.h"
+
+GameData::GameData():
+    mMonsterManager(&mItemManager, &mAbilityManager)
+{
+    mAbilityManager.initialize();
+    mItemManager.initialize();
+    mMonsterManager.initialize();
+    mEmoteManager.initialize();
+    mStatusManager.initialize();
+}
+
+bool GameData::readNode(xmlNodePtr node, const std::string &filename)
+{
+    if (xmlStrEqual(node->name, BAD_CAST "ability"))
+    {
+        // ability config
+        mAbilityManager.readAbilityNode(node, filename);
+    }
+    else if (xmlStrEqual(node->name, BAD_CAST "slot"))
+    {
+        // equipement slot config
+        mItemManager.readEquipSlotNode(node);
+    }
+    else if (xmlStrEqual(node->name, BAD_CAST "item"))
+    {
+        // item config
+        mItemManager.readItemNode(node, filename);
+    }
+    else if (xmlStrEqual(node->name, BAD_CAST "monster"))
+    {
+        // monster config
+        mMonsterManager.readMonsterNode(node, filename);
+    }
+    else if (xmlStrEqual(node->name, BAD_CAST "emote"))
+    {
+        // emote config
+        mEmoteManager.readEmoteNode(node, filename);
+    }
+    else if (xmlStrEqual(node->name, BAD_CAST "status-effect"))
+    {
+        // status effects config
+        mStatusManager.readStatusNode(node, filename);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void GameData::checkStatus()
+{
+    mAbilityManager.checkStatus();
+    mItemManager.checkStatus();
+    mMonsterManager.checkStatus();
+    mEmoteManager.checkStatus();
+    mStatusManager.checkStatus();
+}
+
+void GameData::copyCallbacks(const GameData &other)
+{
+    mAbilityManager.copyCallbacks(other.mAbilityManager);
+    mItemManager.copyCallbacks(other.mItemManager);
+    mMonsterManager.copyCallbacks(other.mMonsterManager);
+    mStatusManager.copyCallbacks(other.mStatusManager);
+}
+
+void GameData::publish()
+{
+    abilityManager = &mAbilityManager;
+    itemManager = &mItemManager;
+    monsterManager = &mMonsterManager;
+    emoteManager = &mEmoteManager;
+    statusManager = &mStatusManager;
+}
+
+void GameData::rebind(Entity &entity) const
+{
+    // Types removed from the data are left as they are, until the entity
+    // goes away
+
+    if (SpawnAreaComponent *spawnArea =
+            entity.findComponent<SpawnAreaComponent>())
+    {
+        const int id = spawnArea->getSpecy()->getId();
+        if (MonsterClass *specy = mMonsterManager.getMonster(id))
+            spawnArea->setSpecy(specy);
+    }
+
+    if (MonsterComponent *monster = entity.findComponent<MonsterComponent>())
+    {
+        const int id = monster->getSpecy()->getId();
+        if (MonsterClass *specy = mMonsterManager.getMonster(id))
+            monster->setSpecy(specy);
+    }
+
+    if (ItemComponent *item = entity.findComponent<ItemComponent>())
+    {
+        const int id = item->getItemClass()->getDatabaseID();
+        if (ItemClass *itemClass = mItemManager.getItem(id))
+            item->setItemClass(itemClass);
+    }
+
+    if (AbilityComponent *abilities = entity.findComponent<AbilityComponent>())
+    {
+        const AbilityMap &abilityMap = abilities->getAbilities();
+        for (AbilityMap::const_iterator it = abilityMap.begin(),
+             it_end = abilityMap.end(); it != it_end; ++it)
+        {
+            if (AbilityManager::AbilityInfo *info =
+                    mAbilityManager.getAbilityInfo(it->first))
+            {
+                abilities->findAbility(it->first)->second.abilityInfo = info;
+            }
+        }
+    }
+
+    if (BeingComponent *being = entity.findComponent<BeingComponent>())
+    {
+        const StatusEffects &statusEffects = being->getStatusEffects();
+        for (StatusEffects::const_iterator it = statusEffects.begin(),
+             it_end = statusEffects.end(); it != it_end; ++it)
+        {
+            if (StatusEffect *status = mStatusManager.getStatus(it->first))
+                being->setStatusEffect(it->first, status);
+        }
+    }
+
+    if (entity.hasComponent<CharacterComponent>())
+        Inventory(&entity).updateItemEffects();
+}
+
+bool GameData::isReferenced(const Entity &entity) const
+{
+    if (SpawnAreaComponent *spawnArea =
+            entity.findComponent<SpawnAreaComponent>())
+    {
+        MonsterClass *specy = spawnArea->getSpecy();
+        if (mMonsterManager.getMonster(specy->getId()) == specy)
+            return true;
+    }
+
+    if (MonsterComponent *monster = entity.findComponent<MonsterComponent>())
+    {
+        MonsterClass *specy = monster->getSpecy();
+        if (mMonsterManager.getMonster(specy->getId()) == specy)
+            return true;
+    }
+
+    if (ItemComponent *item = entity.findComponent<ItemComponent>())
+    {
+        ItemClass *itemClass = item->getItemClass();
+        if (mItemManager.getItem(itemClass->getDatabaseID()) == itemClass)
+            return true;
+    }
+
+    if (AbilityComponent *abilities = entity.findComponent<AbilityComponent>())
+    {
+        const AbilityMap &abilityMap = abilities->getAbilities();
+        for (AbilityMap::const_iterator it = abilityMap.begin(),
+             it_end = abilityMap.end(); it != it_end; ++it)
+        {
+            if (mAbilityManager.getAbilityInfo(it->first) ==
+                    it->second.abilityInfo)
+                return true;
+        }
+    }
+
+    if (BeingComponent *being = entity.findComponent<BeingComponent>())
+    {
+        const StatusEffects &statusEffects = being->getStatusEffects();
+        for (StatusEffects::const_iterator it = statusEffects.begin(),
+             it_end = statusEffects.end(); it != it_end; ++it)
+        {
+            if (mStatusManager.getStatus(it->first) == it->second.status)
+                return true;
+        }
+    }
+
+    if (CharacterComponent *character =
+            entity.findComponent<CharacterComponent>())
+    {
+        if (character->getItemEffectsSource() == &mItemManager)
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,97 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GAMEDATA_H
+#define GAMEDATA_H
+
+#include <string>
+
+#include <libxml/tree.h>
+
+#include "game-server/abilitymanager.h"
+#include "game-server/emotemanager.h"
+#include "game-server/itemmanager.h"
+#include "game-server/monstermanager.h"
+#include "game-server/statusmanager.h"
+
+class Entity;
+
+/**
+ * One version of the reloadable game data: the abilities, items, monsters,
+ * emotes and status effects, with the managers that hold them.
+ *
+ * A new version can be read while the game goes on with the current one.
+ * It becomes the current one when published, which points the global
+ * managers at it. Entities are then rebound to it, and an old version is
+ * deleted once no entity refers to it anymore. Scripts refer to the classes
+ * by ID, and so always get the current version.
+ *
+ * Attributes and maps are not part of it, as too much depends on them.
+ */
+class GameData
+{
+    public:
+        GameData();
+
+        /**
+         * Passes a node of the settings to the manager it is meant for.
+         * @return false when the node is not part of the game data.
+         */
+        bool readNode(xmlNodePtr node, const std::string &filename);
+
+        /**
+         * Reports what was read.
+         */
+        void checkStatus();
+
+        /**
+         * Takes over the callbacks scripts set on the previous version.
+         */
+        void copyCallbacks(const GameData &other);
+
+        /**
+         * Makes this version the one used by the game.
+         */
+        void publish();
+
+        /**
+         * Points the entity over to this version: its monster, item, ability
+         * and status effect types, when they are still part of it, and the
+         * item effects of characters.
+         */
+        void rebind(Entity &entity) const;
+
+        /**
+         * Returns whether the entity still refers to this version.
+         */
+        bool isReferenced(const Entity &entity) const;
+
+    private:
+        GameData(const GameData &);
+        GameData &operator=(const GameData &);
+
+        AbilityManager mAbilityManager;
+        ItemManager mItemManager;
+        MonsterManager mMonsterManager;
+        EmoteManager mEmoteManager;
+        StatusManager mStatusManager;
+};
+
+#endif // GAMEDATA_H
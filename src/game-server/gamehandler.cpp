@@ -19,7 +19,9 @@
  */
 
 #include <cassert>
+#include <iomanip>
 #include <map>
+#include <sstream>
 
 #include "game-server/gamehandler.h"
 
@@ -29,11 +31,13 @@
 #include "game-server/buysell.h"
 #include "game-server/commandhandler.h"
 #include "game-server/emotemanager.h"
+#include "game-server/flightrecorder.h"
 #include "game-server/inventory.h"
 #include "game-server/item.h"
 #include "game-server/itemmanager.h"
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
 #include "game-server/npc.h"
 #include "game-server/postman.h"
 #include "game-server/state.h"
@@ -42,10 +46,42 @@
 #include "net/messageout.h"
 #include "net/netcomputer.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
 #include "utils/tokendispenser.h"
 
 const unsigned TILES_TO_BE_NEAR = 7;
 
+/**
+ * Stands for the messages the game handler doesn't know, which share one
+ * histogram so that made up IDs can't register new ones.
+ */
+static const int INVALID_MESSAGE_ID = -1;
+
+/**
+ * Returns the histogram of the time spent handling messages with the given
+ * ID. Its count doubles as the number of such messages.
+ */
+static Metrics::Histogram &getMessageHistogram(int id)
+{
+    static std::map<int, Metrics::Histogram *> histograms;
+
+    Metrics::Histogram *&histogram = histograms[id];
+    if (!histogram)
+    {
+        std::ostringstream labels;
+        if (id == INVALID_MESSAGE_ID)
+            labels << "id=\"invalid\"";
+        else
+            labels << "id=\"0x" << std::hex << std::setw(4)
+                   << std::setfill('0') << id << "\"";
+        histogram = &Metrics::histogram("manaserv_game_message_seconds",
+                                        "Time spent handling client messages, "
+                                        "by message ID.",
+                                        labels.str(), 1e-6);
+    }
+    return *histogram;
+}
+
 GameHandler::GameHandler():
     mTokenCollector(this)
 {
@@ -72,6 +108,8 @@ void GameHandler::computerDisconnected(NetComputer *comp)
     }
     else if (Entity *ch = computer.character)
     {
+        mClientsByCharacter.remove(
+                ch->getComponent<CharacterComponent>()->getDatabaseID());
         accountHandler->sendCharacterData(ch);
         ch->getComponent<CharacterComponent>()->disconnected(*ch);
         delete ch;
@@ -84,6 +122,7 @@ void GameHandler::detachClient(Entity *ch)
     auto *component = ch->getComponent<CharacterComponent>();
     GameClient *client = component->getClient();
     assert(client);
+    mClientsByCharacter.remove(component->getDatabaseID());
     client->character = nullptr;
     client->status = CLIENT_LOGIN;
     component->setClient(nullptr);
@@ -99,41 +138,28 @@ void GameHandler::prepareServerChange(Entity *ch)
 void GameHandler::completeServerChange(int id, const std::string &token,
                                        const std::string &address, int port)
 {
-    for (NetComputers::const_iterator i = clients.begin(),
-         i_end = clients.end(); i != i_end; ++i)
-    {
-        GameClient *c = static_cast< GameClient * >(*i);
-        if (c->status == CLIENT_CHANGE_SERVER &&
-            c->character->getComponent<CharacterComponent>()
-                ->getDatabaseID() == id)
-        {
-            MessageOut msg(GPMSG_PLAYER_SERVER_CHANGE);
-            msg.writeString(token, MAGIC_TOKEN_LENGTH);
-            msg.writeString(address);
-            msg.writeInt16(port);
-            c->send(msg);
-            c->character->getComponent<CharacterComponent>()->disconnected(
-                    *c->character);
-            delete c->character;
-            c->character = nullptr;
-            c->status = CLIENT_LOGIN;
-            return;
-        }
-    }
+    GameClient *c = mClientsByCharacter.findById(id);
+    if (!c || c->status != CLIENT_CHANGE_SERVER)
+        return;
+
+    MessageOut msg(GPMSG_PLAYER_SERVER_CHANGE);
+    msg.writeString(token, MAGIC_TOKEN_LENGTH);
+    msg.writeString(address);
+    msg.writeInt16(port);
+    c->send(msg);
+    mClientsByCharacter.remove(id);
+    c->character->getComponent<CharacterComponent>()->disconnected(
+            *c->character);
+    delete c->character;
+    c->character = nullptr;
+    c->status = CLIENT_LOGIN;
 }
 
 void GameHandler::updateCharacter(int charid, int partyid)
 {
-    for (NetComputers::const_iterator i = clients.begin(),
-         i_end = clients.end(); i != i_end; ++i)
-    {
-        GameClient *c = static_cast< GameClient * >(*i);
-        auto *characterComponent =
-                c->character->getComponent<CharacterComponent>();
-
-        if (characterComponent->getDatabaseID() == charid)
-            characterComponent->setParty(partyid);
-    }
+    GameClient *c = mClientsByCharacter.findById(charid);
+    if (c && c->character)
+        c->character->getComponent<CharacterComponent>()->setParty(partyid);
 }
 
 static Entity *findActorNear(Entity *p, int id)
@@ -178,7 +204,10 @@ void GameHandler::processMessage(NetComputer *computer, MessageIn &message)
     if (client.status == CLIENT_LOGIN)
     {
         if (message.getId() != PGMSG_CONNECT)
+        {
+            rejectMessage();
             return;
+        }
 
         std::string magic_token = message.readString(MAGIC_TOKEN_LENGTH);
         client.status = CLIENT_QUEUED; // Before the addPendingClient
@@ -187,9 +216,13 @@ void GameHandler::processMessage(NetComputer *computer, MessageIn &message)
     }
     else if (client.status != CLIENT_CONNECTED)
     {
+        rejectMessage();
         return;
     }
 
+    const uint64_t start = Metrics::now();
+    int histogramId = message.getId();
+
     switch (message.getId())
     {
         case PGMSG_SAY:
@@ -297,8 +330,14 @@ void GameHandler::processMessage(NetComputer *computer, MessageIn &message)
         default:
             LOG_WARN("Invalid message type");
             client.send(MessageOut(XXMSG_INVALID));
+            histogramId = INVALID_MESSAGE_ID;
+            rejectMessage();
             break;
     }
+
+    const uint64_t duration = Metrics::now() - start;
+    getMessageHistogram(histogramId).record(duration);
+    FlightRecorder::noteMessage(message.getId(), duration);
 }
 
 void GameHandler::sendTo(Entity *beingPtr, MessageOut &msg)
@@ -322,34 +361,46 @@ void GameHandler::addPendingCharacter(const std::string &token, Entity *ch)
 
     int id = ch->getComponent<CharacterComponent>()->getDatabaseID();
 
-    for (NetComputer *i : clients)
+    if (GameClient *c = mClientsByCharacter.findById(id))
     {
-        GameClient *c = static_cast< GameClient * >(i);
-        Entity *old_ch = c->character;
-        if (old_ch && id == old_ch->getComponent<CharacterComponent>()->getDatabaseID())
+        if (c->status != CLIENT_CONNECTED)
         {
-            if (c->status != CLIENT_CONNECTED)
-            {
-                /* Either the server is confused, or the client is up to no
-                   good. So ignore the request, and wait for the connections
-                   to properly time out. */
-                return;
-            }
-
-            /* As the connection was not properly closed, the account server
-               has not yet updated its data, so ignore them. Instead, take the
-               already present character, kill its current connection, and make
-               it available for a new connection. */
+            /* Either the server is confused, or the client is up to no
+               good. So ignore the request, and wait for the connections
+               to properly time out. */
             delete ch;
+            return;
+        }
 
-            GameState::remove(old_ch);
-            detachClient(old_ch);
-            MessageOut msg(GPMSG_CONNECT_RESPONSE);
-            msg.writeInt8(ERRMSG_LOGIN_WAS_TAKEN_OVER);
-            c->disconnect(msg);
+        /* As the connection was not properly closed, the account server
+           has not yet updated its data, so ignore them. Instead, take the
+           already present character, kill its current connection, and make
+           it available for a new connection. */
+        Entity *old_ch = c->character;
+        delete ch;
 
-            ch = old_ch;
-            break;
+        GameState::remove(old_ch);
+        detachClient(old_ch);
+        MessageOut msg(GPMSG_CONNECT_RESPONSE);
+        msg.writeInt8(ERRMSG_LOGIN_WAS_TAKEN_OVER);
+        c->disconnect(msg);
+
+        ch = old_ch;
+    }
+    else if (MapComposite *map = ch->getMap())
+    {
+        // The account server may send characters to a map that is still
+        // being loaded, they can only connect once it is active.
+        if (MapManager::isActivating(map->getID()))
+        {
+            MapManager::activateMap(map->getID(),
+                                    [this, token, ch] (MapComposite *m) {
+                if (m)
+                    mTokenCollector.addPendingConnect(token, ch);
+                else
+                    delete ch;
+            });
+            return;
         }
     }
 
@@ -369,6 +420,17 @@ void GameHandler::tokenMatched(GameClient *computer, Entity *character)
 
     MessageOut result(GPMSG_CONNECT_RESPONSE);
 
+    // The map may have failed to load
+    MapComposite *map = character->getMap();
+    if (!map || !map->isActive())
+    {
+        result.writeInt8(ERRMSG_FAILURE);
+        detachClient(character);
+        delete character;
+        computer->disconnect(result);
+        return;
+    }
+
     if (!GameState::insert(character))
     {
         result.writeInt8(ERRMSG_SERVER_FULL);
@@ -377,6 +439,11 @@ void GameHandler::tokenMatched(GameClient *computer, Entity *character)
         computer->disconnect(result);
         return;
     }
+    mClientsByCharacter.insert(characterComponent->getDatabaseID(),
+                               character->getComponent<BeingComponent>()
+                                   ->getName(),
+                               computer);
+
     // Trigger login script bind
     characterComponent->triggerLoginCallback(*character);
 
@@ -405,19 +472,11 @@ void GameHandler::deletePendingConnect(Entity *character)
     delete character;
 }
 
-Entity *GameHandler::getCharacterByNameSlow(const std::string &name) const
+Entity *GameHandler::getCharacterByName(const std::string &name) const
 {
-    for (NetComputers::const_iterator i = clients.begin(),
-         i_end = clients.end(); i != i_end; ++i)
-    {
-        GameClient *c = static_cast< GameClient * >(*i);
-        Entity *ch = c->character;
-        if (ch && ch->getComponent<BeingComponent>()->getName() == name &&
-                c->status == CLIENT_CONNECTED)
-        {
-            return ch;
-        }
-    }
+    GameClient *c = mClientsByCharacter.findByName(name);
+    if (c && c->status == CLIENT_CONNECTED)
+        return c->character;
     return 0;
 }
 
@@ -759,6 +818,7 @@ void GameHandler::handleDisconnect(GameClient &client, MessageIn &message)
     }
     accountHandler->sendCharacterData(client.character);
 
+    mClientsByCharacter.remove(characterComponent->getDatabaseID());
     characterComponent->disconnected(*client.character);
     delete client.character;
     client.character = 0;
@@ -941,28 +1001,26 @@ void GameHandler::handlePartyInvite(GameClient &client, MessageIn &message)
     if (invitee == client.character->getComponent<BeingComponent>()->getName())
         return;
 
-    for (CharacterIterator it(map->getWholeMapIterator()); it; ++it)
+    Entity *inviteeCharacter = getCharacterByName(invitee);
+    if (inviteeCharacter && inviteeCharacter->getMap() == map)
     {
-        if ((*it)->getComponent<BeingComponent>()->getName() == invitee)
+        // calculate if the invitee is within the visual range
+        auto *inviterComponent =
+                client.character->getComponent<ActorComponent>();
+        auto *inviteeComponent =
+                inviteeCharacter->getComponent<ActorComponent>();
+        const Point &inviterPosition = inviterComponent->getPosition();
+        const Point &inviteePosition = inviteeComponent->getPosition();
+        const int dx = std::abs(inviterPosition.x - inviteePosition.x);
+        const int dy = std::abs(inviterPosition.y - inviteePosition.y);
+        if (visualRange > std::max(dx, dy))
         {
-            // calculate if the invitee is within the visual range
-            auto *inviterComponent =
-                    client.character->getComponent<ActorComponent>();
-            auto *inviteeComponent = (*it)->getComponent<ActorComponent>();
-            const Point &inviterPosition = inviterComponent->getPosition();
-            const Point &inviteePosition = inviteeComponent->getPosition();
-            const int dx = std::abs(inviterPosition.x - inviteePosition.x);
-            const int dy = std::abs(inviterPosition.y - inviteePosition.y);
-            if (visualRange > std::max(dx, dy))
-            {
-                MessageOut out(GCMSG_PARTY_INVITE);
-                out.writeString(client.character
-                                ->getComponent<BeingComponent>()->getName());
-                out.writeString(invitee);
-                accountHandler->send(out);
-                return;
-            }
-            break;
+            MessageOut out(GCMSG_PARTY_INVITE);
+            out.writeString(client.character
+                            ->getComponent<BeingComponent>()->getName());
+            out.writeString(invitee);
+            accountHandler->send(out);
+            return;
         }
     }
 
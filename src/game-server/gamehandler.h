@@ -23,6 +23,7 @@
 
 #include "net/connectionhandler.h"
 #include "net/netcomputer.h"
+#include "utils/nameindex.h"
 #include "utils/tokencollector.h"
 
 class Entity;
@@ -108,10 +109,9 @@ class GameHandler: public ConnectionHandler
         void deletePendingConnect(Entity *character);
 
         /**
-         * Gets the character associated to a character name. This method is
-         * slow, so it should never be called for regular operations.
+         * Gets the connected character with the given name.
          */
-        Entity *getCharacterByNameSlow(const std::string &) const;
+        Entity *getCharacterByName(const std::string &) const;
 
     protected:
         NetComputer *computerConnected(ENetPeer *);
@@ -163,6 +163,11 @@ class GameHandler: public ConnectionHandler
          * Container for pending clients and pending connections.
          */
         TokenCollector<GameHandler, GameClient *, Entity *> mTokenCollector;
+
+        /**
+         * Clients with a character, by character database ID and name.
+         */
+        utils::NameIndex<GameClient *> mClientsByCharacter;
 };
 
 extern GameHandler *gameHandler;
@@ -40,6 +40,9 @@ public:
     void free(unsigned id);
     Value *find(unsigned id) const;
 
+    template <typename Function>
+    void forEach(Function function) const;
+
 private:
     std::unordered_map<unsigned, Value*> mIdMap;
     unsigned mLastId;
@@ -70,4 +73,12 @@ inline Value *IdManager<Value>::find(unsigned id) const
     return it != mIdMap.end() ? it->second : nullptr;
 }
 
+template <typename Value>
+template <typename Function>
+inline void IdManager<Value>::forEach(Function function) const
+{
+    for (auto &entry : mIdMap)
+        function(*entry.second);
+}
+
 #endif // IDMANAGER_H
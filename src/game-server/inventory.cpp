@@ -70,16 +70,44 @@ void Inventory::initialize()
             it_end = mPoss->equipment.end(); it != it_end; ++it)
     {
         InventoryData::iterator itemIt = mPoss->inventory.find(*it);
-        const ItemEquipRequirement &equipReq = itemManager->getItem(
-                itemIt->second.itemId)->getItemEquipRequirement();
-        itemIt->second.equipmentSlot = equipReq.equipSlotId;
+        if (ItemClass *item = itemManager->getItem(itemIt->second.itemId))
+        {
+            const ItemEquipRequirement &equipReq =
+                    item->getItemEquipRequirement();
+            itemIt->second.equipmentSlot = equipReq.equipSlotId;
+        }
     }
 
+    applyItemEffects();
+}
+
+void Inventory::updateItemEffects()
+{
+    auto *characterComponent = mCharacter->getComponent<CharacterComponent>();
+    ItemManager *source = characterComponent->getItemEffectsSource();
+    if (source == itemManager)
+        return;
+
+    // The game data was reloaded since the effects were applied. They are
+    // removed the way they were applied, as the modifiers may have changed.
+    removeItemEffects(*source);
+    characterComponent->setItemEffectsSource(itemManager);
+
+    // Characters still waiting for their client get the inventory when it
+    // connects
+    GameClient *client = characterComponent->getClient();
+    if (applyItemEffects() && client && client->status == CLIENT_CONNECTED)
+        sendFull();
+}
+
+bool Inventory::applyItemEffects()
+{
     /*
      * Construct a set of item Ids to keep track of duplicate item Ids.
      */
     std::set<unsigned> itemIds;
     std::set<unsigned> equipmentIds;
+    bool deleted = false;
 
     /*
      * Construct a set of itemIds to keep track of duplicate itemIds.
@@ -109,8 +137,35 @@ void Inventory::initialize()
                      << it->second.itemId << " from the equipment of '"
                      << mCharacter->getComponent<BeingComponent>()->getName()
                      << "'!");
+            mPoss->equipment.erase(it->first);
             mPoss->inventory.erase(it++);
+            deleted = true;
+        }
+    }
+
+    return deleted;
+}
+
+void Inventory::removeItemEffects(const ItemManager &source)
+{
+    std::set<unsigned> itemIds;
+    std::set<unsigned> equipmentIds;
+
+    for (InventoryData::const_iterator it = mPoss->inventory.begin(),
+         it_end = mPoss->inventory.end(); it != it_end; ++it)
+    {
+        ItemClass *item = source.getItem(it->second.itemId);
+        if (!item)
+            continue;
+
+        if (it->second.equipmentSlot != 0 &&
+            equipmentIds.insert(it->second.itemId).second)
+        {
+            item->dispellTrigger(mCharacter, ITT_UNEQUIP);
         }
+
+        if (itemIds.insert(it->second.itemId).second)
+            item->dispellTrigger(mCharacter, ITT_LEAVE_INVY);
     }
 }
 
@@ -125,6 +180,8 @@ unsigned Inventory::insert(unsigned itemId, unsigned amount)
     if (!itemId || !amount)
         return 0;
 
+    updateItemEffects();
+
     MessageOut invMsg(GPMSG_INVENTORY);
     ItemClass *item = itemManager->getItem(itemId);
     if (!item) {
@@ -231,6 +288,8 @@ unsigned Inventory::remove(unsigned itemId, unsigned amount)
     if (!itemId || !amount)
         return amount;
 
+    updateItemEffects();
+
     LOG_DEBUG("Inventory: Request remove of " << amount << " item(s) id: "
               << itemId << " for character: '"
               << mCharacter->getComponent<BeingComponent>()->getName()
@@ -281,7 +340,10 @@ unsigned Inventory::remove(unsigned itemId, unsigned amount)
     }
 
     if (triggerLeaveInventory)
-        itemManager->getItem(itemId)->useTrigger(mCharacter, ITT_LEAVE_INVY);
+    {
+        if (ItemClass *ic = itemManager->getItem(itemId))
+            ic->useTrigger(mCharacter, ITT_LEAVE_INVY);
+    }
 
     if (invMsg.getLength() > 2)
         gameHandler->sendTo(mCharacter, invMsg);
@@ -291,6 +353,8 @@ unsigned Inventory::remove(unsigned itemId, unsigned amount)
 
 unsigned Inventory::removeFromSlot(unsigned slot, unsigned amount)
 {
+    updateItemEffects();
+
     InventoryData::iterator it = mPoss->inventory.find(slot);
 
     // When the given slot doesn't exist, we can't remove anything
@@ -389,8 +453,8 @@ bool Inventory::checkEquipmentCapacity(unsigned equipmentSlot,
         if (itemIt->second.equipmentSlot == equipmentSlot)
         {
             const int itemId = itemIt->second.itemId;
-            const ItemClass *item = itemManager->getItem(itemId);
-            capacity -= item->getItemEquipRequirement().capacityRequired;
+            if (const ItemClass *item = itemManager->getItem(itemId))
+                capacity -= item->getItemEquipRequirement().capacityRequired;
         }
     }
 
@@ -404,6 +468,8 @@ bool Inventory::checkEquipmentCapacity(unsigned equipmentSlot,
 
 bool Inventory::equip(int inventorySlot)
 {
+    updateItemEffects();
+
     // Test inventory slot existence
     InventoryData::iterator itemIt;
     if ((itemIt = mPoss->inventory.find(inventorySlot)) == mPoss->inventory.end())
@@ -422,9 +488,13 @@ bool Inventory::equip(int inventorySlot)
     if (!testEquipScriptRequirements(item.itemId))
         return false;
 
+    ItemClass *itemClass = itemManager->getItem(item.itemId);
+    if (!itemClass)
+        return false;
+
     // Test the equip requirements. If none, it's not an equipable item.
     const ItemEquipRequirement &equipReq =
-        itemManager->getItem(item.itemId)->getItemEquipRequirement();
+        itemClass->getItemEquipRequirement();
     if (!equipReq.equipSlotId)
     {
         LOG_DEBUG("No equip requirements for item id: " << item.itemId
@@ -535,6 +605,8 @@ bool Inventory::unequipAll(unsigned itemId)
 
 bool Inventory::unequip(unsigned itemSlot)
 {
+    updateItemEffects();
+
     InventoryData::iterator it = mPoss->inventory.find(itemSlot);
     if (it == mPoss->inventory.end())
     {
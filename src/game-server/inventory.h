@@ -25,6 +25,7 @@
 #include "net/messageout.h"
 
 class ItemClass;
+class ItemManager;
 
 /**
  * Class used to handle Character possessions and prepare outgoing messages.
@@ -57,6 +58,14 @@ class Inventory
          */
         void initialize();
 
+        /**
+         * Applies the item effects again when the game data was reloaded
+         * since they were applied. Done before any change of the inventory
+         * or equipment, so that effects are always removed through the item
+         * types that applied them.
+         */
+        void updateItemEffects();
+
         /**
          * Equips item from given inventory slot.
          * @param inventorySlot The slot in which the target item is in.
@@ -164,6 +173,19 @@ class Inventory
         void updateEquipmentTrigger(unsigned oldId, unsigned itemId);
         void updateEquipmentTrigger(ItemClass *oldI, ItemClass *newI);
 
+        /**
+         * Applies the inventory and equipment effects through the item
+         * manager in use, deleting the items it doesn't know.
+         * @returns whether items were deleted.
+         */
+        bool applyItemEffects();
+
+        /**
+         * Removes the inventory and equipment effects through the given
+         * item manager.
+         */
+        void removeItemEffects(const ItemManager &source);
+
         Possessions *mPoss; /**< Pointer to the modified possessions. */
 
         Entity *mCharacter; /**< Character to notify. */
@@ -131,6 +131,14 @@ bool ItemClass::useTrigger(Entity *itemUser, ItemTriggerType trigger)
     return ret;
 }
 
+void ItemClass::dispellTrigger(Entity *itemUser, ItemTriggerType trigger)
+{
+    std::multimap<ItemTriggerType, ItemEffectInfo *>::iterator it, it_end;
+    for (it = mDispells.begin(), it_end = mDispells.end(); it != it_end; ++it)
+        if (it->first == trigger)
+            it->second->dispell(itemUser);
+}
+
 ItemComponent::ItemComponent(ItemClass *type, int amount) :
     mType(type),
     mAmount(amount)
@@ -169,6 +169,12 @@ class ItemClass
          */
         bool useTrigger(Entity *itemUser, ItemTriggerType trigger);
 
+        /**
+         * Removes the modifiers the trigger would remove, without applying
+         * the ones it would apply.
+         */
+        void dispellTrigger(Entity *itemUser, ItemTriggerType trigger);
+
         /**
          * Gets unit cost of these items.
          */
@@ -211,6 +217,20 @@ class ItemClass
         Script::Ref getEventCallback(const std::string &event) const
         { return mEventCallbacks.value(event); }
 
+        /**
+         * Takes over the callbacks scripts set on another version of this
+         * item type, after the game data was reloaded.
+         */
+        void copyCallbacks(const ItemClass &other)
+        {
+            for (utils::NameMap<Script::Ref>::const_iterator it =
+                 other.mEventCallbacks.begin(),
+                 it_end = other.mEventCallbacks.end(); it != it_end; ++it)
+            {
+                mEventCallbacks[it->first] = it->second;
+            }
+        }
+
     private:
         /**
          * Add an effect to a trigger
@@ -261,6 +281,9 @@ class ItemComponent : public Component
         ItemClass *getItemClass() const
         { return mType; }
 
+        void setItemClass(ItemClass *type)
+        { mType = type; }
+
         int getAmount() const
         { return mAmount; }
 
@@ -45,27 +45,27 @@ void ItemManager::initialize()
 
 void ItemManager::deinitialize()
 {
-    for (ItemClasses::iterator i = mItemClasses.begin(),
+    for (ItemClasses::const_iterator i = mItemClasses.begin(),
          i_end = mItemClasses.end(); i != i_end; ++i)
     {
         delete i->second;
     }
 
-    for (std::map< unsigned, EquipSlotInfo* >::iterator it =
-        mEquipSlotsInfo.begin(), it_end = mEquipSlotsInfo.end(); it != it_end;
-        ++it)
+    for (EquipSlotsInfo::const_iterator it = mEquipSlotsInfo.begin(),
+         it_end = mEquipSlotsInfo.end(); it != it_end; ++it)
     {
         delete it->second;
     }
 
     mItemClasses.clear();
     mItemClassesByName.clear();
+    mEquipSlotsInfo.clear();
+    mNamedEquipSlotsInfo.clear();
 }
 
 ItemClass *ItemManager::getItem(int itemId) const
 {
-    ItemClasses::const_iterator i = mItemClasses.find(itemId);
-    return i != mItemClasses.end() ? i->second : 0;
+    return mItemClasses.value(itemId);
 }
 
 ItemClass *ItemManager::getItemByName(const std::string &name) const
@@ -86,14 +86,14 @@ unsigned ItemManager::getEquipSlotIdFromName(const std::string &name) const
 
 unsigned ItemManager::getEquipSlotCapacity(unsigned id) const
 {
-    EquipSlotsInfo::const_iterator i = mEquipSlotsInfo.find(id);
-    return i != mEquipSlotsInfo.end() ? i->second->slotCapacity : 0;
+    EquipSlotInfo *slotInfo = mEquipSlotsInfo.value(id);
+    return slotInfo ? slotInfo->slotCapacity : 0;
 }
 
 bool ItemManager::isEquipSlotVisible(unsigned id) const
 {
-    EquipSlotsInfo::const_iterator i = mEquipSlotsInfo.find(id);
-    return i != mEquipSlotsInfo.end() ? i->second->visibleSlot : false;
+    EquipSlotInfo *slotInfo = mEquipSlotsInfo.value(id);
+    return slotInfo ? slotInfo->visibleSlot : false;
 }
 
 
@@ -106,6 +106,16 @@ void ItemManager::checkStatus()
     LOG_INFO("Loaded " << mEquipSlotsInfo.size() << " slot types");
 }
 
+void ItemManager::copyCallbacks(const ItemManager &other)
+{
+    for (ItemClasses::const_iterator i = mItemClasses.begin(),
+         i_end = mItemClasses.end(); i != i_end; ++i)
+    {
+        if (ItemClass *otherItem = other.getItem(i->first))
+            i->second->copyCallbacks(*otherItem);
+    }
+}
+
 /**
  * Read a <slot> element from settings.
  * Used by SettingsManager.
@@ -137,9 +147,7 @@ void ItemManager::readEquipSlotNode(xmlNodePtr node)
     if (visible)
         ++mVisibleEquipSlotCount;
 
-    EquipSlotsInfo::iterator i = mEquipSlotsInfo.find(slotId);
-
-    if (i != mEquipSlotsInfo.end())
+    if (mEquipSlotsInfo.contains(slotId))
     {
         LOG_WARN("Item Manager: Ignoring duplicate definition "
                  "of equip slot '" << slotId << "'!");
@@ -150,7 +158,7 @@ void ItemManager::readEquipSlotNode(xmlNodePtr node)
         << ", capacity: " << capacity << ", visible? " << visible);
     EquipSlotInfo *equipSlotInfo =
         new EquipSlotInfo(slotId, name, capacity, visible);
-    mEquipSlotsInfo.insert(std::make_pair(slotId, equipSlotInfo));
+    mEquipSlotsInfo.insert(slotId, equipSlotInfo);
     mNamedEquipSlotsInfo.insert(name, equipSlotInfo);
 }
 
@@ -173,9 +181,7 @@ void ItemManager::readItemNode(xmlNodePtr itemNode, const std::string &filename)
     if (type == "hairsprite" || type == "racesprite")
         return;
 
-    ItemClasses::iterator i = mItemClasses.find(id);
-
-    if (i != mItemClasses.end())
+    if (mItemClasses.contains(id))
     {
         LOG_WARN("Item Manager: Ignoring duplicate definition of item '" << id
                  << "'!");
@@ -191,7 +197,7 @@ void ItemManager::readItemNode(xmlNodePtr itemNode, const std::string &filename)
     }
 
     ItemClass *item = new ItemClass(id, maxPerSlot);
-    mItemClasses.insert(std::make_pair(id, item));
+    mItemClasses.insert(id, item);
 
     const std::string name = XML::getProperty(itemNode, "name", std::string());
     if (!name.empty())
@@ -21,6 +21,7 @@
 #ifndef ITEMMANAGER_H
 #define ITEMMANAGER_H
 
+#include "utils/idregistry.h"
 #include "utils/xml.h"
 #include "utils/string.h"
 
@@ -107,16 +108,22 @@ class ItemManager
 
         void checkStatus();
 
+        /**
+         * Takes over the script callbacks of the items with the same ID
+         * in another manager, after the game data was reloaded.
+         */
+        void copyCallbacks(const ItemManager &other);
+
     private:
         void readEquipNode(xmlNodePtr equipNode, ItemClass *item);
         void readEffectNode(xmlNodePtr effectNode, ItemClass *item);
 
-        typedef std::map< int, ItemClass * > ItemClasses;
+        typedef utils::IdRegistry< ItemClass * > ItemClasses;
         ItemClasses mItemClasses; /**< Item reference */
         utils::NameMap<ItemClass*> mItemClassesByName;
 
         // Map an equip slot id with the equip slot info.
-        typedef std::map< unsigned, EquipSlotInfo* > EquipSlotsInfo;
+        typedef utils::IdRegistry< EquipSlotInfo* > EquipSlotsInfo;
         // Reference to the vector position of equipSlots
         typedef std::vector< unsigned > VisibleEquipSlots;
 
@@ -0,0 +1,101 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Compiles the game settings into the data pack read by the game server,
+ * so that a server does not have to do it on its first start.
+ */
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "common/resourcemanager.h"
+#include "game-server/datapack.h"
+#include "utils/logger.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <physfs.h>
+
+using utils::Logger;
+
+static void printHelp()
+{
+    std::cout << "manaserv-datapack" << std::endl << std::endl
+              << "Usage: manaserv-datapack [options] [pack file]" << std::endl
+              << std::endl
+              << "Options: " << std::endl
+              << "  -h --help          : Display this help" << std::endl
+              << "     --config <path> : Set the config path to use."
+              << " (Default: ./manaserv.xml)" << std::endl
+              << std::endl
+              << "The pack file defaults to the game_dataPack option."
+              << std::endl;
+    exit(EXIT_NORMAL);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string configPath;
+    std::string packFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--config") && i + 1 < argc)
+            configPath = argv[++i];
+        else if (argv[i][0] == '-')
+            printHelp();
+        else
+            packFile = argv[i];
+    }
+
+    if (!Configuration::initialize(configPath))
+    {
+        LOG_FATAL("Refusing to run without configuration!");
+        exit(EXIT_CONFIG_NOT_FOUND);
+    }
+
+    if (packFile.empty())
+        packFile = Configuration::getValue("game_dataPack", std::string());
+    if (packFile.empty())
+    {
+        LOG_FATAL("No pack file given and game_dataPack is not set.");
+        exit(EXIT_BAD_CONFIG_PARAMETER);
+    }
+
+    Logger::setVerbosity(Logger::Info);
+
+    PHYSFS_init(argv[0]);
+    ResourceManager::initialize();
+
+    DataPack pack;
+    if (!pack.compile(DEFAULT_SETTINGS_FILE))
+    {
+        LOG_FATAL(DEFAULT_SETTINGS_FILE << " is not a valid database file!");
+        exit(EXIT_XML_BAD_PARAMETER);
+    }
+
+    if (!pack.write(packFile))
+        exit(EXIT_OTHER_EXCEPTION);
+
+    PHYSFS_deinit();
+    Configuration::deinitialize();
+    return EXIT_NORMAL;
+}
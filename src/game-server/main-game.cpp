@@ -27,6 +27,7 @@
 #include "game-server/attributemanager.h"
 #include "game-server/gamehandler.h"
 #include "game-server/emotemanager.h"
+#include "game-server/flightrecorder.h"
 #include "game-server/itemmanager.h"
 #include "game-server/mapmanager.h"
 #include "game-server/monstermanager.h"
@@ -38,9 +39,12 @@
 #include "net/bandwidth.h"
 #include "net/connectionhandler.h"
 #include "net/messageout.h"
+#include "net/metricsserver.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
 #include "utils/processorutils.h"
+#include "utils/profiler.h"
 #include "utils/stringfilter.h"
 #include "utils/timer.h"
 #include "utils/mathutils.h"
@@ -67,6 +71,7 @@ using utils::Logger;
 
 #define DEFAULT_LOG_FILE                    "manaserv-game.log"
 #define DEFAULT_MAIN_SCRIPT_FILE            "scripts/main.lua"
+#define DEFAULT_PROFILE_FILE                "manaserv-game.folded"
 
 static int const WORLD_TICK_SKIP = 2; /** tolerance for lagging behind in world calculation) **/
 
@@ -77,11 +82,14 @@ static bool running = true;     /**< Whether the server keeps running */
 
 utils::StringFilter *stringFilter; /**< Slang's Filter */
 
-AbilityManager *abilityManager = new AbilityManager();
 AttributeManager *attributeManager = new AttributeManager();
-ItemManager *itemManager = new ItemManager();
-MonsterManager *monsterManager = new MonsterManager();
-EmoteManager *emoteManager = new EmoteManager();
+
+/** Set by the settings manager to the game data in use */
+AbilityManager *abilityManager = 0;
+ItemManager *itemManager = 0;
+MonsterManager *monsterManager = 0;
+EmoteManager *emoteManager = 0;
+StatusManager *statusManager = 0;
 
 SettingsManager *settingsManager = new SettingsManager(DEFAULT_SETTINGS_FILE);
 
@@ -97,6 +105,9 @@ PostMan *postMan;
 /** Bandwidth Monitor */
 BandwidthMonitor *gBandwidth;
 
+/** Serves the metrics to the monitoring system */
+static MetricsServer *metricsServer;
+
 /** Callback used when SIGQUIT signal is received. */
 static void closeGracefully(int)
 {
@@ -145,6 +156,11 @@ static void initializeServer()
     postMan = new PostMan;
     gBandwidth = new BandwidthMonitor;
 
+    metricsServer = new MetricsServer;
+    metricsServer->start(
+            Configuration::getValue("net_gameMetricsPort", 0),
+            Configuration::getValue("net_gameMetricsSocket", std::string()));
+
     // --- Initialize enet.
     if (enet_initialize() != 0)
     {
@@ -158,6 +174,11 @@ static void initializeServer()
     // Initialize the processor utility functions
     utils::processor::init();
 
+    FlightRecorder::initialize();
+    Profiler::initialize(
+            Configuration::getValue("log_gameProfileFile",
+                                    std::string(DEFAULT_PROFILE_FILE)));
+
     // Seed the random number generator
     std::srand( time(nullptr) );
 }
@@ -174,6 +195,8 @@ static void deinitializeServer()
     // Quit ENet
     enet_deinitialize();
 
+    delete metricsServer; metricsServer = 0;
+
     // Destroy message handlers
     delete gameHandler; gameHandler = 0;
     delete accountHandler; accountHandler = 0;
@@ -182,13 +205,8 @@ static void deinitializeServer()
 
     // Destroy Managers
     delete stringFilter; stringFilter = 0;
-    delete monsterManager; monsterManager = 0;
-    delete abilityManager; abilityManager = 0;
-    delete itemManager; itemManager = 0;
-    delete emoteManager; emoteManager = 0;
     delete settingsManager; settingsManager = 0;
     MapManager::deinitialize();
-    StatusManager::deinitialize();
     ScriptManager::deinitialize();
 
     PHYSFS_deinit();
@@ -368,8 +386,19 @@ int main(int argc, char *argv[])
     // Account connection lost flag
     bool accountServerLost = false;
 
+    Metrics::Histogram &tickTime =
+            Metrics::histogram("manaserv_tick_seconds",
+                               "Time spent computing a world tick.",
+                               std::string(), 1e-6);
+    Metrics::Counter &skippedTicks =
+            Metrics::counter("manaserv_skipped_ticks_total",
+                             "World ticks skipped because the server lagged "
+                             "behind.");
+
     while (running)
     {
+        Profiler::update();
+
         int elapsedTicks = worldTimer.poll();
 
         if (elapsedTicks == 0)
@@ -378,17 +407,27 @@ int main(int argc, char *argv[])
             continue;
         }
 
+        int skipped = 0;
         if (elapsedTicks > WORLD_TICK_SKIP)
         {
             LOG_WARN("Skipping "<< elapsedTicks - 1 << " ticks.");
+            skipped = elapsedTicks - 1;
+            skippedTicks.increment(skipped);
             elapsedTicks = 1;
         }
 
         while (elapsedTicks > 0)
         {
+            Metrics::ScopedTimer tickTimer(tickTime);
+
             currentTick++;
             elapsedTicks--;
 
+            FlightRecorder::beginTick(currentTick, skipped);
+            skipped = 0;
+            Profiler::setPhase("account");
+            uint64_t phaseStart = Metrics::now();
+
             // Print world time at 10 second intervals to show we're alive
             if (currentTick % 100 == 0)
                 LOG_INFO("World time: " << currentTick);
@@ -430,11 +469,30 @@ int main(int argc, char *argv[])
                     accountHandler->start(options.port);
                 }
             }
+            FlightRecorder::addPhaseTime(FlightRecorder::PHASE_ACCOUNT,
+                                         Metrics::now() - phaseStart);
+
+            Profiler::setPhase("messages");
+            phaseStart = Metrics::now();
             gameHandler->process();
+            FlightRecorder::addPhaseTime(FlightRecorder::PHASE_MESSAGES,
+                                         Metrics::now() - phaseStart);
+
             // Update all active objects/beings
+            Profiler::setPhase("other");
+            MapManager::update();
+            settingsManager->update();
             GameState::update(currentTick);
+
             // Send potentially urgent outgoing messages
+            Profiler::setPhase("flush");
+            phaseStart = Metrics::now();
             gameHandler->flush();
+            FlightRecorder::addPhaseTime(FlightRecorder::PHASE_FLUSH,
+                                         Metrics::now() - phaseStart);
+
+            FlightRecorder::endTick();
+            Profiler::setPhase(nullptr);
         }
     }
 
@@ -21,12 +21,29 @@
 #include <algorithm>
 #include <queue>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <limits.h>
 
 #include "game-server/map.h"
 
 #include "common/defines.h"
+#include "game-server/state.h"
+
+// Basic cost for moving from one tile to another.
+static int const basicCost = 100;
+
+// Blockmask matching each block type.
+static unsigned char const blockTypeMasks[NB_BLOCKTYPES] = {
+    Map::BLOCKMASK_WALL,
+    Map::BLOCKMASK_CHARACTER,
+    Map::BLOCKMASK_MONSTER
+};
+
+// Offsets of the four straight neighbours of a tile.
+static int const straightDirections[4][2] = {
+    { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }
+};
 
 /**
  * Stores information used during path finding for each tile of a map.
@@ -100,11 +117,250 @@ class Location
         int Fcost;              /**< Estimation of total path cost */
 };
 
+/**
+ * Stores the cost of reaching a destination tile from every tile around it,
+ * so that any number of beings heading there can follow the gradient
+ * without searching on their own.
+ */
+class FlowField
+{
+    public:
+        FlowField(int destX, int destY,
+                  unsigned char walkmask, int maxCost, int tick):
+            mDestX(destX), mDestY(destY),
+            mWalkmask(walkmask),
+            mMaxCost(maxCost),
+            mTick(tick),
+            mComputed(false),
+            mX(0), mY(0), mWidth(0), mHeight(0)
+        {}
+
+        bool matches(int destX, int destY,
+                     unsigned char walkmask, int maxCost) const
+        {
+            return mDestX == destX && mDestY == destY &&
+                   mWalkmask == walkmask && mMaxCost == maxCost;
+        }
+
+        /**
+         * Fills the field with a Dijkstra search started at the destination.
+         */
+        void compute(const Map *map, int tick);
+
+        /**
+         * Follows the gradient from the given start location. Returns false
+         * when the start is out of range or the way is blocked by now.
+         */
+        bool follow(int startX, int startY, const Map *map, Path &path) const;
+
+        bool isComputed() const
+        { return mComputed; }
+
+        int getTick() const
+        { return mTick; }
+
+    private:
+        /**
+         * Returns the cost of reaching the destination from the given tile,
+         * or -1 when the tile is out of range or unreachable.
+         */
+        int getCost(int x, int y) const
+        {
+            x -= mX;
+            y -= mY;
+            if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+                return -1;
+            return mCosts[x + y * mWidth];
+        }
+
+        int mDestX, mDestY;
+        unsigned char mWalkmask;
+        int mMaxCost;
+        int mTick;              /**< Tick at which the field was requested */
+        bool mComputed;
+
+        int mX, mY;             /**< Top-left tile covered by the field */
+        int mWidth, mHeight;
+        std::vector<int> mCosts;
+};
+
+/**
+ * Returns the cost of a single step, using the same defect as FindPath.
+ */
+static int stepCost(int dx, int dy)
+{
+    if (dx == 0 || dy == 0)
+        return basicCost + 1;
+    return basicCost * 362 / 256;
+}
+
+/**
+ * Checks whether the step by (dx, dy) is allowed, given the walkable
+ * neighbours of a tile as returned by Map::getWalkableNeighbours. Diagonal
+ * steps also need both corners to be walkable.
+ */
+static bool canStep(unsigned walkable, int dx, int dy)
+{
+    const unsigned target = 1u << ((dy + 1) * 3 + dx + 1);
+    const unsigned corners = (1u << ((dy + 1) * 3 + 1)) |
+                             (1u << (3 + dx + 1));
+    const unsigned needed = (dx != 0 && dy != 0) ? target | corners : target;
+    return (walkable & needed) == needed;
+}
+
+/**
+ * Counts the bits set in a word.
+ */
+static int countBits(uint64_t bits)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits; bits &= bits - 1)
+        ++count;
+    return count;
+#endif
+}
+
+void FlowField::compute(const Map *map, int tick)
+{
+    mComputed = true;
+    mTick = tick;
+
+    // Each step costs at least basicCost, so the field never needs to reach
+    // further than maxCost tiles from the destination.
+    mX = std::max(0, mDestX - mMaxCost);
+    mY = std::max(0, mDestY - mMaxCost);
+    mWidth = std::min(map->getWidth(), mDestX + mMaxCost + 1) - mX;
+    mHeight = std::min(map->getHeight(), mDestY + mMaxCost + 1) - mY;
+
+    if (mWidth <= 0 || mHeight <= 0)
+    {
+        mWidth = mHeight = 0;
+        return;
+    }
+
+    mCosts.assign(mWidth * mHeight, -1);
+
+    if (!map->getWalk(mDestX, mDestY, mWalkmask))
+        return;
+
+    std::priority_queue<Location> openList;
+    mCosts[(mDestX - mX) + (mDestY - mY) * mWidth] = 0;
+    openList.push(Location(mDestX, mDestY, 0));
+
+    while (!openList.empty())
+    {
+        Location curr = openList.top();
+        openList.pop();
+
+        // Skip outdated entries, a cheaper route was found meanwhile
+        if (curr.Fcost > getCost(curr.x, curr.y))
+            continue;
+
+        const unsigned walkable =
+                map->getWalkableNeighbours(curr.x, curr.y, mWalkmask);
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                int x = curr.x + dx;
+                int y = curr.y + dy;
+
+                if ((dx == 0 && dy == 0) ||
+                        x < mX || y < mY ||
+                        x >= mX + mWidth || y >= mY + mHeight)
+                    continue;
+
+                if (!canStep(walkable, dx, dy))
+                    continue;
+
+                int cost = curr.Fcost + stepCost(dx, dy);
+                if (cost > mMaxCost * basicCost)
+                    continue;
+
+                int &tileCost = mCosts[(x - mX) + (y - mY) * mWidth];
+                if (tileCost == -1 || cost < tileCost)
+                {
+                    tileCost = cost;
+                    openList.push(Location(x, y, cost));
+                }
+            }
+        }
+    }
+}
+
+bool FlowField::follow(int startX, int startY,
+                       const Map *map, Path &path) const
+{
+    if (startX == mDestX && startY == mDestY)
+        return false;
+
+    int x = startX;
+    int y = startY;
+    int currentCost = INT_MAX;
+
+    while (x != mDestX || y != mDestY)
+    {
+        int bestX = 0, bestY = 0;
+        int bestCost = -1;
+        int bestTotal = INT_MAX;
+
+        // The field may be a few ticks old, so check the steps against the
+        // current state of the map.
+        const unsigned walkable = map->getWalkableNeighbours(x, y, mWalkmask);
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (dx == 0 && dy == 0)
+                    continue;
+
+                int cost = getCost(x + dx, y + dy);
+                if (cost == -1)
+                    continue;
+
+                if (!canStep(walkable, dx, dy))
+                    continue;
+
+                int total = cost + stepCost(dx, dy);
+                if (total < bestTotal)
+                {
+                    bestTotal = total;
+                    bestCost = cost;
+                    bestX = x + dx;
+                    bestY = y + dy;
+                }
+            }
+        }
+
+        // Costs have to strictly decrease toward the destination, otherwise
+        // the field no longer describes the map well enough.
+        if (bestCost == -1 || bestCost >= currentCost)
+            return false;
+
+        // Respect the range of the request, like FindPath does
+        if (currentCost == INT_MAX && bestTotal > mMaxCost * basicCost)
+            return false;
+
+        path.push_back(Point(bestX, bestY));
+        x = bestX;
+        y = bestY;
+        currentCost = bestCost;
+    }
+
+    return true;
+}
+
 Map::Map(int width, int height, int tileWidth, int tileHeight):
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
-    mMetaTiles(width * height)
+    mRegionsDirty(true)
 {
+    setSize(width, height);
 }
 
 Map::~Map()
@@ -114,6 +370,8 @@ Map::~Map()
     {
         delete *it;
     }
+
+    clearFlowFields();
 }
 
 void Map::setSize(int width, int height)
@@ -121,7 +379,25 @@ void Map::setSize(int width, int height)
     mWidth = width;
     mHeight = height;
 
-    mMetaTiles.resize(width * height);
+    mWordsPerRow = (width + 63) / 64;
+    for (int type = 0; type < NB_BLOCKTYPES; ++type)
+    {
+        mBlockLayers[type].assign(mWordsPerRow * height, 0);
+        mExtraOccupation[type].clear();
+    }
+
+    mRegionsDirty = true;
+    clearFlowFields();
+}
+
+void Map::setWalls(const uint64_t *words)
+{
+    std::vector<uint64_t> &walls = mBlockLayers[BLOCKTYPE_WALL];
+    walls.assign(words, words + mWordsPerRow * mHeight);
+    mExtraOccupation[BLOCKTYPE_WALL].clear();
+
+    mRegionsDirty = true;
+    clearFlowFields();
 }
 
 const std::string &Map::getProperty(const std::string &key) const
@@ -139,26 +415,24 @@ void Map::blockTile(int x, int y, BlockType type)
     if (type == BLOCKTYPE_NONE || !contains(x, y))
         return;
 
-    MetaTile &metaTile = mMetaTiles[x + y * mWidth];
+    uint64_t &word = mBlockLayers[type][x / 64 + y * mWordsPerRow];
+    const uint64_t bit = uint64_t(1) << (x % 64);
 
-    if (metaTile.occupation[type] < UINT_MAX &&
-        (++metaTile.occupation[type]) > 0)
+    if (word & bit)
     {
-        switch (type)
-        {
-            case BLOCKTYPE_WALL:
-                metaTile.blockmask |= BLOCKMASK_WALL;
-                break;
-            case BLOCKTYPE_CHARACTER:
-                metaTile.blockmask |= BLOCKMASK_CHARACTER;
-                break;
-            case BLOCKTYPE_MONSTER:
-                metaTile.blockmask |= BLOCKMASK_MONSTER;
-                break;
-            default:
-                // Nothing to do.
-                break;
-        }
+        // Already occupied, only count it
+        unsigned &extra = mExtraOccupation[type][x + y * mWidth];
+        if (extra < UINT_MAX - 1)
+            ++extra;
+        return;
+    }
+
+    word |= bit;
+
+    if (type == BLOCKTYPE_WALL)
+    {
+        wallAdded(x, y);
+        clearFlowFields();
     }
 }
 
@@ -167,26 +441,30 @@ void Map::freeTile(int x, int y, BlockType type)
     if (type == BLOCKTYPE_NONE || !contains(x, y))
         return;
 
-    MetaTile &metaTile = mMetaTiles[x + y * mWidth];
-    assert(metaTile.occupation[type] > 0);
+    uint64_t &word = mBlockLayers[type][x / 64 + y * mWordsPerRow];
+    const uint64_t bit = uint64_t(1) << (x % 64);
+    assert(word & bit);
+    if (!(word & bit))
+        return;
 
-    if (!(--metaTile.occupation[type]))
+    std::unordered_map<int, unsigned> &extraOccupation =
+            mExtraOccupation[type];
+    std::unordered_map<int, unsigned>::iterator it =
+            extraOccupation.find(x + y * mWidth);
+    if (it != extraOccupation.end())
     {
-        switch (type)
-        {
-            case BLOCKTYPE_WALL:
-                metaTile.blockmask &= (BLOCKMASK_WALL xor 0xff);
-                break;
-            case BLOCKTYPE_CHARACTER:
-                metaTile.blockmask &= (BLOCKMASK_CHARACTER xor 0xff);
-                break;
-            case BLOCKTYPE_MONSTER:
-                metaTile.blockmask &= (BLOCKMASK_MONSTER xor 0xff);
-                break;
-            default:
-                // nothing
-                break;
-        }
+        // Still occupied by something else
+        if (!--it->second)
+            extraOccupation.erase(it);
+        return;
+    }
+
+    word &= ~bit;
+
+    if (type == BLOCKTYPE_WALL)
+    {
+        wallRemoved(x, y);
+        clearFlowFields();
     }
 }
 
@@ -197,7 +475,269 @@ bool Map::getWalk(int x, int y, char walkmask) const
         return false;
 
     // Check if the tile is walkable
-    return !(mMetaTiles[x + y * mWidth].blockmask & walkmask);
+    return !((getBlockedWord(x / 64, y, walkmask) >> (x % 64)) & 1);
+}
+
+uint64_t Map::getBlockedWord(int word, int y, unsigned char walkmask) const
+{
+    if (word < 0 || word >= mWordsPerRow)
+        return ~uint64_t(0);
+
+    const int index = word + y * mWordsPerRow;
+    uint64_t blocked = 0;
+    for (int type = 0; type < NB_BLOCKTYPES; ++type)
+    {
+        // Selects the layer without branching when the walkmask has its bit
+        const uint64_t select = -uint64_t((walkmask & blockTypeMasks[type]) != 0);
+        blocked |= mBlockLayers[type][index] & select;
+    }
+
+    // Padding at the end of the row is outside of the map
+    if (word == mWordsPerRow - 1 && mWidth % 64)
+        blocked |= ~uint64_t(0) << (mWidth % 64);
+
+    return blocked;
+}
+
+uint64_t Map::getBlockedTiles(int x, int y, unsigned char walkmask) const
+{
+    if (y < 0 || y >= mHeight)
+        return ~uint64_t(0);
+
+    // Round down, also for columns left of the map
+    const int word = x >= 0 ? x / 64 : (x - 63) / 64;
+    const int shift = x - word * 64;
+
+    const uint64_t low = getBlockedWord(word, y, walkmask);
+    if (!shift)
+        return low;
+
+    const uint64_t high = getBlockedWord(word + 1, y, walkmask);
+    return (low >> shift) | (high << (64 - shift));
+}
+
+unsigned Map::getWalkableNeighbours(int x, int y,
+                                    unsigned char walkmask) const
+{
+    unsigned walkable = 0;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        const unsigned row = ~getBlockedTiles(x - 1, y + dy, walkmask) & 7;
+        walkable |= row << ((dy + 1) * 3);
+    }
+    return walkable;
+}
+
+bool Map::findRandomWalkableTile(const Rectangle &area,
+                                 unsigned char walkmask,
+                                 Point &tile) const
+{
+    const int left = std::max(0, area.x);
+    const int top = std::max(0, area.y);
+    const int right = std::min(mWidth, area.x + area.w);
+    const int bottom = std::min(mHeight, area.y + area.h);
+
+    // Counts walkable tiles 64 at a time, then picks one of them
+    int count = 0;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        int pick = pass ? rand() % count : -1;
+
+        for (int y = top; y < bottom; ++y)
+        {
+            for (int x = left; x < right; x += 64)
+            {
+                uint64_t walkable = ~getBlockedTiles(x, y, walkmask);
+                if (right - x < 64)
+                    walkable &= (uint64_t(1) << (right - x)) - 1;
+
+                const int bits = countBits(walkable);
+                if (!pass)
+                {
+                    count += bits;
+                    continue;
+                }
+
+                if (pick >= bits)
+                {
+                    pick -= bits;
+                    continue;
+                }
+
+                // Drop the walkable tiles before the picked one
+                for (; pick > 0; --pick)
+                    walkable &= walkable - 1;
+
+                int offset = 0;
+                while (!((walkable >> offset) & 1))
+                    ++offset;
+
+                tile = Point(x + offset, y);
+                return true;
+            }
+        }
+
+        if (!count)
+            return false;
+    }
+
+    return false;
+}
+
+bool Map::isReachable(int startX, int startY,
+                      int destX, int destY,
+                      unsigned char walkmask) const
+{
+    if (!contains(startX, startY) || !contains(destX, destY))
+        return false;
+
+    // Only walls are static, other blockers may move out of the way
+    if (!(walkmask & BLOCKMASK_WALL))
+        return true;
+
+    updateRegions();
+
+    const unsigned destRegion = getRegion(destX, destY);
+    if (!destRegion)
+        return false;
+
+    if (const unsigned startRegion = getRegion(startX, startY))
+        return startRegion == destRegion;
+
+    // A being standing inside a wall can still step out of it, any diagonal
+    // step requires the adjacent straight tiles to be free as well.
+    for (int i = 0; i < 4; ++i)
+    {
+        const int x = startX + straightDirections[i][0];
+        const int y = startY + straightDirections[i][1];
+        if (contains(x, y) && getRegion(x, y) == destRegion)
+            return true;
+    }
+    return false;
+}
+
+unsigned Map::getRegion(int x, int y) const
+{
+    unsigned region = mRegions[x + y * mWidth];
+    if (!region)
+        return 0;
+
+    // Find the root region, compressing the path on the way
+    unsigned root = region;
+    while (mRegionParents[root] != root)
+        root = mRegionParents[root];
+    while (mRegionParents[region] != root)
+    {
+        unsigned next = mRegionParents[region];
+        mRegionParents[region] = root;
+        region = next;
+    }
+    mRegions[x + y * mWidth] = root;
+    return root;
+}
+
+void Map::mergeRegions(unsigned a, unsigned b) const
+{
+    while (mRegionParents[a] != a)
+        a = mRegionParents[a];
+    while (mRegionParents[b] != b)
+        b = mRegionParents[b];
+    if (a != b)
+        mRegionParents[std::max(a, b)] = std::min(a, b);
+}
+
+void Map::updateRegions() const
+{
+    if (!mRegionsDirty)
+        return;
+
+    mRegionsDirty = false;
+    mRegions.assign(mWidth * mHeight, 0);
+    mRegionParents.assign(1, 0);
+
+    std::vector<int> stack;
+    for (int i = 0, end = mWidth * mHeight; i < end; ++i)
+    {
+        if (mRegions[i] || !getWalk(i % mWidth, i / mWidth))
+            continue;
+
+        // Flood fill a new region
+        const unsigned region = mRegionParents.size();
+        mRegionParents.push_back(region);
+        mRegions[i] = region;
+        stack.push_back(i);
+
+        while (!stack.empty())
+        {
+            const int tile = stack.back();
+            stack.pop_back();
+            const int x = tile % mWidth;
+            const int y = tile / mWidth;
+
+            const unsigned walkable = getWalkableNeighbours(x, y,
+                                                            BLOCKMASK_WALL);
+
+            const int neighbours[4] = {
+                (walkable & (1 << 3)) ? tile - 1 : -1,
+                (walkable & (1 << 5)) ? tile + 1 : -1,
+                (walkable & (1 << 1)) ? tile - mWidth : -1,
+                (walkable & (1 << 7)) ? tile + mWidth : -1
+            };
+
+            for (int n = 0; n < 4; ++n)
+            {
+                const int next = neighbours[n];
+                if (next < 0 || mRegions[next])
+                    continue;
+
+                mRegions[next] = region;
+                stack.push_back(next);
+            }
+        }
+    }
+}
+
+void Map::wallAdded(int x, int y)
+{
+    if (mRegionsDirty)
+        return;
+
+    mRegions[x + y * mWidth] = 0;
+
+    // A wall next to less than two free tiles cannot split a region
+    int freeNeighbours = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const int nx = x + straightDirections[i][0];
+        const int ny = y + straightDirections[i][1];
+        if (contains(nx, ny) && getRegion(nx, ny))
+            ++freeNeighbours;
+    }
+
+    if (freeNeighbours > 1)
+        mRegionsDirty = true;
+}
+
+void Map::wallRemoved(int x, int y)
+{
+    if (mRegionsDirty)
+        return;
+
+    // The tile starts its own region and joins the ones around it
+    const unsigned region = mRegionParents.size();
+    mRegionParents.push_back(region);
+    mRegions[x + y * mWidth] = region;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const int nx = x + straightDirections[i][0];
+        const int ny = y + straightDirections[i][1];
+        if (!contains(nx, ny))
+            continue;
+
+        if (const unsigned neighbour = getRegion(nx, ny))
+            mergeRegions(region, neighbour);
+    }
 }
 
 Path Map::findPath(int startX, int startY,
@@ -210,14 +750,82 @@ Path Map::findPath(int startX, int startY,
                       this);
 }
 
+Path Map::findSharedPath(int startX, int startY,
+                         int destX, int destY,
+                         unsigned char walkmask, int maxCost)
+{
+    if (!isReachable(startX, startY, destX, destY, walkmask))
+        return Path();
+
+    if (FlowField *field = getFlowField(destX, destY, walkmask, maxCost))
+    {
+        Path path;
+        if (field->follow(startX, startY, this, path))
+            return path;
+    }
+
+    return findPath(startX, startY, destX, destY, walkmask, maxCost);
+}
+
+FlowField *Map::getFlowField(int destX, int destY,
+                             unsigned char walkmask, int maxCost)
+{
+    const int tick = GameState::getCurrentTick();
+
+    // Forget about destinations that have not been requested recently
+    for (std::vector<FlowField*>::iterator it = mFlowFields.begin();
+         it != mFlowFields.end(); )
+    {
+        if (tick - (*it)->getTick() > FLOWFIELD_LIFETIME)
+        {
+            delete *it;
+            it = mFlowFields.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (std::vector<FlowField*>::iterator it = mFlowFields.begin(),
+         it_end = mFlowFields.end(); it != it_end; ++it)
+    {
+        FlowField *field = *it;
+        if (!field->matches(destX, destY, walkmask, maxCost))
+            continue;
+
+        // Second request for the same destination, it is worth computing
+        // a field that all following requests can share.
+        if (!field->isComputed())
+            field->compute(this, tick);
+        return field;
+    }
+
+    // First request, only remember the destination
+    if (mFlowFields.size() >= FLOWFIELD_CACHE_SIZE)
+    {
+        delete mFlowFields.front();
+        mFlowFields.erase(mFlowFields.begin());
+    }
+    mFlowFields.push_back(new FlowField(destX, destY, walkmask, maxCost, tick));
+    return 0;
+}
+
+void Map::clearFlowFields()
+{
+    for (std::vector<FlowField*>::iterator it = mFlowFields.begin(),
+         it_end = mFlowFields.end(); it != it_end; ++it)
+    {
+        delete *it;
+    }
+    mFlowFields.clear();
+}
+
 Path FindPath::operator() (int startX, int startY,
                            int destX, int destY,
                            unsigned char walkmask, int maxCost,
                            const Map *map)
 {
-    // Basic cost for moving from one tile to another.
-    static int const basicCost = 100;
-
     // Path to be built up (empty by default)
     Path path;
 
@@ -225,6 +833,10 @@ Path FindPath::operator() (int startX, int startY,
     if (!map->getWalk(destX, destY, walkmask))
         return path;
 
+    // Return when destination lies in an area cut off by walls
+    if (!map->isReachable(startX, startY, destX, destY, walkmask))
+        return path;
+
     prepare(map);
 
     // Declare open list, a list with open tiles sorted on F cost
@@ -256,36 +868,32 @@ Path FindPath::operator() (int startX, int startY,
         // Put the current tile on the closed list
         currInfo->whichList = mOnClosedList;
 
+        // Fetch the walkability of all adjacent tiles at once. Tiles
+        // outside of the map boundaries are reported as not walkable.
+        const unsigned walkable =
+                map->getWalkableNeighbours(curr.x, curr.y, walkmask);
+
         // Check the adjacent tiles
         for (int dy = -1; dy <= 1; dy++)
         {
             for (int dx = -1; dx <= 1; dx++)
             {
+                // Skip if if we're checking the same tile we're leaving from,
+                // if the tile is not walkable or, when taking a diagonal
+                // step, if we cannot skip the corner.
+                if ((dx == 0 && dy == 0) || !canStep(walkable, dx, dy))
+                    continue;
+
                 // Calculate location of tile to check
                 int x = curr.x + dx;
                 int y = curr.y + dy;
 
-                // Skip if if we're checking the same tile we're leaving from,
-                // or if the new location falls outside of the map boundaries
-                if ((dx == 0 && dy == 0) || !map->contains(x, y))
-                    continue;
-
                 PathInfo *newTile = getInfo(x, y);
 
-                // Skip if the tile is on the closed list or is not walkable
-                if (newTile->whichList == mOnClosedList
-                        || !map->getWalk(x, y, walkmask))
+                // Skip if the tile is on the closed list
+                if (newTile->whichList == mOnClosedList)
                     continue;
 
-                // When taking a diagonal step, verify that we can skip the
-                // corner.
-                if (dx != 0 && dy != 0)
-                {
-                    if (!map->getWalk(curr.x, curr.y + dy, walkmask)
-                            || !map->getWalk(curr.x + dx, curr.y, walkmask))
-                        continue;
-                }
-
                 // Calculate G cost for this route, ~sqrt(2) for moving diagonal
                 int Gcost = currInfo->Gcost +
                     (dx == 0 || dy == 0 ? basicCost : basicCost * 362 / 256);
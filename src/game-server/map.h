@@ -24,7 +24,9 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <stdint.h>
 
 #include "utils/logger.h"
 #include "utils/point.h"
@@ -32,6 +34,8 @@
 
 typedef std::list<Point> Path;
 
+class FlowField;
+
 enum BlockType
 {
     BLOCKTYPE_NONE = -1,
@@ -41,25 +45,6 @@ enum BlockType
     NB_BLOCKTYPES
 };
 
-/**
- * A meta tile stores additional information about a location on a tile map.
- * This is information that doesn't need to be repeated for each tile in each
- * layer of the map.
- */
-class MetaTile
-{
-    public:
-        MetaTile()
-            : blockmask(0)
-        {
-            for (unsigned i = 0; i < NB_BLOCKTYPES; ++i)
-                occupation[i] = 0;
-        }
-
-        unsigned occupation[NB_BLOCKTYPES];
-        char blockmask;          /**< walkability bitfield */
-};
-
 class MapObject
 {
     public:
@@ -86,6 +71,9 @@ class MapObject
         bool hasProperty(const std::string &key) const
         { return mProperties.contains(key); }
 
+        const utils::NameMap<std::string> &getProperties() const
+        { return mProperties; }
+
         const std::string &getName() const
         { return mName; }
 
@@ -140,6 +128,39 @@ class Map
          */
         bool getWalk(int x, int y, char walkmask = BLOCKMASK_WALL) const;
 
+        /**
+         * Gets the blocked state of 64 consecutive tiles of a row, starting
+         * at column \a x. Bit n is set when tile (x + n, y) is blocked for
+         * the walkmask or lies outside of the map.
+         */
+        uint64_t getBlockedTiles(int x, int y, unsigned char walkmask) const;
+
+        /**
+         * Gets walkability of the 3x3 tiles centered on a tile. Bit
+         * (dy + 1) * 3 + (dx + 1) is set when tile (x + dx, y + dy) is
+         * inside the map and walkable.
+         */
+        unsigned getWalkableNeighbours(int x, int y,
+                                       unsigned char walkmask) const;
+
+        /**
+         * Picks a random walkable tile inside an area given in tiles.
+         *
+         * @return <code>false</code> when no tile of the area is walkable.
+         */
+        bool findRandomWalkableTile(const Rectangle &area,
+                                    unsigned char walkmask,
+                                    Point &tile) const;
+
+        /**
+         * Tells whether a path between two tiles can exist, looking only at
+         * walls. Answers in constant time, so it can be used to reject
+         * requests into walled-off areas before searching.
+         */
+        bool isReachable(int startX, int startY,
+                         int destX, int destY,
+                         unsigned char walkmask = BLOCKMASK_WALL) const;
+
         /**
          * Tells if a tile location is within the map range.
          */
@@ -181,6 +202,32 @@ class Map
         void setProperty(const std::string &key, const std::string &val)
         { mProperties[key] = val; }
 
+        /**
+         * Returns all the map properties.
+         */
+        const std::map<std::string, std::string> &getProperties() const
+        { return mProperties; }
+
+        /**
+         * Returns the walls as a bit plane of the map, with rows padded to
+         * whole words. Bit x % 64 of word x / 64 + y * getWordsPerRow() is
+         * set when tile (x, y) is a wall.
+         */
+        const std::vector<uint64_t> &getWalls() const
+        { return mBlockLayers[BLOCKTYPE_WALL]; }
+
+        /**
+         * Replaces the walls with a bit plane laid out like getWalls(),
+         * holding getWordsPerRow() * getHeight() words.
+         */
+        void setWalls(const uint64_t *words);
+
+        /**
+         * Returns the number of words per row of the bit planes.
+         */
+        int getWordsPerRow() const
+        { return mWordsPerRow; }
+
         /**
          * Adds an object.
          */
@@ -201,6 +248,21 @@ class Map
                       unsigned char walkmask,
                       int maxCost = 20) const;
 
+        /**
+         * Find a path from one location to the next, sharing the search with
+         * other callers heading to the same tile.
+         *
+         * The first request for a destination is answered by findPath().
+         * When another request for the same destination arrives within
+         * FLOWFIELD_LIFETIME ticks, a flow field is computed around the
+         * destination and every later request follows its gradient instead
+         * of searching again.
+         */
+        Path findSharedPath(int startX, int startY,
+                            int destX, int destY,
+                            unsigned char walkmask,
+                            int maxCost = 20);
+
         /**
          * Blockmasks for different entities
          */
@@ -208,14 +270,70 @@ class Map
         static const unsigned char BLOCKMASK_CHARACTER = 0x01;// = bin 0000 0001
         static const unsigned char BLOCKMASK_MONSTER = 0x02;  // = bin 0000 0010
 
+        /** Number of ticks a flow field may be reused. */
+        static const int FLOWFIELD_LIFETIME = 5;
+
+        /** Maximum number of flow fields kept per map. */
+        static const unsigned FLOWFIELD_CACHE_SIZE = 16;
+
     private:
+        /**
+         * Gets one word of the blocked tiles of a row. Words outside of the
+         * row and the padding bits of the last word are reported blocked.
+         */
+        uint64_t getBlockedWord(int word, int y, unsigned char walkmask) const;
+
+        FlowField *getFlowField(int destX, int destY,
+                                unsigned char walkmask, int maxCost);
+
+        void clearFlowFields();
+
+        /**
+         * Labels every connected area of non-wall tiles with its own region.
+         */
+        void updateRegions() const;
+
+        /**
+         * Returns the region of a tile, or 0 for walls.
+         */
+        unsigned getRegion(int x, int y) const;
+
+        /**
+         * Joins the regions of two neighbouring non-wall tiles.
+         */
+        void mergeRegions(unsigned a, unsigned b) const;
+
+        void wallAdded(int x, int y);
+        void wallRemoved(int x, int y);
+
         // map properties
         int mWidth, mHeight;
         int mTileWidth, mTileHeight;
         std::map<std::string, std::string> mProperties;
 
-        std::vector<MetaTile> mMetaTiles;
+        /**
+         * One bit plane per block type, a bit is set when the tile is
+         * occupied by at least one thing of that type. Rows are padded to
+         * whole words.
+         */
+        std::vector<uint64_t> mBlockLayers[NB_BLOCKTYPES];
+        int mWordsPerRow;
+
+        /** Occupation counts above one, by tile index. */
+        std::unordered_map<int, unsigned> mExtraOccupation[NB_BLOCKTYPES];
         std::vector<MapObject*> mMapObjects;
+
+        /**
+         * Connected areas of non-wall tiles. Regions merged after a wall was
+         * removed are linked through mRegionParents, walls that may split a
+         * region cause a full relabel on the next query.
+         */
+        mutable std::vector<unsigned> mRegions;
+        mutable std::vector<unsigned> mRegionParents;
+        mutable bool mRegionsDirty;
+
+        /** Recently requested destinations, with or without a field. */
+        std::vector<FlowField*> mFlowFields;
 };
 
 #endif
@@ -0,0 +1,468 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/mapcache.h"
+
+#include "common/configuration.h"
+#include "common/resourcemanager.h"
+#include "game-server/map.h"
+#include "game-server/mapreader.h"
+#include "utils/logger.h"
+#include "utils/sha256.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Layout of a compiled map: the header, the walls, the map properties, the
+ * objects, the object properties and the strings they refer to. Compiled
+ * maps never leave the machine that wrote them, so the host byte order is
+ * used. Strings are given as offsets into the string table.
+ */
+static const uint32_t MAGIC = 0x434d534d;   // "MSMC" on little endian hosts
+
+/**
+ * Increase whenever the layout or the way maps are read changes.
+ */
+static const uint32_t VERSION = 1;
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    char sourceHash[SHA256_HASH_LENGTH];    /**< Of the map file, in hex */
+    int32_t width;
+    int32_t height;
+    int32_t tileWidth;
+    int32_t tileHeight;
+    uint32_t wallWords;
+    uint32_t propertyCount;
+    uint32_t objectCount;
+    uint32_t objectPropertyCount;
+    uint32_t stringsSize;
+    uint32_t reserved;      /**< Keeps the walls 8-byte aligned */
+};
+
+struct ObjectRecord
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    uint32_t name;
+    uint32_t type;
+    uint32_t firstProperty;
+    uint32_t propertyCount;
+};
+
+struct PropertyRecord
+{
+    uint32_t key;
+    uint32_t value;
+};
+
+namespace {
+
+/**
+ * A whole file mapped into memory, or read into it where mmap is missing.
+ */
+class MappedFile
+{
+    public:
+        MappedFile()
+            : mData(0)
+            , mSize(0)
+        {}
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            delete[] mData;
+#else
+            if (mData)
+                munmap(mData, mSize);
+#endif
+        }
+
+        bool open(const std::string &path)
+        {
+#ifdef _WIN32
+            std::ifstream file(path.c_str(), std::ios::binary);
+            if (!file)
+                return false;
+            file.seekg(0, std::ios::end);
+            mSize = file.tellg();
+            file.seekg(0, std::ios::beg);
+            mData = new char[mSize];
+            file.read(mData, mSize);
+            return file.good();
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0)
+            {
+                close(fd);
+                return false;
+            }
+
+            void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED)
+                return false;
+
+            mData = static_cast<char *>(data);
+            mSize = info.st_size;
+            return true;
+#endif
+        }
+
+        const char *data() const
+        { return mData; }
+
+        size_t size() const
+        { return mSize; }
+
+    private:
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        char *mData;
+        size_t mSize;
+};
+
+/**
+ * Collects the strings of a compiled map, each written once.
+ */
+class StringTable
+{
+    public:
+        uint32_t add(const std::string &string)
+        {
+            std::map<std::string, uint32_t>::const_iterator it =
+                    mOffsets.find(string);
+            if (it != mOffsets.end())
+                return it->second;
+
+            const uint32_t offset = mData.size();
+            mData.append(string.c_str(), string.size() + 1);
+            mOffsets[string] = offset;
+            return offset;
+        }
+
+        const std::string &data() const
+        { return mData; }
+
+    private:
+        std::string mData;
+        std::map<std::string, uint32_t> mOffsets;
+};
+
+} // anonymous namespace
+
+template< typename T >
+static void append(std::string &buffer, const T *data, size_t count)
+{
+    buffer.append(reinterpret_cast<const char *>(data), sizeof(T) * count);
+}
+
+static std::string getCacheFile(const std::string &cachePath,
+                                const std::string &filename)
+{
+    std::string name = filename;
+    for (std::string::iterator it = name.begin(); it != name.end(); ++it)
+    {
+        if (*it == '/' || *it == '\\')
+            *it = '_';
+    }
+    return cachePath + "/" + name + ".cache";
+}
+
+static bool readSource(const std::string &path, std::string &content)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return true;
+}
+
+/**
+ * Reads a compiled map made from a map file with the given hash.
+ * @return the map, or 0 when the compiled map is missing, stale or damaged.
+ */
+static Map *readCompiled(const std::string &cacheFile,
+                         const std::string &sourceHash)
+{
+    MappedFile file;
+    if (!file.open(cacheFile) || file.size() < sizeof(Header))
+        return 0;
+
+    const char *data = file.data();
+    const Header *header = reinterpret_cast<const Header *>(data);
+
+    if (header->magic != MAGIC || header->version != VERSION ||
+        sourceHash.compare(0, std::string::npos,
+                           header->sourceHash, sizeof(header->sourceHash)))
+        return 0;
+
+    const int wordsPerRow = (header->width + 63) / 64;
+    if (header->width < 0 || header->height < 0 ||
+        header->wallWords != uint64_t(wordsPerRow) * header->height)
+        return 0;
+
+    const size_t wallsOffset = sizeof(Header);
+    const size_t propertiesOffset =
+            wallsOffset + header->wallWords * sizeof(uint64_t);
+    const size_t objectsOffset =
+            propertiesOffset + header->propertyCount * sizeof(PropertyRecord);
+    const size_t objectPropertiesOffset =
+            objectsOffset + header->objectCount * sizeof(ObjectRecord);
+    const size_t stringsOffset = objectPropertiesOffset +
+            header->objectPropertyCount * sizeof(PropertyRecord);
+
+    if (file.size() != stringsOffset + header->stringsSize ||
+        header->stringsSize == 0 || data[file.size() - 1] != '\0')
+    {
+        LOG_WARN("Damaged compiled map " << cacheFile);
+        return 0;
+    }
+
+    const uint32_t stringsSize = header->stringsSize;
+    const char *strings = data + stringsOffset;
+    const PropertyRecord *properties =
+            reinterpret_cast<const PropertyRecord *>(data + propertiesOffset);
+    const ObjectRecord *objects =
+            reinterpret_cast<const ObjectRecord *>(data + objectsOffset);
+    const PropertyRecord *objectProperties =
+            reinterpret_cast<const PropertyRecord *>(
+                data + objectPropertiesOffset);
+
+    // Check all the references before trusting them
+    for (uint32_t i = 0; i < header->propertyCount; ++i)
+    {
+        if (properties[i].key >= stringsSize ||
+            properties[i].value >= stringsSize)
+            return 0;
+    }
+    for (uint32_t i = 0; i < header->objectPropertyCount; ++i)
+    {
+        if (objectProperties[i].key >= stringsSize ||
+            objectProperties[i].value >= stringsSize)
+            return 0;
+    }
+    for (uint32_t i = 0; i < header->objectCount; ++i)
+    {
+        const ObjectRecord &object = objects[i];
+        if (object.name >= stringsSize || object.type >= stringsSize ||
+            object.firstProperty > header->objectPropertyCount ||
+            object.propertyCount >
+                header->objectPropertyCount - object.firstProperty)
+            return 0;
+    }
+
+    Map *map = new Map(header->width, header->height,
+                       header->tileWidth, header->tileHeight);
+    map->setWalls(reinterpret_cast<const uint64_t *>(data + wallsOffset));
+
+    for (uint32_t i = 0; i < header->propertyCount; ++i)
+        map->setProperty(strings + properties[i].key,
+                         strings + properties[i].value);
+
+    for (uint32_t i = 0; i < header->objectCount; ++i)
+    {
+        const ObjectRecord &record = objects[i];
+        const Rectangle rect = { record.x, record.y,
+                                 record.width, record.height };
+        MapObject *object = new MapObject(rect, strings + record.name,
+                                          strings + record.type);
+
+        for (uint32_t p = record.firstProperty,
+             p_end = record.firstProperty + record.propertyCount;
+             p < p_end; ++p)
+        {
+            object->addProperty(strings + objectProperties[p].key,
+                                strings + objectProperties[p].value);
+        }
+
+        map->addObject(object);
+    }
+
+    return map;
+}
+
+static void writeCompiled(const std::string &cachePath,
+                          const std::string &cacheFile,
+                          const std::string &sourceHash,
+                          const Map &map)
+{
+    StringTable strings;
+
+    std::vector<PropertyRecord> properties;
+    const std::map<std::string, std::string> &mapProperties =
+            map.getProperties();
+    for (std::map<std::string, std::string>::const_iterator it =
+         mapProperties.begin(), it_end = mapProperties.end();
+         it != it_end; ++it)
+    {
+        PropertyRecord property = { strings.add(it->first),
+                                    strings.add(it->second) };
+        properties.push_back(property);
+    }
+
+    std::vector<ObjectRecord> objects;
+    std::vector<PropertyRecord> objectProperties;
+    const std::vector<MapObject *> &mapObjects = map.getObjects();
+    for (std::vector<MapObject *>::const_iterator it = mapObjects.begin(),
+         it_end = mapObjects.end(); it != it_end; ++it)
+    {
+        const MapObject *object = *it;
+        const Rectangle &bounds = object->getBounds();
+
+        ObjectRecord record;
+        record.x = bounds.x;
+        record.y = bounds.y;
+        record.width = bounds.w;
+        record.height = bounds.h;
+        record.name = strings.add(object->getName());
+        record.type = strings.add(object->getType());
+        record.firstProperty = objectProperties.size();
+
+        const utils::NameMap<std::string> &props = object->getProperties();
+        for (utils::NameMap<std::string>::const_iterator p = props.begin(),
+             p_end = props.end(); p != p_end; ++p)
+        {
+            PropertyRecord property = { strings.add(p->first),
+                                        strings.add(p->second) };
+            objectProperties.push_back(property);
+        }
+
+        record.propertyCount =
+                objectProperties.size() - record.firstProperty;
+        objects.push_back(record);
+    }
+
+    // Makes sure the string table is never empty
+    strings.add(std::string());
+
+    const std::vector<uint64_t> &walls = map.getWalls();
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    std::memcpy(header.sourceHash, sourceHash.data(),
+                std::min(sourceHash.size(), sizeof(header.sourceHash)));
+    header.width = map.getWidth();
+    header.height = map.getHeight();
+    header.tileWidth = map.getTileWidth();
+    header.tileHeight = map.getTileHeight();
+    header.wallWords = walls.size();
+    header.propertyCount = properties.size();
+    header.objectCount = objects.size();
+    header.objectPropertyCount = objectProperties.size();
+    header.stringsSize = strings.data().size();
+
+    std::string buffer;
+    append(buffer, &header, 1);
+    append(buffer, walls.data(), walls.size());
+    append(buffer, properties.data(), properties.size());
+    append(buffer, objects.data(), objects.size());
+    append(buffer, objectProperties.data(), objectProperties.size());
+    buffer += strings.data();
+
+#ifdef _WIN32
+    _mkdir(cachePath.c_str());
+#else
+    mkdir(cachePath.c_str(), 0755);
+#endif
+
+    // Written aside first, so that other servers never see half a file. The
+    // name is unique to this process and to this map.
+    std::ostringstream tempFile;
+    tempFile << cacheFile << '.' << getpid() << '.' << &map;
+    {
+        std::ofstream file(tempFile.str().c_str(),
+                           std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(buffer.data(), buffer.size()))
+        {
+            LOG_WARN("Unable to write compiled map " << cacheFile);
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(cacheFile.c_str());
+#endif
+    if (std::rename(tempFile.str().c_str(), cacheFile.c_str()) != 0)
+    {
+        LOG_WARN("Unable to write compiled map " << cacheFile << ": "
+                 << std::strerror(errno));
+        std::remove(tempFile.str().c_str());
+    }
+}
+
+Map *MapCache::readMap(const std::string &filename)
+{
+    const std::string cachePath =
+            Configuration::getValue("game_mapCachePath",
+                                    std::string("mapcache"));
+    const std::string sourceFile = ResourceManager::resolve(filename);
+
+    std::string source;
+    if (cachePath.empty() || sourceFile.empty() ||
+        !readSource(sourceFile, source))
+        return MapReader::readMap(filename);
+
+    const std::string sourceHash = sha256(source);
+    const std::string cacheFile = getCacheFile(cachePath, filename);
+
+    if (Map *map = readCompiled(cacheFile, sourceHash))
+    {
+        LOG_DEBUG("Read compiled map " << cacheFile);
+        return map;
+    }
+
+    Map *map = MapReader::readMap(filename);
+    if (map)
+        writeCompiled(cachePath, cacheFile, sourceHash, *map);
+    return map;
+}
@@ -0,0 +1,47 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <string>
+
+class Map;
+
+/**
+ * Keeps a compiled copy of every map file read by the server, holding the
+ * collision layer as the bit plane used by Map and the objects as a flat
+ * table. Reading it skips the XML parsing and layer decoding.
+ *
+ * A compiled map is only used when it was made from the current content of
+ * the map file, otherwise the map file is read and compiled again.
+ */
+namespace MapCache
+{
+    /**
+     * Reads a map, from its compiled copy when it is up to date and from the
+     * map file otherwise. Can be called from several threads at once.
+     *
+     * @return the map when successful, 0 otherwise.
+     */
+    Map *readMap(const std::string &filename);
+}
+
+#endif // MAPCACHE_H
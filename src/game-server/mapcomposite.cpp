@@ -21,15 +21,16 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 
 #include "accountconnection.h"
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "game-server/charactercomponent.h"
+#include "game-server/mapcache.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/map.h"
 #include "game-server/mapmanager.h"
-#include "game-server/mapreader.h"
 #include "game-server/monstermanager.h"
 #include "game-server/spawnareacomponent.h"
 #include "game-server/triggerareacomponent.h"
@@ -136,19 +137,23 @@ bool ObjectBucket::isAllocated(int i) const
  * MapZone
  *****************************************************************************/
 
-/* TODO: Implement overlapping map zones instead of strict partitioning.
-   Purpose: to decrease the number of zone changes, as overlapping allows for
-   hysteresis effect and prevents an actor from changing zone each server
-   tick. It requires storing the zone in the actor since it will not be
-   uniquely defined any longer. */
+/* Map zones overlap: an actor is put in the zone containing its position,
+   but only leaves it once it moved further than the zone margin outside of
+   it. This hysteresis keeps an actor walking along a border from changing
+   zone each server tick. The zone is stored in the actor since it is not
+   uniquely defined by the position any longer, and every query around a
+   point is widened by the margin. */
 
-/* Pixel-based width and height of the squares used in partitioning the map.
-   Squares should be big enough so that an actor cannot cross several ones
-   in one world tick.
-   TODO: Tune for decreasing server load. The higher the value, the closer we
+/* Bounds of the pixel-based width and height of the squares used in
+   partitioning the map. Squares should be big enough so that an actor cannot
+   cross several ones in one world tick. The higher the value, the closer we
    regress to quadratic behavior; the lower the value, the more we waste time
-   in dealing with zone changes. */
-static int const zoneDiam = 256;
+   in dealing with zone changes. Within these bounds, the size is chosen per
+   map so that zones hold about zoneTargetBeings beings once all spawn areas
+   are full. */
+static int const minZoneDiam = 128;
+static int const maxZoneDiam = 512;
+static int const zoneTargetBeings = 8;
 
 /**
  * Part of a map.
@@ -298,9 +303,15 @@ struct MapContent
     void fillRegion(MapRegion &, const Rectangle &) const;
 
     /**
-     * Gets zone at given position.
+     * Gets index of the zone at given position.
      */
-    MapZone &getZone(const Point &pos) const;
+    unsigned getZoneIndex(const Point &pos) const;
+
+    /**
+     * Tells whether a position is still close enough to a zone for an actor
+     * to stay in it.
+     */
+    bool isInZoneRange(unsigned zone, const Point &pos) const;
 
     /**
      * Entities (items, characters, monsters, etc) located on the map.
@@ -321,8 +332,48 @@ struct MapContent
 
     unsigned short mapWidth;  /**< Width with respect to zones. */
     unsigned short mapHeight; /**< Height with respect to zones. */
+
+    int zoneDiam;             /**< Size of the zones in pixels. */
+    int zoneMargin;           /**< How far actors may leave their zone. */
 };
 
+/**
+ * Chooses the zone size of a map from its size and the number of monsters
+ * its spawn areas hold.
+ */
+static int chooseZoneDiam(const Map *map)
+{
+    int zoneDiam = Configuration::getValue("game_zoneDiameter", 0);
+    if (zoneDiam > 0)
+        return std::max(zoneDiam, minZoneDiam);
+
+    const int width = map->getWidth() * map->getTileWidth();
+    const int height = map->getHeight() * map->getTileHeight();
+
+    int expectedBeings = 0;
+    const std::vector<MapObject *> &objects = map->getObjects();
+    for (std::vector<MapObject *>::const_iterator it = objects.begin(),
+         it_end = objects.end(); it != it_end; ++it)
+    {
+        if (utils::compareStrI((*it)->getType(), "SPAWN") == 0)
+            expectedBeings +=
+                    utils::stringToInt((*it)->getProperty("MAX_BEINGS"));
+    }
+
+    if (expectedBeings <= 0)
+        return maxZoneDiam;
+
+    const double zoneArea =
+            double(width) * height * zoneTargetBeings / expectedBeings;
+    zoneDiam = int(std::sqrt(zoneArea));
+
+    // Round to whole tiles
+    const int tileSize = std::max(map->getTileWidth(), map->getTileHeight());
+    zoneDiam = (zoneDiam + tileSize / 2) / tileSize * tileSize;
+
+    return std::min(std::max(zoneDiam, minZoneDiam), maxZoneDiam);
+}
+
 MapContent::MapContent(Map *map)
   : last_bucket(0), zones(nullptr)
 {
@@ -332,6 +383,10 @@ MapContent::MapContent(Map *map)
     {
         buckets[i] = nullptr;
     }
+    zoneDiam = chooseZoneDiam(map);
+    zoneMargin = zoneDiam / 4;
+    LOG_DEBUG("Using map zones of " << zoneDiam << " pixels");
+
     mapWidth = (map->getWidth() * map->getTileWidth() + zoneDiam - 1)
                / zoneDiam;
     mapHeight = (map->getHeight() * map->getTileHeight() + zoneDiam - 1)
@@ -427,6 +482,9 @@ static void addZone(MapRegion &r, unsigned z)
 
 void MapContent::fillRegion(MapRegion &r, const Point &p, int radius) const
 {
+    // Actors may be stored in a zone they slightly left
+    radius += zoneMargin;
+
     int ax = p.x > radius ? (p.x - radius) / zoneDiam : 0,
         ay = p.y > radius ? (p.y - radius) / zoneDiam : 0,
         bx = std::min((p.x + radius) / zoneDiam, mapWidth - 1),
@@ -442,10 +500,11 @@ void MapContent::fillRegion(MapRegion &r, const Point &p, int radius) const
 
 void MapContent::fillRegion(MapRegion &r, const Rectangle &p) const
 {
-    int ax = p.x / zoneDiam,
-        ay = p.y / zoneDiam,
-        bx = std::min((p.x + p.w) / zoneDiam, mapWidth - 1),
-        by = std::min((p.y + p.h) / zoneDiam, mapHeight - 1);
+    // Actors may be stored in a zone they slightly left
+    int ax = std::max(p.x - zoneMargin, 0) / zoneDiam,
+        ay = std::max(p.y - zoneMargin, 0) / zoneDiam,
+        bx = std::min((p.x + p.w + zoneMargin) / zoneDiam, mapWidth - 1),
+        by = std::min((p.y + p.h + zoneMargin) / zoneDiam, mapHeight - 1);
     for (int y = ay; y <= by; ++y)
     {
         for (int x = ax; x <= bx; ++x)
@@ -455,9 +514,18 @@ void MapContent::fillRegion(MapRegion &r, const Rectangle &p) const
     }
 }
 
-MapZone& MapContent::getZone(const Point &pos) const
+unsigned MapContent::getZoneIndex(const Point &pos) const
 {
-    return zones[(pos.x / zoneDiam) + (pos.y / zoneDiam) * mapWidth];
+    return (pos.x / zoneDiam) + (pos.y / zoneDiam) * mapWidth;
+}
+
+bool MapContent::isInZoneRange(unsigned zone, const Point &pos) const
+{
+    const int left = (zone % mapWidth) * zoneDiam - zoneMargin;
+    const int top = (zone / mapWidth) * zoneDiam - zoneMargin;
+    const int size = zoneDiam + 2 * zoneMargin;
+    return pos.x >= left && pos.x < left + size &&
+           pos.y >= top && pos.y < top + size;
 }
 
 
@@ -610,14 +678,24 @@ MapComposite::~MapComposite()
     delete mContent;
 }
 
-bool MapComposite::readMap()
+Map *MapComposite::readMap(const std::string &name)
 {
-    std::string file = "maps/" + mName + ".tmx";
+    return MapCache::readMap("maps/" + name + ".tmx");
+}
 
-    mMap = MapReader::readMap(file);
+bool MapComposite::readMap()
+{
+    setMap(readMap(mName));
     return mMap;
 }
 
+void MapComposite::setMap(Map *map)
+{
+    assert(!isActive());
+    delete mMap;
+    mMap = map;
+}
+
 bool MapComposite::activate()
 {
     assert(!isActive());
@@ -710,9 +788,11 @@ bool MapComposite::insert(Entity *ptr)
         if (ptr->canMove() && !mContent->allocate(ptr))
             return false;
 
-        const Point &point =
-                ptr->getComponent<ActorComponent>()->getPosition();
-        mContent->getZone(point).insert(ptr);
+        auto *actorComponent = ptr->getComponent<ActorComponent>();
+        const unsigned zone =
+                mContent->getZoneIndex(actorComponent->getPosition());
+        actorComponent->setZone(zone);
+        mContent->zones[zone].insert(ptr);
     }
 
     ptr->setMap(this);
@@ -733,9 +813,8 @@ void MapComposite::remove(Entity *ptr)
 
     if (ptr->isVisible())
     {
-        const Point &point =
-                ptr->getComponent<ActorComponent>()->getPosition();
-        mContent->getZone(point).remove(ptr);
+        const unsigned zone = ptr->getComponent<ActorComponent>()->getZone();
+        mContent->zones[zone].remove(ptr);
 
         if (ptr->canMove())
         {
@@ -766,7 +845,10 @@ void MapComposite::update()
         s->push(mID);
         s->execute(this);
     }
+}
 
+void MapComposite::move()
+{
     // Move objects around and update zones.
     for (BeingIterator it(getWholeMapIterator()); it; ++it)
     {
@@ -785,19 +867,21 @@ void MapComposite::update()
         if (!(*i)->canMove())
             continue;
 
-        const Point &pos1 =
-                (*i)->getComponent<BeingComponent>()->getOldPosition();
-        const Point &pos2 =
-                (*i)->getComponent<ActorComponent>()->getPosition();
+        auto *actorComponent = (*i)->getComponent<ActorComponent>();
+        const Point &pos = actorComponent->getPosition();
+        const unsigned srcZone = actorComponent->getZone();
 
-        MapZone &src = mContent->getZone(pos1),
-                &dst = mContent->getZone(pos2);
-        if (&src != &dst)
-        {
-            addZone(src.destinations, &dst - mContent->zones);
-            src.remove(*i);
-            dst.insert(*i);
-        }
+        // Stay in the current zone until far enough outside of it
+        if (mContent->isInZoneRange(srcZone, pos))
+            continue;
+
+        const unsigned dstZone = mContent->getZoneIndex(pos);
+        MapZone &src = mContent->zones[srcZone],
+                &dst = mContent->zones[dstZone];
+        addZone(src.destinations, dstZone);
+        src.remove(*i);
+        dst.insert(*i);
+        actorComponent->setZone(dstZone);
     }
 }
 
@@ -870,6 +954,9 @@ void MapComposite::callWorldVariableCallback(const std::string &key,
 const MapObject *MapComposite::findMapObject(const std::string &name,
                                              const std::string &type) const
 {
+    if (!mMap)
+        return 0;
+
     const std::vector<MapObject *> &destObjects = mMap->getObjects();
     std::vector<MapObject *>::const_iterator it, it_end;
     for (it = destObjects.begin(), it_end = destObjects.end();
@@ -135,8 +135,24 @@ class MapComposite
         MapComposite(const MapComposite &) = delete;
         ~MapComposite();
 
+        /**
+         * Parses the map file. Only reads the file, so that it may be called
+         * from a loader thread, the result is handed over with setMap().
+         *
+         * @return the map, or null when it could not be read.
+         */
+        static Map *readMap(const std::string &name);
+
+        /**
+         * Parses the map file right away.
+         */
         bool readMap();
 
+        /**
+         * Takes ownership of the map parsed for this composite.
+         */
+        void setMap(Map *map);
+
         /**
          * Loads the map and initializes the map content. Should only be called
          * once!
@@ -187,10 +203,15 @@ class MapComposite
         Entity *findEntityById(int publicId) const;
 
         /**
-         * Updates zones of every moving beings.
+         * Updates the entities of the map.
          */
         void update();
 
+        /**
+         * Moves the beings and updates the zones they are in.
+         */
+        void move();
+
         /**
          * Gets the PvP rules on the map.
          */
@@ -21,19 +21,149 @@
 
 #include "game-server/mapmanager.h"
 
+#include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "common/defines.h"
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "utils/logger.h"
+#include "utils/nameindex.h"
+#include "utils/string.h"
 
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 /**
  * List of all the game maps, be they present or not on this server.
  */
 static MapManager::Maps maps;
 
+/**
+ * The same maps, by name.
+ */
+static utils::NameIndex<MapComposite *> mapsByName;
+
+/**
+ * Maps are only read when this server activates them, by a few loader
+ * threads. The threads only see the map names and hand the parsed maps back,
+ * everything else happens on the main thread.
+ */
+namespace {
+
+struct LoadedMap
+{
+    int id;
+    Map *map;
+};
+
+std::vector<std::thread> loaderThreads;
+std::mutex loaderMutex;
+std::condition_variable loaderWake;
+std::deque< std::pair<int, std::string> > loadQueue;   // guarded
+std::vector<LoadedMap> loadedMaps;                     // guarded
+bool stopLoaders = false;                              // guarded
+
+std::set<int> loadingMaps;
+std::set<int> failedMaps;
+std::map< int, std::vector<MapManager::ActivationCallback> >
+        pendingActivations;
+
+} // anonymous namespace
+
+static void runLoader()
+{
+    std::unique_lock<std::mutex> lock(loaderMutex);
+    while (true)
+    {
+        loaderWake.wait(lock, [] { return stopLoaders || !loadQueue.empty(); });
+        if (stopLoaders)
+            return;
+
+        const std::pair<int, std::string> request = loadQueue.front();
+        loadQueue.pop_front();
+
+        lock.unlock();
+        LoadedMap loaded = { request.first,
+                             MapComposite::readMap(request.second) };
+        lock.lock();
+
+        loadedMaps.push_back(loaded);
+    }
+}
+
+/**
+ * Starts reading the given map, unless it is read already.
+ */
+static void requestLoad(MapComposite *composite)
+{
+    const int id = composite->getID();
+    if (composite->getMap() || loadingMaps.count(id) || failedMaps.count(id))
+        return;
+
+    loadingMaps.insert(id);
+
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    if (loaderThreads.empty())
+    {
+        LoadedMap loaded = { id, MapComposite::readMap(composite->getName()) };
+        loadedMaps.push_back(loaded);
+    }
+    else
+    {
+        loadQueue.push_back(std::make_pair(id, composite->getName()));
+        loaderWake.notify_one();
+    }
+}
+
+/**
+ * Finds the maps that the warps of the given map lead to by the name of a
+ * warp object. These need to be read for the warps to be set up.
+ */
+static std::vector<MapComposite *> getWarpTargets(const Map *map)
+{
+    std::vector<MapComposite *> targets;
+    const std::vector<MapObject *> &objects = map->getObjects();
+    for (std::vector<MapObject *>::const_iterator it = objects.begin(),
+         it_end = objects.end(); it != it_end; ++it)
+    {
+        const MapObject *object = *it;
+        if (utils::compareStrI(object->getType(), "WARP") != 0 ||
+            !object->hasProperty("DEST_NAME"))
+            continue;
+
+        if (MapComposite *target =
+                MapManager::getMap(object->getProperty("DEST_MAP")))
+            targets.push_back(target);
+    }
+    return targets;
+}
+
+/**
+ * Whether the map and the maps its warps lead to were read, or given up on.
+ */
+static bool isReady(MapComposite *composite)
+{
+    if (failedMaps.count(composite->getID()))
+        return true;
+    if (!composite->getMap())
+        return false;
+
+    const std::vector<MapComposite *> targets =
+            getWarpTargets(composite->getMap());
+    for (std::vector<MapComposite *>::const_iterator it = targets.begin(),
+         it_end = targets.end(); it != it_end; ++it)
+    {
+        if (loadingMaps.count((*it)->getID()))
+            return false;
+    }
+    return true;
+}
+
 const MapManager::Maps &MapManager::getMaps()
 {
     return maps;
@@ -41,7 +171,16 @@ const MapManager::Maps &MapManager::getMaps()
 
 void MapManager::initialize()
 {
+    const int threads = Configuration::getValue("game_mapLoaderThreads", 2);
+    if (threads <= 0 || !loaderThreads.empty())
+        return;
+
+    // Needed before libxml2 is used from several threads
+    xmlInitParser();
 
+    stopLoaders = false;
+    for (int i = 0; i < threads; ++i)
+        loaderThreads.push_back(std::thread(runLoader));
 }
 
 /**
@@ -49,11 +188,35 @@ void MapManager::initialize()
  */
 void MapManager::deinitialize()
 {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        stopLoaders = true;
+        loadQueue.clear();
+    }
+    loaderWake.notify_all();
+    for (std::vector<std::thread>::iterator it = loaderThreads.begin(),
+         it_end = loaderThreads.end(); it != it_end; ++it)
+    {
+        it->join();
+    }
+    loaderThreads.clear();
+
+    for (std::vector<LoadedMap>::iterator it = loadedMaps.begin(),
+         it_end = loadedMaps.end(); it != it_end; ++it)
+    {
+        delete it->map;
+    }
+    loadedMaps.clear();
+    loadingMaps.clear();
+    failedMaps.clear();
+    pendingActivations.clear();
+
     for (Maps::iterator i = maps.begin(), i_end = maps.end(); i != i_end; ++i)
     {
         delete i->second;
     }
     maps.clear();
+    mapsByName.clear();
 }
 
 /**
@@ -96,11 +259,11 @@ void MapManager::readMapNode(xmlNodePtr node)
             mapFileExists = ResourceManager::exists(file);
         }
 
+        // The map is only read when it gets activated
         if (mapFileExists)
         {
             maps[id] = new MapComposite(id, name);
-            if (!maps[id]->readMap())
-                LOG_FATAL("Failed to load map \"" << name << "\"!");
+            mapsByName.insert(id, name, maps[id]);
         }
     }
 }
@@ -130,11 +293,7 @@ MapComposite *MapManager::getMap(int mapId)
 
 MapComposite *MapManager::getMap(const std::string &mapName)
 {
-    for (Maps::const_iterator i = maps.begin(); i != maps.end(); ++i)
-        if (i->second->getName() == mapName)
-            return i->second;
-
-    return nullptr;
+    return mapsByName.findByName(mapName);
 }
 
 bool MapManager::activateMap(int mapId)
@@ -146,6 +305,25 @@ bool MapManager::activateMap(int mapId)
     if (composite->isActive())
         return true;
 
+    if (!composite->getMap())
+    {
+        if (!composite->readMap())
+            LOG_FATAL("Failed to load map \"" << composite->getName() << "\"!");
+
+        // Warps need to find their destination on the maps they lead to
+        else
+        {
+            const std::vector<MapComposite *> targets =
+                    getWarpTargets(composite->getMap());
+            for (std::vector<MapComposite *>::const_iterator it =
+                 targets.begin(), it_end = targets.end(); it != it_end; ++it)
+            {
+                if (!(*it)->getMap() && !loadingMaps.count((*it)->getID()))
+                    (*it)->readMap();
+            }
+        }
+    }
+
     if (composite->activate())
     {
         LOG_INFO("Activated map \"" << composite->getName()
@@ -159,3 +337,89 @@ bool MapManager::activateMap(int mapId)
         return false;
     }
 }
+
+void MapManager::activateMap(int mapId, const ActivationCallback &callback)
+{
+    Maps::iterator i = maps.find(mapId);
+    assert(i != maps.end());
+    MapComposite *composite = i->second;
+
+    if (composite->isActive())
+    {
+        callback(composite);
+        return;
+    }
+
+    pendingActivations[mapId].push_back(callback);
+    requestLoad(composite);
+}
+
+bool MapManager::isActivating(int mapId)
+{
+    return pendingActivations.count(mapId) != 0;
+}
+
+void MapManager::update()
+{
+    std::vector<LoadedMap> loaded;
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loaded.swap(loadedMaps);
+    }
+
+    for (std::vector<LoadedMap>::const_iterator it = loaded.begin(),
+         it_end = loaded.end(); it != it_end; ++it)
+    {
+        loadingMaps.erase(it->id);
+        MapComposite *composite = getMap(it->id);
+
+        if (!it->map)
+        {
+            LOG_FATAL("Failed to load map \"" << composite->getName() << "\"!");
+            failedMaps.insert(it->id);
+            continue;
+        }
+
+        composite->setMap(it->map);
+
+        // Warps leading to a named object need the target map as well
+        if (pendingActivations.count(it->id))
+        {
+            const std::vector<MapComposite *> targets =
+                    getWarpTargets(it->map);
+            for (std::vector<MapComposite *>::const_iterator t =
+                 targets.begin(), t_end = targets.end(); t != t_end; ++t)
+            {
+                requestLoad(*t);
+            }
+        }
+    }
+
+    if (loaded.empty())
+        return;
+
+    std::map< int, std::vector<ActivationCallback> >::iterator it =
+            pendingActivations.begin();
+    while (it != pendingActivations.end())
+    {
+        MapComposite *composite = getMap(it->first);
+        if (!isReady(composite))
+        {
+            ++it;
+            continue;
+        }
+
+        const std::vector<ActivationCallback> callbacks = it->second;
+        pendingActivations.erase(it++);
+
+        if (failedMaps.count(composite->getID()) ||
+            !activateMap(composite->getID()))
+            composite = nullptr;
+
+        for (std::vector<ActivationCallback>::const_iterator c =
+             callbacks.begin(), c_end = callbacks.end(); c != c_end; ++c)
+        {
+            (*c)(composite);
+        }
+    }
+}
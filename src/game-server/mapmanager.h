@@ -22,6 +22,7 @@
 #ifndef MAPMANAGER_H
 #define MAPMANAGER_H
 
+#include <functional>
 #include <map>
 #include <string>
 
@@ -33,6 +34,11 @@ namespace MapManager
 {
     typedef std::map< int, MapComposite * > Maps;
 
+    typedef std::function<void (MapComposite *)> ActivationCallback;
+
+    /**
+     * Starts the map loader threads.
+     */
     void initialize();
 
     void deinitialize();
@@ -61,10 +67,30 @@ namespace MapManager
     const Maps &getMaps();
 
     /**
-     * Sets the activity status of the map.
+     * Sets the activity status of the map, reading it first if needed.
      * @return true if the activation was successful.
      */
     bool activateMap(int mapId);
+
+    /**
+     * Activates the map once the loader threads have read it, along with
+     * the maps its warps lead to. The callback is called from update()
+     * after the activation, or with null when the map could not be read or
+     * activated.
+     */
+    void activateMap(int mapId, const ActivationCallback &callback);
+
+    /**
+     * Whether the map is being loaded to be activated. Characters arriving
+     * on it have to wait until it is.
+     */
+    bool isActivating(int mapId);
+
+    /**
+     * Takes the maps read by the loader threads and activates the ones that
+     * are ready. Called once per tick.
+     */
+    void update();
 }
 
 #endif // MAPMANAGER_H
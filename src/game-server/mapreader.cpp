@@ -31,8 +31,6 @@
 
 #include <cstring>
 
-static std::vector<unsigned> tilesetFirstGids;
-
 Map *MapReader::readMap(const std::string &filename)
 {
     XML::Document doc(filename);
@@ -56,6 +54,9 @@ Map *MapReader::readMap(xmlNodePtr node)
     int tileH = XML::getProperty(node, "tileheight", DEFAULT_TILE_LENGTH);
     Map *map = new Map(w, h, tileW, tileH);
 
+    // Kept local, maps may be read by several threads at once
+    std::vector<unsigned> tilesetFirstGids;
+
     for (node = node->xmlChildrenNode; node != nullptr; node = node->next)
     {
         if (xmlStrEqual(node->name, BAD_CAST "tileset"))
@@ -66,8 +67,8 @@ Map *MapReader::readMap(xmlNodePtr node)
             }
             else
             {
-                ::tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
-                                                              0));
+                tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
+                                                            0));
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "properties"))
@@ -90,7 +91,7 @@ Map *MapReader::readMap(xmlNodePtr node)
             if (utils::compareStrI(XML::getProperty(node, "name", "unnamed"),
                                    "collision") == 0)
             {
-                readLayer(node, map);
+                readLayer(node, map, tilesetFirstGids);
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "objectgroup"))
@@ -141,13 +142,11 @@ Map *MapReader::readMap(xmlNodePtr node)
         }
     }
 
-    // Clean up tilesets
-    ::tilesetFirstGids.clear();
-
     return map;
 }
 
-void MapReader::readLayer(xmlNodePtr node, Map *map)
+void MapReader::readLayer(xmlNodePtr node, Map *map,
+                          const std::vector<unsigned> &tilesetFirstGids)
 {
     node = node->xmlChildrenNode;
     int h = map->getHeight();
@@ -235,7 +234,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
                     (binData[i + 2] << 16) |
                     (binData[i + 3] << 24);
 
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             if (++x == w)
             {
@@ -263,7 +262,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             pos = csv.find_first_of(",", oldPos);
 
             unsigned gid = atol(csv.substr(oldPos, pos - oldPos).c_str());
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             x++;
             if (x == w)
@@ -290,7 +289,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             if (xmlStrEqual(node->name, BAD_CAST "tile") && y < h)
             {
                 unsigned gid = XML::getProperty(node, "gid", 0);
-                setTileWithGid(map, x, y, gid);
+                setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
                 if (++x == w)
                 {
@@ -332,7 +331,8 @@ int MapReader::getObjectProperty(xmlNodePtr node, int def)
     return val;
 }
 
-void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
+void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid,
+                               const std::vector<unsigned> &tilesetFirstGids)
 {
     // Bits on the far end of the 32-bit global tile ID are used for tile flags
     const int FlippedHorizontallyFlag   = 0x80000000;
@@ -346,8 +346,8 @@ void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
 
     // Find the tileset with the highest firstGid below/eq to gid
     unsigned set = gid;
-    for (std::vector<unsigned>::const_iterator i = ::tilesetFirstGids.begin(),
-         i_end = ::tilesetFirstGids.end(); i != i_end; ++i)
+    for (std::vector<unsigned>::const_iterator i = tilesetFirstGids.begin(),
+         i_end = tilesetFirstGids.end(); i != i_end; ++i)
     {
         if (gid < *i)
             break;
@@ -50,7 +50,8 @@ class MapReader
         /**
          * Reads a map layer and adds it to the given map.
          */
-        static void readLayer(xmlNodePtr node, Map *map);
+        static void readLayer(xmlNodePtr node, Map *map,
+                              const std::vector<unsigned> &tilesetFirstGids);
 
         /**
          * Get the string value from the given object property node.
@@ -63,7 +64,8 @@ class MapReader
          */
         static int getObjectProperty(xmlNodePtr node, int def);
 
-        static void setTileWithGid(Map *map, int x, int y, unsigned gid);
+        static void setTileWithGid(Map *map, int x, int y, unsigned gid,
+                                   const std::vector<unsigned> &tilesetFirstGids);
 };
 
 #endif
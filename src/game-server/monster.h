@@ -131,6 +131,13 @@ class MonsterClass
         Script::Ref getUpdateCallback() const
         { return mUpdateCallback; }
 
+        /**
+         * Takes over the callbacks scripts set on another version of this
+         * monster type, after the game data was reloaded.
+         */
+        void copyCallbacks(const MonsterClass &other)
+        { mUpdateCallback = other.mUpdateCallback; }
+
     private:
         unsigned short mId;
         std::string mName;
@@ -170,6 +177,12 @@ class MonsterComponent : public Component
         MonsterClass *getSpecy() const
         { return mSpecy; }
 
+        /**
+         * Changes monster specy, after the game data was reloaded.
+         */
+        void setSpecy(MonsterClass *specy)
+        { mSpecy = specy; }
+
         /**
          * Performs one step of controller logic.
          */
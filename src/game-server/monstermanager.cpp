@@ -44,7 +44,7 @@ void MonsterManager::initialize()
 
 void MonsterManager::deinitialize()
 {
-    for (MonsterClasses::iterator i = mMonsterClasses.begin(),
+    for (MonsterClasses::const_iterator i = mMonsterClasses.begin(),
          i_end = mMonsterClasses.end(); i != i_end; ++i)
     {
         delete i->second;
@@ -60,8 +60,7 @@ MonsterClass *MonsterManager::getMonsterByName(const std::string &name) const
 
 MonsterClass *MonsterManager::getMonster(int id) const
 {
-    MonsterClasses::const_iterator i = mMonsterClasses.find(id);
-    return i != mMonsterClasses.end() ? i->second : 0;
+    return mMonsterClasses.value(id);
 }
 
 /**
@@ -84,8 +83,7 @@ void MonsterManager::readMonsterNode(xmlNodePtr node, const std::string &filenam
         return;
     }
 
-    MonsterClasses::iterator i = mMonsterClasses.find(monsterId);
-    if (i != mMonsterClasses.end())
+    if (mMonsterClasses.contains(monsterId))
     {
         LOG_WARN("Monster Manager: Ignoring duplicate definition of "
                  "monster '" << monsterId << "'!");
@@ -93,7 +91,7 @@ void MonsterManager::readMonsterNode(xmlNodePtr node, const std::string &filenam
     }
 
     MonsterClass *monster = new MonsterClass(monsterId);
-    mMonsterClasses[monsterId] = monster;
+    mMonsterClasses.insert(monsterId, monster);
 
     if (!name.empty())
     {
@@ -117,9 +115,9 @@ void MonsterManager::readMonsterNode(xmlNodePtr node, const std::string &filenam
                                                 std::string());
             ItemClass *itemClass;
             if (utils::isNumeric(item))
-                itemClass = itemManager->getItem(utils::stringToInt(item));
+                itemClass = mItemManager->getItem(utils::stringToInt(item));
             else
-                itemClass = itemManager->getItemByName(item);
+                itemClass = mItemManager->getItemByName(item);
 
             if (!itemClass)
             {
@@ -198,11 +196,11 @@ void MonsterManager::readMonsterNode(xmlNodePtr node, const std::string &filenam
             if (utils::isNumeric(idText))
             {
                 const int abilityId = utils::stringToInt(idText);
-                info = abilityManager->getAbilityInfo(abilityId);
+                info = mAbilityManager->getAbilityInfo(abilityId);
             }
             else
             {
-                info = abilityManager->getAbilityInfo(idText);
+                info = mAbilityManager->getAbilityInfo(idText);
             }
 
             if (!info)
@@ -221,6 +219,16 @@ void MonsterManager::readMonsterNode(xmlNodePtr node, const std::string &filenam
     monster->setDrops(drops);
 }
 
+void MonsterManager::copyCallbacks(const MonsterManager &other)
+{
+    for (MonsterClasses::const_iterator i = mMonsterClasses.begin(),
+         i_end = mMonsterClasses.end(); i != i_end; ++i)
+    {
+        if (MonsterClass *otherMonster = other.getMonster(i->first))
+            i->second->copyCallbacks(*otherMonster);
+    }
+}
+
 /**
  * Check the status of recently loaded configuration.
  */
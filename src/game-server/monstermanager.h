@@ -22,19 +22,28 @@
 #define MONSTERMANAGER_H
 
 #include <string>
-#include <map>
+#include "utils/idregistry.h"
 #include "utils/string.h"
 #include "utils/xml.h"
 
 
+class AbilityManager;
+class ItemManager;
 class MonsterClass;
 
-typedef std::map< int, MonsterClass * > MonsterClasses;
+typedef utils::IdRegistry< MonsterClass * > MonsterClasses;
 
 class MonsterManager
 {
     public:
-        MonsterManager()
+        /**
+         * @param itemManager    the items monsters drop.
+         * @param abilityManager the abilities monsters use.
+         */
+        MonsterManager(ItemManager *itemManager,
+                       AbilityManager *abilityManager)
+            : mItemManager(itemManager)
+            , mAbilityManager(abilityManager)
         {}
 
         ~MonsterManager()
@@ -74,7 +83,16 @@ class MonsterManager
 
         void checkStatus();
 
+        /**
+         * Takes over the script callbacks of the monsters with the same ID
+         * in another manager, after the game data was reloaded.
+         */
+        void copyCallbacks(const MonsterManager &other);
+
     private:
+        ItemManager *mItemManager;
+        AbilityManager *mAbilityManager;
+
         MonsterClasses mMonsterClasses; /**< Monster reference */
         utils::NameMap<MonsterClass*> mMonsterClassesByName;
 };
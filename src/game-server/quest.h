@@ -23,78 +23,18 @@
 
 #include <string>
 
-#include "scripting/scriptmanager.h"
-
 class Entity;
-class Script;
-
-
-class QuestCallback
-{
-    public:
-        virtual ~QuestCallback()
-        { }
-
-        virtual void triggerCallback(Entity *ch,
-                                     const std::string &value) const = 0;
-};
-
-class QuestThreadCallback : public QuestCallback
-{
-    public:
-        typedef void (*Handler)(Entity *,
-                                const std::string &value,
-                                Script *mScript);
-
-        QuestThreadCallback(Handler handler,
-                            Script *script) :
-            mHandler(handler),
-            mScript(script)
-        { }
-
-        void triggerCallback(Entity *ch, const std::string &value) const
-        { mHandler(ch, value, mScript); }
-
-    private:
-        Handler mHandler;
-        Script *mScript;
-};
-
-class QuestRefCallback : public QuestCallback
-{
-    public:
-        QuestRefCallback(Script *script, const std::string &questName) :
-            mQuestName(questName)
-        { script->assignCallback(mRef); }
-
-        void triggerCallback(Entity *ch, const std::string &value) const;
-
-    private:
-        Script::Ref mRef;
-        std::string mQuestName;
-};
 
 /**
- * Gets the value associated to a quest variable.
- * @return false if no value was in cache.
+ * Gets the value associated to a quest variable. All the quest variables of
+ * a character come with its data, so this never waits for the account
+ * server. A variable that was never set is empty.
  */
-bool getQuestVar(Entity *, const std::string &name, std::string &value);
+std::string getQuestVar(Entity *, const std::string &name);
 
 /**
  * Sets the value associated to a quest variable.
  */
 void setQuestVar(Entity *, const std::string &name, const std::string &value);
 
-/**
- * Starts the recovery of a variable and returns immediatly. The callback will
- * be called once the value has been recovered.
- */
-void recoverQuestVar(Entity *, const std::string &name, QuestCallback *);
-
-/**
- * Called by the handler of the account server when a value is received.
- */
-void recoveredQuestVar(int id, const std::string &name,
-                       const std::string &value);
-
 #endif
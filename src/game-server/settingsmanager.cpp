@@ -23,15 +23,55 @@
 #include "utils/logger.h"
 #include "utils/xml.h"
 
-#include "common/resourcemanager.h"
+#include "common/configuration.h"
 
-#include "game-server/abilitymanager.h"
 #include "game-server/attributemanager.h"
-#include "game-server/itemmanager.h"
+#include "game-server/datapack.h"
+#include "game-server/entity.h"
+#include "game-server/gamedata.h"
 #include "game-server/mapmanager.h"
-#include "game-server/monstermanager.h"
-#include "game-server/emotemanager.h"
-#include "game-server/statusmanager.h"
+
+/** Ticks between two checks for replaced game data no longer in use. */
+static const int RETIRED_DATA_CHECK_INTERVAL = 100;
+
+static bool isFixedSetting(xmlNodePtr node)
+{
+    return xmlStrEqual(node->name, BAD_CAST "map") ||
+           xmlStrEqual(node->name, BAD_CAST "attribute");
+}
+
+static void appendNode(std::string &settings, xmlNodePtr node)
+{
+    xmlBufferPtr buffer = xmlBufferCreate();
+    xmlNodeDump(buffer, node->doc, node, 0, 0);
+    settings.append((const char *) xmlBufferContent(buffer),
+                    xmlBufferLength(buffer));
+    xmlBufferFree(buffer);
+}
+
+SettingsManager::SettingsManager(const std::string &settingsFile):
+    mSettingsFile(settingsFile),
+    mGameData(0),
+    mReloading(false),
+    mReloadedData(0)
+{
+}
+
+SettingsManager::~SettingsManager()
+{
+    if (mReloadThread.joinable())
+        mReloadThread.join();
+
+    delete mReloadedData.load();
+
+    for (std::vector<GameData *>::iterator it = mRetiredData.begin(),
+         it_end = mRetiredData.end(); it != it_end; ++it)
+    {
+        delete *it;
+    }
+
+    delete mGameData;
+}
 
 /**
  * Initialize all managers and load configuration into them.
@@ -43,149 +83,198 @@ void SettingsManager::initialize()
     // initialize all managers in correct order
     MapManager::initialize();
     attributeManager->initialize();
-    abilityManager->initialize();
-    itemManager->initialize();
-    monsterManager->initialize();
-    emoteManager->initialize();
-    StatusManager::initialize();
-
-    loadFile(mSettingsFile);
-    checkStatus();
+    mGameData = new GameData;
+
+    DataPack pack;
+    if (!loadData(pack))
+    {
+        LOG_FATAL("Settings Manager: " << mSettingsFile
+                  << " is not a valid database file!");
+        exit(EXIT_XML_BAD_PARAMETER);
+    }
+
+    pack.visit([this] (xmlNodePtr node, const std::string &filename) {
+        readNode(node, filename);
+    });
+
+    // Finalize the configuration loading and check if all managers are
+    // happy with it.
+    MapManager::checkStatus();
+    attributeManager->checkStatus();
+    mGameData->checkStatus();
+
+    mGameData->publish();
 }
 
 /**
- * Reload managers with new configuration.
- *
- * @note This code is untested, some of the managers didn't even have empty implementations
- *       of reload().
+ * Reload the game data, except for the attributes and maps.
  */
-void SettingsManager::reload()
+bool SettingsManager::reload()
 {
-    MapManager::reload();
-    attributeManager->reload();
-    abilityManager->reload();
-    itemManager->reload();
-    monsterManager->reload();
-    emoteManager->reload();
-    StatusManager::reload();
-
-    loadFile(mSettingsFile);
-    checkStatus();
+    if (mReloading)
+        return false;
+
+    if (mReloadThread.joinable())
+        mReloadThread.join();
+
+    mReloading = true;
+    mReloadThread = std::thread(&SettingsManager::reloadData, this);
+    return true;
+}
+
+void SettingsManager::update()
+{
+    if (GameData *data = mReloadedData.exchange(0))
+    {
+        data->copyCallbacks(*mGameData);
+        data->publish();
+
+        mRetiredData.push_back(mGameData);
+        mGameData = data;
+
+        rebindEntities();
+        mReloading = false;
+
+        LOG_INFO("Settings Manager: now using the reloaded game data.");
+    }
+    else if (mRetiredData.empty() || !mRetiredDataCheck.expired())
+    {
+        return;
+    }
+
+    // Entities still using types that were removed from the data keep the
+    // version they come from alive until they go away
+    deleteRetiredData();
+    mRetiredDataCheck.set(RETIRED_DATA_CHECK_INTERVAL);
 }
 
 /**
- * Load a configuration file.
+ * Load the game settings, from the data pack when it is up to date.
  */
-void SettingsManager::loadFile(const std::string &filename)
+bool SettingsManager::loadData(DataPack &pack)
 {
-    LOG_INFO("Loading game settings from " << filename);
+    const std::string packFile =
+            Configuration::getValue("game_dataPack", std::string());
+
+    if (!packFile.empty() && pack.read(packFile) &&
+        pack.isUpToDate(mSettingsFile))
+    {
+        LOG_INFO("Loading game settings from " << packFile);
+        return true;
+    }
+
+    LOG_INFO("Loading game settings from " << mSettingsFile);
 
-    XML::Document doc(filename);
-    xmlNodePtr node = doc.rootNode();
+    if (!pack.compile(mSettingsFile))
+        return false;
 
-    // add file to include set
-    mIncludedFiles.insert(filename);
+    if (!packFile.empty())
+        pack.write(packFile);
+    return true;
+}
 
-    // FIXME: check root node's name when bjorn decides it's time
-    if (!node /*|| !xmlStrEqual(node->name, BAD_CAST "settings") */)
+/**
+ * Pass a node of the configuration to the manager it is meant for.
+ */
+void SettingsManager::readNode(xmlNodePtr childNode,
+                               const std::string &filename)
+{
+    if (xmlStrEqual(childNode->name, BAD_CAST "map"))
     {
-        LOG_FATAL("Settings Manager: " << filename << " is not a valid database file!");
-        exit(EXIT_XML_BAD_PARAMETER);
+        // map config
+        MapManager::readMapNode(childNode);
+        appendNode(mFixedSettings, childNode);
     }
+    else if (xmlStrEqual(childNode->name, BAD_CAST "attribute"))
+    {
+        // attribute config
+        attributeManager->readAttributeNode(childNode);
+        appendNode(mFixedSettings, childNode);
+    }
+    else if (!mGameData->readNode(childNode, filename))
+    {
+        // since the client and server share settings, don't be too strict
+//        LOG_WARN("Unexpected tag <" << childNode->name << "> in " << filename);
+    }
+}
 
-
-    // go through every node
-    for_each_xml_child_node(childNode, node)
+/**
+ * Runs on the reload thread. Only touches the data it makes, which is handed
+ * over to update() when complete.
+ */
+void SettingsManager::reloadData()
+{
+    DataPack pack;
+    if (!loadData(pack))
     {
-        if (childNode->type != XML_ELEMENT_NODE)
-            continue;
+        LOG_ERROR("Settings Manager: " << mSettingsFile
+                  << " is not a valid database file, the game data was not"
+                  " reloaded.");
+        mReloading = false;
+        return;
+    }
 
-        if (xmlStrEqual(childNode->name, BAD_CAST "include"))
-        {
-            // include an other file
-            const std::string includeFile = XML::getProperty(childNode, "file", std::string());
-
-            // check if file property was given
-            if (!includeFile.empty())
-            {
-                // build absolute path path
-                const ResourceManager::splittedPath splittedPath = ResourceManager::splitFileNameAndPath(filename);
-                const std::string realIncludeFile = ResourceManager::cleanPath(
-                        ResourceManager::joinPaths(splittedPath.path, includeFile));
-
-                // check if we're not entering a loop
-                if (mIncludedFiles.find(realIncludeFile) != mIncludedFiles.end())
-                {
-                    LOG_ERROR("Circular include loop detecting while including " << includeFile << " from " << filename);
-                }
-                else
-                {
-                    // include that file
-                    loadFile(realIncludeFile);
-                }
-            }
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "map"))
-        {
-            // map config
-            MapManager::readMapNode(childNode);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "attribute"))
-        {
-            // attribute config
-            attributeManager->readAttributeNode(childNode);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "ability"))
-        {
-            // ability config
-            abilityManager->readAbilityNode(childNode, filename);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "slot"))
-        {
-            // equipement slot config
-            itemManager->readEquipSlotNode(childNode);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "item"))
-        {
-            // item config
-            itemManager->readItemNode(childNode, filename);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "monster"))
-        {
-            // monster config
-            monsterManager->readMonsterNode(childNode, filename);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "emote"))
-        {
-            // emote config
-            emoteManager->readEmoteNode(childNode, filename);
-        }
-        else if (xmlStrEqual(childNode->name, BAD_CAST "status-effect"))
-        {
-            // status effects config
-            StatusManager::readStatusNode(childNode, filename);
-        }
+    GameData *data = new GameData;
+    std::string fixedSettings;
+
+    pack.visit([&] (xmlNodePtr node, const std::string &filename) {
+        if (isFixedSetting(node))
+            appendNode(fixedSettings, node);
         else
-        {
-            // since the client and server share settings, don't be too strict
-//            LOG_WARN("Unexpected tag <" << childNode->name << "> in " << filename);
-        }
+            data->readNode(node, filename);
+    });
+
+    if (fixedSettings != mFixedSettings)
+    {
+        LOG_WARN("Settings Manager: the attributes or maps changed, which "
+                 "takes a restart of the server.");
     }
 
-    // remove this file from include stack
-    mIncludedFiles.erase(filename);
+    data->checkStatus();
+    mReloadedData = data;
 }
 
 /**
- * Finalize the configuration loading and check if all managers are happy with it.
+ * Points every entity, whether on a map or not, at the game data in use.
  */
-void SettingsManager::checkStatus()
+void SettingsManager::rebindEntities()
 {
-    MapManager::checkStatus();
-    attributeManager->checkStatus();
-    abilityManager->checkStatus();
-    itemManager->checkStatus();
-    monsterManager->checkStatus();
-    emoteManager->checkStatus();
-    StatusManager::checkStatus();
+    // Rebinding may run scripts, which can create entities
+    std::vector<unsigned> ids;
+    forEachEntity([&] (Entity &entity) {
+        ids.push_back(entity.getId());
+    });
+
+    for (std::vector<unsigned>::const_iterator i = ids.begin(),
+         i_end = ids.end(); i != i_end; ++i)
+    {
+        if (Entity *entity = findEntity(*i))
+            mGameData->rebind(*entity);
+    }
+}
+
+/**
+ * Deletes the replaced versions of the game data no entity refers to.
+ */
+void SettingsManager::deleteRetiredData()
+{
+    std::vector<GameData *>::iterator it = mRetiredData.begin();
+    while (it != mRetiredData.end())
+    {
+        GameData *data = *it;
+        bool referenced = false;
+        forEachEntity([&] (const Entity &entity) {
+            referenced = referenced || data->isReferenced(entity);
+        });
+
+        if (referenced)
+        {
+            ++it;
+        }
+        else
+        {
+            delete data;
+            it = mRetiredData.erase(it);
+        }
+    }
 }
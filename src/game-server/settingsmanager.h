@@ -21,28 +21,64 @@
 #ifndef GAMESERVER_SETTINGSMANAGER_H_
 #define GAMESERVER_SETTINGSMANAGER_H_
 
+#include <atomic>
 #include <string>
-#include <list>
-#include <set>
+#include <thread>
+#include <vector>
+
+#include <libxml/tree.h>
+
+#include "game-server/timeout.h"
+
+class DataPack;
+class GameData;
 
 class SettingsManager
 {
     public:
-        SettingsManager(const std::string &settingsFile):
-			mSettingsFile(settingsFile)
-		{}
+        SettingsManager(const std::string &settingsFile);
+
+        ~SettingsManager();
+
+        void initialize();
+
+        /**
+         * Starts reading the game data again on a thread of its own. The
+         * new data is put in use by update() once it has been read.
+         *
+         * @return false when a reload is in progress already.
+         */
+        bool reload();
+
+        /**
+         * Puts reloaded game data in use, and deletes the previous versions
+         * once no entity refers to them. Called once per tick.
+         */
+        void update();
+
+    private:
+        bool loadData(DataPack &pack);
+
+        void readNode(xmlNodePtr node, const std::string &filename);
+
+        void reloadData();
+
+        void rebindEntities();
 
-		void initialize();
+        void deleteRetiredData();
 
-		void reload();
+        std::string mSettingsFile;
 
-	private:
-		std::string mSettingsFile;
-		std::set<std::string> mIncludedFiles;
+        /** The attribute and map settings, which are not reloaded. */
+        std::string mFixedSettings;
 
-		void loadFile(const std::string &filename);
+        GameData *mGameData;                /**< The data in use */
+        std::vector<GameData *> mRetiredData;  /**< Replaced data */
+        Timeout mRetiredDataCheck;
 
-		void checkStatus();
+        std::thread mReloadThread;
+        std::atomic<bool> mReloading;
+        std::atomic<GameData *> mReloadedData;
 };
 
 
@@ -57,7 +57,7 @@ void SpawnAreaComponent::update(Entity &entity)
             mZone.h = realMap->getHeight() * realMap->getTileHeight();
         }
 
-        // Find a free spawn location. Give up after 10 tries
+        // Find a free spawn location
         Point position;
         const int x = mZone.x;
         const int y = mZone.y;
@@ -71,7 +71,7 @@ void SpawnAreaComponent::update(Entity &entity)
         being->addComponent(beingComponent);
         being->addComponent(new MonsterComponent(*being, mSpecy));
 
-        auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_MAX_HP);
+        auto *hpAttribute = attributeManager->getCoreAttributes().maxHp;
         if (beingComponent->getModifiedAttribute(hpAttribute) <= 0)
         {
             LOG_WARN("Refusing to spawn dead monster " << mSpecy->getId());
@@ -81,19 +81,31 @@ void SpawnAreaComponent::update(Entity &entity)
 
         if (being)
         {
-            int triesLeft = 10;
-            do
-            {
-                position = Point(x + rand() % width, y + rand() % height);
-                triesLeft--;
-            }
-            while (!realMap->getWalk(position.x / realMap->getTileWidth(),
-                                     position.y / realMap->getTileHeight(),
-                                     actorComponent->getWalkMask())
-                   && triesLeft);
+            const int tileWidth = realMap->getTileWidth();
+            const int tileHeight = realMap->getTileHeight();
 
-            if (triesLeft)
+            // Tiles touched by the spawn zone
+            Rectangle tiles;
+            tiles.x = x / tileWidth;
+            tiles.y = y / tileHeight;
+            tiles.w = (x + width - 1) / tileWidth - tiles.x + 1;
+            tiles.h = (y + height - 1) / tileHeight - tiles.y + 1;
+
+            Point tile;
+            if (realMap->findRandomWalkableTile(tiles,
+                                                actorComponent->getWalkMask(),
+                                                tile))
             {
+                // Pick a position on the part of the tile inside the zone
+                const int left = std::max(x, tile.x * tileWidth);
+                const int top = std::max(y, tile.y * tileHeight);
+                const int right = std::min(x + width,
+                                           (tile.x + 1) * tileWidth);
+                const int bottom = std::min(y + height,
+                                            (tile.y + 1) * tileHeight);
+                position = Point(left + rand() % (right - left),
+                                 top + rand() % (bottom - top));
+
                 being->signal_removed.connect(
                             sigc::mem_fun(this, &SpawnAreaComponent::decrease));
 
@@ -48,6 +48,15 @@ class SpawnAreaComponent : public Component
          */
         void decrease(Entity *);
 
+        MonsterClass *getSpecy() const
+        { return mSpecy; }
+
+        /**
+         * Changes the type of the monsters spawned from now on.
+         */
+        void setSpecy(MonsterClass *specy)
+        { mSpecy = specy; }
+
     private:
         MonsterClass *mSpecy; /**< Specy of monster that spawns in this area. */
         Rectangle mZone;
@@ -23,6 +23,7 @@
 #include "common/configuration.h"
 #include "game-server/accountconnection.h"
 #include "game-server/effect.h"
+#include "game-server/flightrecorder.h"
 #include "game-server/gamehandler.h"
 #include "game-server/inventory.h"
 #include "game-server/item.h"
@@ -37,6 +38,8 @@
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
+#include "utils/profiler.h"
 #include "utils/speedconv.h"
 
 #include <cassert>
@@ -60,6 +63,12 @@ struct DelayedEvent
 
 typedef std::map< Entity *, DelayedEvent > DelayedEvents;
 
+/**
+ * Warps to maps that are still being loaded by this server. The characters
+ * stay where they are until the map is active.
+ */
+static DelayedEvents waitingWarps;
+
 /**
  * The current world time in ticks since server start.
  */
@@ -340,7 +349,7 @@ static void informPlayer(MapComposite *map, Entity *p)
             // We multiply the sent speed (in tiles per second) by ten
             // to get it within a byte with decimal precision.
             // For instance, a value of 4.5 will be sent as 45.
-            auto *tpsSpeedAttribute = attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_TPS);
+            auto *tpsSpeedAttribute = attributeManager->getCoreAttributes().moveSpeedTps;
             moveMsg.writeInt8((unsigned short)
                 (o->getComponent<BeingComponent>()
                         ->getModifiedAttribute(tpsSpeedAttribute) * 10));
@@ -378,10 +387,10 @@ static void informPlayer(MapComposite *map, Entity *p)
                 MessageOut healthMsg(GPMSG_BEING_HEALTH_CHANGE);
                 healthMsg.writeInt16(
                         c->getComponent<ActorComponent>()->getPublicID());
-                auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+                auto *hpAttribute = attributeManager->getCoreAttributes().hp;
                 healthMsg.writeInt16(
                         beingComponent->getModifiedAttribute(hpAttribute));
-                auto *maxHpAttribute = attributeManager->getAttributeInfo(ATTR_MAX_HP);
+                auto *maxHpAttribute = attributeManager->getCoreAttributes().maxHp;
                 healthMsg.writeInt16(
                         beingComponent->getModifiedAttribute(maxHpAttribute));
                 gameHandler->sendTo(p, healthMsg);
@@ -470,16 +479,45 @@ static void informPlayer(MapComposite *map, Entity *p)
 static bool dbgLockObjects;
 #endif
 
+static Metrics::Histogram &getPhaseHistogram(const char *phase)
+{
+    return Metrics::histogram("manaserv_tick_phase_seconds",
+                              "Time spent in each phase of a world tick.",
+                              std::string("phase=\"") + phase + "\"", 1e-6);
+}
+
 void GameState::update(int tick)
 {
+    static Metrics::Histogram &scriptTime = getPhaseHistogram("scripts");
+    static Metrics::Histogram &mapUpdateTime = getPhaseHistogram("map_update");
+    static Metrics::Histogram &moveTime = getPhaseHistogram("move");
+    static Metrics::Histogram &informTime = getPhaseHistogram("inform");
+    static Metrics::Histogram &delayedEventTime =
+            getPhaseHistogram("delayed_events");
+    static Metrics::Gauge &delayedEventCount =
+            Metrics::gauge("manaserv_delayed_events",
+                           "Events waiting for the end of the tick.");
+
     currentTick = tick;
 
 #ifndef NDEBUG
     dbgLockObjects = true;
 #endif
 
+    Profiler::setPhase("scripts");
+    const uint64_t scriptStart = Metrics::now();
     ScriptManager::currentState()->update();
 
+    const uint64_t scriptDuration = Metrics::now() - scriptStart;
+    scriptTime.record(scriptDuration);
+    FlightRecorder::addPhaseTime(FlightRecorder::PHASE_SCRIPTS,
+                                 scriptDuration);
+
+    // The phases are timed over all the maps
+    uint64_t updateDuration = 0;
+    uint64_t moveDuration = 0;
+    uint64_t informDuration = 0;
+
     // Update game state (update AI, etc.)
     const MapManager::Maps &maps = MapManager::getMaps();
     for (MapManager::Maps::const_iterator m = maps.begin(),
@@ -489,8 +527,16 @@ void GameState::update(int tick)
         if (!map->isActive())
             continue;
 
+        Profiler::setPhase("map_update");
+        const uint64_t start = Metrics::now();
         map->update();
 
+        Profiler::setPhase("move");
+        const uint64_t updated = Metrics::now();
+        map->move();
+
+        Profiler::setPhase("inform");
+        const uint64_t moved = Metrics::now();
         for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
         {
             informPlayer(map, *p);
@@ -505,12 +551,44 @@ void GameState::update(int tick)
                 a->getComponent<BeingComponent>()->clearHitsTaken();
             }
         }
+
+        const uint64_t informed = Metrics::now();
+        updateDuration += updated - start;
+        moveDuration += moved - updated;
+        informDuration += informed - moved;
+        FlightRecorder::noteMap(map, informed - start);
     }
 
+    mapUpdateTime.record(updateDuration);
+    moveTime.record(moveDuration);
+    informTime.record(informDuration);
+    FlightRecorder::addPhaseTime(FlightRecorder::PHASE_MAP_UPDATE,
+                                 updateDuration);
+    FlightRecorder::addPhaseTime(FlightRecorder::PHASE_MOVE, moveDuration);
+    FlightRecorder::addPhaseTime(FlightRecorder::PHASE_INFORM, informDuration);
+
 #   ifndef NDEBUG
     dbgLockObjects = false;
 #   endif
 
+    // The warps waiting for a map that got activated can go on, unless
+    // something else happened to the character meanwhile
+    for (DelayedEvents::iterator it = waitingWarps.begin();
+         it != waitingWarps.end();)
+    {
+        if (MapManager::isActivating(it->second.map->getID()))
+        {
+            ++it;
+            continue;
+        }
+        delayedEvents.insert(*it);
+        waitingWarps.erase(it++);
+    }
+
+    delayedEventCount.set(delayedEvents.size());
+    Profiler::setPhase("delayed_events");
+    const uint64_t delayedEventStart = Metrics::now();
+
     // Take care of events that were delayed because of their side effects.
     for (DelayedEvents::iterator it = delayedEvents.begin(),
          it_end = delayedEvents.end(); it != it_end; ++it)
@@ -535,11 +613,19 @@ void GameState::update(int tick)
 
             case EVENT_WARP:
                 assert(o->getType() == OBJECT_CHARACTER);
-                warp(o, e.map, e.point);
+                if (MapManager::isActivating(e.map->getID()))
+                    waitingWarps[o] = e;
+                else
+                    warp(o, e.map, e.point);
                 break;
         }
     }
     delayedEvents.clear();
+
+    const uint64_t delayedEventDuration = Metrics::now() - delayedEventStart;
+    delayedEventTime.record(delayedEventDuration);
+    FlightRecorder::addPhaseTime(FlightRecorder::PHASE_DELAYED_EVENTS,
+                                 delayedEventDuration);
 }
 
 bool GameState::insert(Entity *ptr)
@@ -656,6 +742,7 @@ void GameState::remove(Entity *ptr)
     int visualRange = Configuration::getValue("game_visualRange", 448);
 
     ptr->signal_removed.emit(ptr);
+    waitingWarps.erase(ptr);
 
     // DEBUG INFO
     switch (ptr->getType())
@@ -786,6 +873,9 @@ void GameState::warp(Entity *ptr, MapComposite *map, const Point &point)
  */
 static void enqueueEvent(Entity *ptr, const DelayedEvent &e)
 {
+    // A new event replaces a warp waiting for its map
+    waitingWarps.erase(ptr);
+
     std::pair< DelayedEvents::iterator, bool > p =
         delayedEvents.insert(std::make_pair(ptr, e));
     // Delete events take precedence over other events.
@@ -39,6 +39,13 @@ class StatusEffect
         void setTickCallback(Script *script)
         { script->assignCallback(mTickCallback); }
 
+        /**
+         * Takes over the callbacks scripts set on another version of this
+         * status effect, after the game data was reloaded.
+         */
+        void copyCallbacks(const StatusEffect &other)
+        { mTickCallback = other.mTickCallback; }
+
     private:
         int mId;
         Script::Ref mTickCallback;
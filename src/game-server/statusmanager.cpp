@@ -25,14 +25,9 @@
 #include "utils/logger.h"
 #include "utils/xml.h"
 
-#include <map>
 #include <set>
 #include <sstream>
 
-typedef std::map< int, StatusEffect * > StatusEffectsMap;
-static StatusEffectsMap statusEffects;
-static utils::NameMap<StatusEffect*> statusEffectsByName;
-
 void StatusManager::initialize()
 {
 
@@ -45,24 +40,23 @@ void StatusManager::reload()
 
 void StatusManager::deinitialize()
 {
-    for (StatusEffectsMap::iterator i = statusEffects.begin(),
-           i_end = statusEffects.end(); i != i_end; ++i)
+    for (StatusEffectsMap::const_iterator i = mStatusEffects.begin(),
+           i_end = mStatusEffects.end(); i != i_end; ++i)
     {
         delete i->second;
     }
-    statusEffects.clear();
-    statusEffectsByName.clear();
+    mStatusEffects.clear();
+    mStatusEffectsByName.clear();
 }
 
-StatusEffect *StatusManager::getStatus(int statusId)
+StatusEffect *StatusManager::getStatus(int statusId) const
 {
-    StatusEffectsMap::const_iterator i = statusEffects.find(statusId);
-    return i != statusEffects.end() ? i->second : 0;
+    return mStatusEffects.value(statusId);
 }
 
-StatusEffect *StatusManager::getStatusByName(const std::string &name)
+StatusEffect *StatusManager::getStatusByName(const std::string &name) const
 {
-    return statusEffectsByName.value(name);
+    return mStatusEffectsByName.value(name);
 }
 
 /**
@@ -86,14 +80,14 @@ void StatusManager::readStatusNode(xmlNodePtr node, const std::string &filename)
                                               std::string());
     if (!name.empty())
     {
-        if (statusEffectsByName.contains(name))
+        if (mStatusEffectsByName.contains(name))
         {
             LOG_WARN("StatusManager: name not unique for status effect "
                      << id);
         }
         else
         {
-            statusEffectsByName.insert(name, statusEffect);
+            mStatusEffectsByName.insert(name, statusEffect);
         }
     }
 
@@ -111,8 +105,18 @@ void StatusManager::readStatusNode(xmlNodePtr node, const std::string &filename)
     modifiers.setAttributeValue(CHAR_ATTR_WILLPOWER,    XML::getProperty(node, "willpower",    0));
 */
 
-    statusEffects[id] = statusEffect;
+    mStatusEffects.insert(id, statusEffect);
+
+}
 
+void StatusManager::copyCallbacks(const StatusManager &other)
+{
+    for (StatusEffectsMap::const_iterator i = mStatusEffects.begin(),
+         i_end = mStatusEffects.end(); i != i_end; ++i)
+    {
+        if (StatusEffect *otherStatus = other.getStatus(i->first))
+            i->second->copyCallbacks(*otherStatus);
+    }
 }
 
 /**
@@ -120,6 +124,6 @@ void StatusManager::readStatusNode(xmlNodePtr node, const std::string &filename)
  */
 void StatusManager::checkStatus()
 {
-    LOG_INFO("Loaded " << statusEffects.size() << " status effects");
+    LOG_INFO("Loaded " << mStatusEffects.size() << " status effects");
 }
 
@@ -22,40 +22,63 @@
 #define STATUSMANAGER_H
 
 #include <string>
+
+#include "utils/idregistry.h"
+#include "utils/string.h"
 #include "utils/xml.h"
 
 class StatusEffect;
 
-namespace StatusManager
+class StatusManager
 {
-    /**
-     * Loads status reference file.
-     */
-    void initialize();
-
-    /**
-     * Reloads status reference file.
-     */
-    void reload();
-
-    /**
-     * Destroy status classes.
-     */
-    void deinitialize();
-
-    /**
-     * Gets the status having the given ID.
-     */
-    StatusEffect *getStatus(int statusId);
-
-    /**
-     * Gets the status having the given name.
-     */
-    StatusEffect *getStatusByName(const std::string &name);
-
-    void readStatusNode(xmlNodePtr node, const std::string &filename);
-
-    void checkStatus();
-}
+    public:
+        StatusManager()
+        {}
+
+        ~StatusManager()
+        { deinitialize(); }
+
+        /**
+         * Loads status reference file.
+         */
+        void initialize();
+
+        /**
+         * Reloads status reference file.
+         */
+        void reload();
+
+        /**
+         * Destroy status classes.
+         */
+        void deinitialize();
+
+        /**
+         * Gets the status having the given ID.
+         */
+        StatusEffect *getStatus(int statusId) const;
+
+        /**
+         * Gets the status having the given name.
+         */
+        StatusEffect *getStatusByName(const std::string &name) const;
+
+        void readStatusNode(xmlNodePtr node, const std::string &filename);
+
+        void checkStatus();
+
+        /**
+         * Takes over the script callbacks of the status effects with the same ID
+         * in another manager, after the game data was reloaded.
+         */
+        void copyCallbacks(const StatusManager &other);
+
+    private:
+        typedef utils::IdRegistry< StatusEffect * > StatusEffectsMap;
+        StatusEffectsMap mStatusEffects;
+        utils::NameMap<StatusEffect*> mStatusEffectsByName;
+};
+
+extern StatusManager *statusManager;
 
 #endif // STATUSMANAGER_H
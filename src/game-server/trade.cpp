@@ -43,7 +43,7 @@ Trade::Trade(Entity *c1, Entity *c2)
     , mMoney1(0)
     , mMoney2(0)
     , mState(TRADE_INIT)
-    , mCurrencyAttribute(attributeManager->getAttributeInfo(ATTR_GP))
+    , mCurrencyAttribute(attributeManager->getCoreAttributes().gp)
 {
     MessageOut msg(GPMSG_TRADE_REQUEST);
     msg.writeInt16(c1->getComponent<ActorComponent>()->getPublicID());
@@ -20,59 +20,48 @@
 
 #include "bandwidth.h"
 
-#include "netcomputer.h"
+static Metrics::Counter &getTrafficCounter(const char *peer,
+                                           const char *direction)
+{
+    return Metrics::counter("manaserv_network_bytes_total",
+                            "Bytes of messages sent and received.",
+                            std::string("peer=\"") + peer +
+                            "\",direction=\"" + direction + "\"");
+}
 
 BandwidthMonitor::BandwidthMonitor():
     mAmountServerOutput(0),
     mAmountServerInput(0),
     mAmountClientOutput(0),
-    mAmountClientInput(0)
+    mAmountClientInput(0),
+    mServerOutputMetric(getTrafficCounter("server", "out")),
+    mServerInputMetric(getTrafficCounter("server", "in")),
+    mClientOutputMetric(getTrafficCounter("client", "out")),
+    mClientInputMetric(getTrafficCounter("client", "in"))
 {
 }
 
 void BandwidthMonitor::increaseInterServerOutput(int size)
 {
     mAmountServerOutput += size;
+    mServerOutputMetric.increment(size);
 }
 
 void BandwidthMonitor::increaseInterServerInput(int size)
 {
     mAmountServerInput += size;
+    mServerInputMetric.increment(size);
 }
 
-void BandwidthMonitor::increaseClientOutput(NetComputer *nc, int size)
+void BandwidthMonitor::increaseClientOutput(int size)
 {
     mAmountClientOutput += size;
-    // look for an existing client stored
-    ClientBandwidth::iterator itr = mClientBandwidth.find(nc);
-
-    // if there isnt one, create one
-    if (itr == mClientBandwidth.end())
-    {
-        std::pair<ClientBandwidth::iterator, bool> retItr;
-        retItr = mClientBandwidth.insert(std::pair<NetComputer*, std::pair<int, int> >(nc, std::pair<int, int>(0, 0)));
-        itr = retItr.first;
-    }
-
-    itr->second.first += size;
-
+    mClientOutputMetric.increment(size);
 }
 
-void BandwidthMonitor::increaseClientInput(NetComputer *nc, int size)
+void BandwidthMonitor::increaseClientInput(int size)
 {
     mAmountClientInput += size;
-
-    // look for an existing client stored
-    ClientBandwidth::iterator itr = mClientBandwidth.find(nc);
-
-    // if there isnt one, create it
-    if (itr == mClientBandwidth.end())
-    {
-        std::pair<ClientBandwidth::iterator, bool> retItr;
-        retItr = mClientBandwidth.insert(std::pair<NetComputer*, std::pair<int, int> >(nc, std::pair<int, int>(0, 0)));
-        itr = retItr.first;
-    }
-
-    itr->second.second += size;
+    mClientInputMetric.increment(size);
 }
 
@@ -21,9 +21,7 @@
 #ifndef BANDWIDTH_H
 #define BANDWIDTH_H
 
-#include <map>
-
-class NetComputer;
+#include "utils/metrics.h"
 
 class BandwidthMonitor
 {
@@ -31,8 +29,8 @@ public:
     BandwidthMonitor();
     void increaseInterServerOutput(int size);
     void increaseInterServerInput(int size);
-    void increaseClientOutput(NetComputer *nc, int size);
-    void increaseClientInput(NetComputer *nc, int size);
+    void increaseClientOutput(int size);
+    void increaseClientInput(int size);
     int totalInterServerOut() const { return mAmountServerOutput; }
     int totalInterServerIn() const { return mAmountServerInput; }
     int totalClientOut() const { return mAmountClientOutput; }
@@ -43,9 +41,10 @@ private:
     int mAmountServerInput;
     int mAmountClientOutput;
     int mAmountClientInput;
-    // map of client to output and input
-    typedef std::map<NetComputer*, std::pair<int, int> > ClientBandwidth;
-    ClientBandwidth mClientBandwidth;
+    Metrics::Counter &mServerOutputMetric;
+    Metrics::Counter &mServerInputMetric;
+    Metrics::Counter &mClientOutputMetric;
+    Metrics::Counter &mClientInputMetric;
 };
 
 extern BandwidthMonitor *gBandwidth;
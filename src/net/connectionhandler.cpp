@@ -28,6 +28,9 @@
 #include "net/messageout.h"
 #include "net/netcomputer.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
+
+#include <sstream>
 
 #ifdef ENET_VERSION_CREATE
 #define ENET_CUTOFF ENET_VERSION_CREATE(1,3,0)
@@ -35,6 +38,30 @@
 #define ENET_CUTOFF 0xFFFFFFFF
 #endif
 
+/** Number of clients whose traffic is exported in the metrics */
+static const unsigned EXPORTED_TOP_TALKERS = 5;
+
+/** Time between two samples of the traffic, in microseconds */
+static const uint64_t TRAFFIC_SAMPLE_INTERVAL = 1000000;
+
+static double getRate(const NetComputer *computer)
+{
+    const TrafficStats &traffic = computer->getTraffic();
+    return traffic.getInputRate() + traffic.getOutputRate();
+}
+
+static bool talksMore(const NetComputer *a, const NetComputer *b)
+{
+    return getRate(a) > getRate(b);
+}
+
+ConnectionHandler::ConnectionHandler():
+    host(0),
+    mLastTrafficSample(0),
+    mMessageRejected(false)
+{
+}
+
 bool ConnectionHandler::startListen(enet_uint16 port,
                                     const std::string &listenHost)
 {
@@ -93,6 +120,13 @@ void ConnectionHandler::flush()
 
 void ConnectionHandler::process(enet_uint32 timeout)
 {
+    const uint64_t now = Metrics::now();
+    if (now - mLastTrafficSample >= TRAFFIC_SAMPLE_INTERVAL)
+    {
+        mLastTrafficSample = now;
+        sampleTraffic();
+    }
+
     ENetEvent event;
     // Process Enet events and do not block.
     while (enet_host_service(host, &event, timeout) > 0) {
@@ -124,9 +158,16 @@ void ConnectionHandler::process(enet_uint32 timeout)
                     LOG_DEBUG("Received message " << msg << " from "
                               << *comp);
 
-                    gBandwidth->increaseClientInput(comp, event.packet->dataLength);
+                    gBandwidth->increaseClientInput(event.packet->dataLength);
 
+                    mMessageRejected = false;
                     processMessage(comp, msg);
+
+                    // Only the IDs of handled messages get a slot of their own
+                    comp->getTraffic().addInput(
+                            mMessageRejected ? TrafficStats::UNKNOWN_MESSAGE
+                                             : msg.getId(),
+                            event.packet->dataLength);
                 } else {
                     LOG_ERROR("Message too short from " << *comp);
                 }
@@ -166,3 +207,45 @@ unsigned ConnectionHandler::getClientCount() const
 {
     return clients.size();
 }
+
+std::vector<NetComputer *>
+ConnectionHandler::getTopTalkers(unsigned count) const
+{
+    std::vector<NetComputer *> talkers(clients.begin(), clients.end());
+    count = std::min<unsigned>(count, talkers.size());
+    std::partial_sort(talkers.begin(), talkers.begin() + count, talkers.end(),
+                      talksMore);
+    talkers.resize(count);
+    return talkers;
+}
+
+void ConnectionHandler::sampleTraffic()
+{
+    for (NetComputers::iterator i = clients.begin(), i_end = clients.end();
+         i != i_end; ++i)
+    {
+        (*i)->getTraffic().sample();
+    }
+
+    if (mTopTalkerGauges.empty())
+    {
+        for (unsigned rank = 1; rank <= EXPORTED_TOP_TALKERS; ++rank)
+        {
+            std::ostringstream labels;
+            labels << "port=\"" << address.port << "\",rank=\"" << rank
+                   << "\"";
+            mTopTalkerGauges.push_back(&Metrics::gauge(
+                    "manaserv_top_talker_bytes_per_second",
+                    "Bytes per second exchanged with the clients exchanging "
+                    "the most, by rank.", labels.str()));
+        }
+    }
+
+    const std::vector<NetComputer *> talkers =
+            getTopTalkers(EXPORTED_TOP_TALKERS);
+    for (unsigned i = 0; i < EXPORTED_TOP_TALKERS; ++i)
+    {
+        mTopTalkerGauges[i]->set(i < talkers.size() ?
+                                 int64_t(getRate(talkers[i])) : 0);
+    }
+}
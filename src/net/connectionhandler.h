@@ -23,12 +23,19 @@
 
 #include <list>
 #include <string>
+#include <vector>
 #include <enet/enet.h>
+#include <stdint.h>
 
 class MessageIn;
 class MessageOut;
 class NetComputer;
 
+namespace Metrics
+{
+    class Gauge;
+}
+
 /**
  * This class represents the connection handler interface. The connection
  * handler will respond to connect/reconnect/disconnect events and handle
@@ -37,6 +44,8 @@ class NetComputer;
 class ConnectionHandler
 {
     public:
+        ConnectionHandler();
+
         virtual ~ConnectionHandler() {}
 
         /**
@@ -81,9 +90,26 @@ class ConnectionHandler
          */
         unsigned getClientCount() const;
 
+        /**
+         * Returns at most the given number of clients, those exchanging the
+         * most bytes per second first.
+         */
+        std::vector<NetComputer *> getTopTalkers(unsigned count) const;
+
     private:
+        /**
+         * Samples the traffic of every client, and exports the rates of the
+         * top talkers.
+         */
+        void sampleTraffic();
+
         ENetAddress address;      /**< Includes the port to listen to. */
         ENetHost *host;           /**< The host that listen for connections. */
+        uint64_t mLastTrafficSample;
+        std::vector<Metrics::Gauge *> mTopTalkerGauges;
+
+        /** Whether the message being processed was rejected. */
+        bool mMessageRejected;
 
     protected:
         /**
@@ -110,6 +136,15 @@ class ConnectionHandler
          */
         virtual void processMessage(NetComputer *, MessageIn &) = 0;
 
+        /**
+         * Tells that the message being processed is not handled, in the
+         * state of its sender at least. Its ID is then counted as unknown
+         * in the traffic of the computer, so that clients can't make up
+         * message IDs that would be tracked separately.
+         */
+        void rejectMessage()
+        { mMessageRejected = true; }
+
         typedef std::list<NetComputer*> NetComputers;
         /**
          * A list of pointers to the client structures created by
@@ -24,9 +24,6 @@
 #include <iostream>
 #include <string>
 #include <enet/enet.h>
-#ifndef USE_NATIVE_DOUBLE
-#include <sstream>
-#endif
 #include <stdint.h>
 
 #include "net/messagein.h"
@@ -133,13 +130,33 @@ double MessageIn::readDouble()
         memcpy(&value, mData + mPos, sizeof(double));
     mPos += sizeof(double);
 #else
-    int length = readInt8();
-    std::istringstream i (readString(length));
-    i >> value;
+    if (mPos + 8 <= mLength)
+    {
+        uint32_t high, low;
+        memcpy(&high, mData + mPos, 4);
+        memcpy(&low, mData + mPos + 4, 4);
+        const uint64_t bits = uint64_t(ENET_NET_TO_HOST_32(high)) << 32 |
+                              ENET_NET_TO_HOST_32(low);
+        memcpy(&value, &bits, sizeof(value));
+    }
+    mPos += 8;
 #endif
     return value;
 }
 
+std::string MessageIn::readBytes(int length)
+{
+    if (length < 0 || mPos + length > mLength)
+    {
+        mPos = mLength + 1;
+        return std::string();
+    }
+
+    std::string bytes(mData + mPos, length);
+    mPos += length;
+    return bytes;
+}
+
 std::string MessageIn::readString(int length)
 {
     if (!readValueType(ManaServ::String))
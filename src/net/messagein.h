@@ -54,11 +54,16 @@ class MessageIn
         int readInt32();            /**< Reads a long. */
 
         /**
-         * Reads a double. HACKY and should *not* be used for client
-         * communication!
+         * Reads a double written by MessageOut::writeDouble. Should *not*
+         * be used for client communication!
          */
         double readDouble();
 
+        /**
+         * Reads the given number of bytes written by MessageOut::writeBytes.
+         */
+        std::string readBytes(int length);
+
         /**
          * Reads a string. If a length is not given (-1), it is assumed
          * that the length of the string is stored in a short at the
@@ -24,10 +24,6 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
-#ifndef USE_NATIVE_DOUBLE
-#include <limits>
-#include <sstream>
-#endif
 #include <stdint.h>
 #include <string>
 #include <enet/enet.h>
@@ -41,6 +37,7 @@ const unsigned CAPACITY_GROW_FACTOR = 2;
 static bool debugModeEnabled = false;
 
 MessageOut::MessageOut(int id):
+    mId(id),
     mPos(0),
     mDebugMode(false)
 {
@@ -115,18 +112,26 @@ void MessageOut::writeDouble(double value)
     memcpy(mData + mPos, &value, sizeof(double));
     mPos += sizeof(double);
 #else
-// Rather inefficient, but I don't have a lot of time.
-// If anyone wants to implement a custom double you are more than welcome to.
-    std::ostringstream o;
-    // Highest precision for double
-    o.precision(std::numeric_limits< double >::digits10);
-    o << value;
-    std::string str = o.str();
-    writeInt8(str.size());
-    writeString(str, str.size());
+    // The IEEE 754 representation in network byte order, high word first
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    expand(mPos + 8);
+    uint32_t t = ENET_HOST_TO_NET_32(uint32_t(bits >> 32));
+    memcpy(mData + mPos, &t, 4);
+    t = ENET_HOST_TO_NET_32(uint32_t(bits));
+    memcpy(mData + mPos + 4, &t, 4);
+    mPos += 8;
 #endif
 }
 
+void MessageOut::writeBytes(const char *data, int length)
+{
+    expand(mPos + length);
+    memcpy(mData + mPos, data, length);
+    mPos += length;
+}
+
 void MessageOut::writeString(const std::string &string, int length)
 {
     if (mDebugMode)
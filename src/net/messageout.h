@@ -56,17 +56,28 @@ class MessageOut
         void writeInt32(int value);
 
         /**
-         * Writes a double. HACKY and should *not* be used for client
-         * communication!
+         * Writes a double as its 8-byte IEEE 754 representation. Should
+         * *not* be used for client communication!
          */
         void writeDouble(double value);
 
+        /**
+         * Writes the given bytes as they are, without any length or
+         * debugging information.
+         */
+        void writeBytes(const char *data, int length);
+
         /**
          * Writes a string. If a fixed length is not given (-1), it is stored
          * as a short at the start of the string.
          */
         void writeString(const std::string &string, int length = -1);
 
+        /**
+         * Returns the message ID, without the debug flag.
+         */
+        int getId() const { return mId; }
+
         /**
          * Returns the content of the message.
          */
@@ -95,6 +106,7 @@ class MessageOut
 
         void writeValueType(ManaServ::ValueType type);
 
+        unsigned short mId;         /**< The message ID. */
         char *mData;                /**< Data building up. */
         unsigned mPos;              /**< Position in the data. */
         unsigned mDataSize;         /**< Allocated datasize. */
@@ -0,0 +1,237 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/metricsserver.h"
+
+#include "utils/logger.h"
+#include "utils/metrics.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+/**
+ * How long the thread waits for a connection before checking whether it
+ * should stop, and for a client to send its request, in milliseconds.
+ */
+static const int POLL_TIMEOUT = 500;
+static const int REQUEST_TIMEOUT = 1000;
+
+MetricsServer::MetricsServer():
+    mSocket(-1),
+    mRunning(false)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+#ifdef _WIN32
+
+bool MetricsServer::start(int port, const std::string &socketPath)
+{
+    if (port > 0 || !socketPath.empty())
+        LOG_WARN("Metrics: the metrics endpoint is not available on Windows.");
+    return port <= 0 && socketPath.empty();
+}
+
+void MetricsServer::stop()
+{
+}
+
+void MetricsServer::run()
+{
+}
+
+void MetricsServer::answer(int)
+{
+}
+
+#else
+
+bool MetricsServer::start(int port, const std::string &socketPath)
+{
+    if (port <= 0 && socketPath.empty())
+        return true;
+
+    if (!socketPath.empty())
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            LOG_ERROR("Metrics: socket path too long: " << socketPath);
+            return false;
+        }
+        std::strcpy(address.sun_path, socketPath.c_str());
+
+        // A socket left behind by a previous run prevents binding
+        unlink(socketPath.c_str());
+
+        mSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (mSocket < 0 ||
+            bind(mSocket, (sockaddr *) &address, sizeof(address)) < 0)
+        {
+            LOG_ERROR("Metrics: unable to bind " << socketPath << ": "
+                      << std::strerror(errno));
+            stop();
+            return false;
+        }
+        mSocketPath = socketPath;
+    }
+    else
+    {
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        mSocket = socket(AF_INET, SOCK_STREAM, 0);
+        const int reuse = 1;
+        if (mSocket >= 0)
+            setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR,
+                       &reuse, sizeof(reuse));
+
+        if (mSocket < 0 ||
+            bind(mSocket, (sockaddr *) &address, sizeof(address)) < 0)
+        {
+            LOG_ERROR("Metrics: unable to bind port " << port << ": "
+                      << std::strerror(errno));
+            stop();
+            return false;
+        }
+    }
+
+    if (listen(mSocket, 8) < 0)
+    {
+        LOG_ERROR("Metrics: unable to listen: " << std::strerror(errno));
+        stop();
+        return false;
+    }
+
+    LOG_INFO("Metrics: serving on "
+             << (mSocketPath.empty() ? "port " : "")
+             << (mSocketPath.empty() ? std::to_string(port) : mSocketPath));
+
+    mRunning = true;
+    mThread = std::thread(&MetricsServer::run, this);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    mRunning = false;
+    if (mThread.joinable())
+        mThread.join();
+
+    if (mSocket >= 0)
+    {
+        close(mSocket);
+        mSocket = -1;
+    }
+
+    if (!mSocketPath.empty())
+    {
+        unlink(mSocketPath.c_str());
+        mSocketPath.clear();
+    }
+}
+
+void MetricsServer::run()
+{
+    while (mRunning)
+    {
+        pollfd listener;
+        listener.fd = mSocket;
+        listener.events = POLLIN;
+        if (poll(&listener, 1, POLL_TIMEOUT) <= 0)
+            continue;
+
+        const int client = accept(mSocket, 0, 0);
+        if (client < 0)
+            continue;
+
+        answer(client);
+        close(client);
+    }
+}
+
+void MetricsServer::answer(int client)
+{
+    // Read the request up to the empty line ending its headers. What is
+    // asked for does not matter, there is only one thing to serve.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos &&
+           request.size() < 8 * sizeof(buffer))
+    {
+        pollfd input;
+        input.fd = client;
+        input.events = POLLIN;
+        if (poll(&input, 1, REQUEST_TIMEOUT) <= 0)
+            return;
+
+        const ssize_t length = recv(client, buffer, sizeof(buffer), 0);
+        if (length <= 0)
+            return;
+        request.append(buffer, length);
+    }
+
+    const std::string body = Metrics::format();
+
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n"
+             << "\r\n"
+             << body;
+
+    const std::string data = response.str();
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const ssize_t length = send(client, data.data() + sent,
+                                    data.size() - sent, MSG_NOSIGNAL);
+        if (length <= 0)
+            return;
+        sent += length;
+    }
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/**
+ * Answers every HTTP request with the metrics in the Prometheus text format.
+ *
+ * It runs on a thread of its own, so that the metrics can still be scraped
+ * while the main loop is stuck. It only listens on the loopback interface
+ * or on a Unix socket, the monitoring system is expected to run on the same
+ * machine or to go through a proxy.
+ */
+class MetricsServer
+{
+    public:
+        MetricsServer();
+
+        ~MetricsServer();
+
+        /**
+         * Starts listening on the given Unix socket, or on the given port of
+         * the loopback interface when no socket is given. Nothing is done
+         * when neither is given.
+         *
+         * @return false when the socket could not be opened.
+         */
+        bool start(int port, const std::string &socketPath);
+
+        void stop();
+
+    private:
+        MetricsServer(const MetricsServer &) = delete;
+        MetricsServer &operator=(const MetricsServer &) = delete;
+
+        void run();
+
+        void answer(int client);
+
+        int mSocket;
+        std::string mSocketPath;
+        std::thread mThread;
+        std::atomic<bool> mRunning;
+};
+
+#endif // METRICSSERVER_H
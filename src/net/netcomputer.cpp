@@ -61,7 +61,8 @@ void NetComputer::send(const MessageOut &msg, bool reliable,
 {
     LOG_DEBUG("Sending message " << msg << " to " << *this);
 
-    gBandwidth->increaseClientOutput(this, msg.getLength());
+    gBandwidth->increaseClientOutput(msg.getLength());
+    mTraffic.addOutput(msg.getId(), msg.getLength());
 
     ENetPacket *packet;
     packet = enet_packet_create(msg.getData(),
@@ -24,6 +24,8 @@
 #include <iostream>
 #include <enet/enet.h>
 
+#include "net/trafficstats.h"
+
 class MessageOut;
 
 /**
@@ -75,8 +77,32 @@ class NetComputer
          */
         int getIP() const;
 
+        /**
+         * Returns the traffic exchanged with this computer.
+         */
+        TrafficStats &getTraffic()
+        { return mTraffic; }
+
+        const TrafficStats &getTraffic() const
+        { return mTraffic; }
+
+        /**
+         * Returns the mean round trip time of reliable packets, as measured
+         * by ENet, in milliseconds.
+         */
+        unsigned getRoundTripTime() const
+        { return mPeer->roundTripTime; }
+
+        /**
+         * Returns the mean ratio of reliable packets lost, as measured by
+         * ENet.
+         */
+        double getPacketLoss() const
+        { return double(mPeer->packetLoss) / ENET_PEER_PACKET_LOSS_SCALE; }
+
     private:
         ENetPeer *mPeer;              /**< Client peer */
+        TrafficStats mTraffic;
 
         /**
          * Converts the ip-address of the peer to a stringstream.
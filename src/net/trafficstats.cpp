@@ -0,0 +1,157 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/trafficstats.h"
+
+#include "utils/idregistry.h"
+
+#include <algorithm>
+
+/**
+ * Number of message slots, well above the number of messages the protocol
+ * defines. Only messages sent by the server and messages a handler accepted
+ * are given one, so the limit only guards against a handler that accepts
+ * anything. The last slot holds the unknown messages.
+ */
+static const unsigned MAX_MESSAGE_SLOTS = 512;
+static const unsigned UNKNOWN_MESSAGE_SLOT = MAX_MESSAGE_SLOTS - 1;
+
+/** Slot of each message ID seen so far, plus one */
+static utils::IdRegistry<unsigned> messageSlots;
+static unsigned messageSlotCount = 0;
+
+static unsigned getMessageSlot(int messageId)
+{
+    if (messageId == TrafficStats::UNKNOWN_MESSAGE)
+        return UNKNOWN_MESSAGE_SLOT;
+
+    unsigned slot = messageSlots.value(messageId);
+    if (!slot)
+    {
+        if (messageSlotCount == UNKNOWN_MESSAGE_SLOT)
+            return UNKNOWN_MESSAGE_SLOT;
+
+        slot = ++messageSlotCount;
+        messageSlots.insert(messageId, slot);
+    }
+    return slot - 1;
+}
+
+static bool moreBytes(const TrafficStats::MessageTraffic &a,
+                      const TrafficStats::MessageTraffic &b)
+{
+    return a.bytesIn + a.bytesOut > b.bytesIn + b.bytesOut;
+}
+
+TrafficStats::TrafficStats():
+    mBytesIn(0),
+    mBytesOut(0),
+    mPacketsIn(0),
+    mPacketsOut(0),
+    mSampleCount(0),
+    mLastSample(0)
+{
+}
+
+TrafficStats::MessageTraffic &TrafficStats::getMessageTraffic(int messageId)
+{
+    const unsigned slot = getMessageSlot(messageId);
+    if (slot >= mMessages.size())
+        mMessages.resize(slot + 1);
+
+    MessageTraffic &traffic = mMessages[slot];
+    traffic.id = slot == UNKNOWN_MESSAGE_SLOT ? UNKNOWN_MESSAGE : messageId;
+    return traffic;
+}
+
+void TrafficStats::addInput(int messageId, unsigned bytes)
+{
+    mBytesIn += bytes;
+    ++mPacketsIn;
+
+    MessageTraffic &traffic = getMessageTraffic(messageId);
+    traffic.bytesIn += bytes;
+    ++traffic.packetsIn;
+}
+
+void TrafficStats::addOutput(int messageId, unsigned bytes)
+{
+    mBytesOut += bytes;
+    ++mPacketsOut;
+
+    MessageTraffic &traffic = getMessageTraffic(messageId);
+    traffic.bytesOut += bytes;
+    ++traffic.packetsOut;
+}
+
+void TrafficStats::sample()
+{
+    if (mSampleCount > 0)
+        mLastSample = (mLastSample + 1) % (RATE_WINDOW + 1);
+    if (mSampleCount < RATE_WINDOW + 1)
+        ++mSampleCount;
+
+    mSamplesIn[mLastSample] = mBytesIn;
+    mSamplesOut[mLastSample] = mBytesOut;
+}
+
+double TrafficStats::getRate(const uint64_t *samples) const
+{
+    if (mSampleCount < 2)
+        return 0;
+
+    const unsigned first =
+            (mLastSample + RATE_WINDOW + 2 - mSampleCount) % (RATE_WINDOW + 1);
+    return double(samples[mLastSample] - samples[first]) / (mSampleCount - 1);
+}
+
+double TrafficStats::getInputRate() const
+{
+    return getRate(mSamplesIn);
+}
+
+double TrafficStats::getOutputRate() const
+{
+    return getRate(mSamplesOut);
+}
+
+std::vector<TrafficStats::MessageTraffic>
+TrafficStats::getTopMessages(unsigned count) const
+{
+    std::vector<MessageTraffic> messages;
+    for (std::vector<MessageTraffic>::const_iterator it = mMessages.begin(),
+         it_end = mMessages.end(); it != it_end; ++it)
+    {
+        if (it->packetsIn || it->packetsOut)
+            messages.push_back(*it);
+    }
+
+    if (messages.size() > count)
+    {
+        std::partial_sort(messages.begin(), messages.begin() + count,
+                          messages.end(), moreBytes);
+        messages.resize(count);
+    }
+    else
+    {
+        std::sort(messages.begin(), messages.end(), moreBytes);
+    }
+    return messages;
+}
@@ -0,0 +1,106 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRAFFICSTATS_H
+#define TRAFFICSTATS_H
+
+#include <vector>
+#include <stdint.h>
+
+/**
+ * The traffic exchanged with one computer, in total and by message ID, along
+ * with its rate over the last few seconds.
+ *
+ * Message IDs are given a slot the first time they are seen by any
+ * computer, so that counting a message only takes indexing a vector.
+ * Received messages the handler rejected are counted together as
+ * UNKNOWN_MESSAGE, as are the IDs left without a slot once all are used.
+ */
+class TrafficStats
+{
+    public:
+        /** Number of one second samples the rates are computed over. */
+        static const unsigned RATE_WINDOW = 10;
+
+        /** ID of the traffic of the messages left without a slot. */
+        static const int UNKNOWN_MESSAGE = -1;
+
+        struct MessageTraffic
+        {
+            MessageTraffic():
+                id(0), packetsIn(0), packetsOut(0), bytesIn(0), bytesOut(0)
+            {}
+
+            int id;
+            unsigned packetsIn;
+            unsigned packetsOut;
+            uint64_t bytesIn;
+            uint64_t bytesOut;
+        };
+
+        TrafficStats();
+
+        void addInput(int messageId, unsigned bytes);
+        void addOutput(int messageId, unsigned bytes);
+
+        /**
+         * Remembers the current totals, for computing the rates. Meant to
+         * be called about once per second.
+         */
+        void sample();
+
+        uint64_t getBytesIn() const { return mBytesIn; }
+        uint64_t getBytesOut() const { return mBytesOut; }
+        unsigned getPacketsIn() const { return mPacketsIn; }
+        unsigned getPacketsOut() const { return mPacketsOut; }
+
+        /**
+         * Returns the bytes per second received or sent over the last
+         * RATE_WINDOW samples.
+         */
+        double getInputRate() const;
+        double getOutputRate() const;
+
+        /**
+         * Returns the traffic of at most the given number of message IDs,
+         * those with the most bytes received and sent first.
+         */
+        std::vector<MessageTraffic> getTopMessages(unsigned count) const;
+
+    private:
+        MessageTraffic &getMessageTraffic(int messageId);
+
+        double getRate(const uint64_t *samples) const;
+
+        uint64_t mBytesIn;
+        uint64_t mBytesOut;
+        unsigned mPacketsIn;
+        unsigned mPacketsOut;
+
+        /** Totals at the last samples, a ring buffer. */
+        uint64_t mSamplesIn[RATE_WINDOW + 1];
+        uint64_t mSamplesOut[RATE_WINDOW + 1];
+        unsigned mSampleCount;
+        unsigned mLastSample;
+
+        std::vector<MessageTraffic> mMessages;  /**< By message slot */
+};
+
+#endif // TRAFFICSTATS_H
@@ -284,9 +284,9 @@ static int npc_create(lua_State *s)
     npc->addComponent(beingComponent);
     npc->addComponent(npcComponent);
     // some health so it doesn't spawn dead
-    auto *maxHpAttribute = attributeManager->getAttributeInfo(ATTR_MAX_HP);
+    auto *maxHpAttribute = attributeManager->getCoreAttributes().maxHp;
     beingComponent->setAttribute(*npc, maxHpAttribute, 100);
-    auto *hpAttribute = attributeManager->getAttributeInfo(ATTR_HP);
+    auto *hpAttribute = attributeManager->getCoreAttributes().hp;
     beingComponent->setAttribute(*npc, hpAttribute, 100);
     beingComponent->setName(name);
     beingComponent->setGender(getGender(gender));
@@ -1010,6 +1010,9 @@ static int entity_get_inventory(lua_State *s)
 {
     Entity *q = checkCharacter(s, 1);
 
+    // Drops the items the reloaded game data doesn't know anymore
+    Inventory(q).updateItemEffects();
+
     // Create a lua table with the inventory ids.
     const InventoryData invData = q->getComponent<CharacterComponent>()
             ->getPossessions().getInventory();
@@ -1081,6 +1084,9 @@ static int entity_get_equipment(lua_State *s)
 {
     Entity *q = checkCharacter(s, 1);
 
+    // Drops the items the reloaded game data doesn't know anymore
+    Inventory(q).updateItemEffects();
+
     // Create a lua table with the inventory ids.
     auto *characterComponent = q->getComponent<CharacterComponent>();
     const InventoryData inventoryData =
@@ -1214,9 +1220,8 @@ static int entity_unequip_item(lua_State *s)
 /** LUA chr_get_quest (being)
  * chr_get_quest(handle character, string name)
  **
- * **Return value:** The quest variable named `name` for the given character.
- *
- * **Warning:** May only be called from an NPC talk function.
+ * **Return value:** The quest variable named `name` for the given character,
+ * an empty string if it was never set.
  *
  */
 static int chr_get_quest(lua_State *s)
@@ -1225,21 +1230,8 @@ static int chr_get_quest(lua_State *s)
     const char *name = luaL_checkstring(s, 2);
     luaL_argcheck(s, name[0] != 0, 2, "empty variable name");
 
-    Script::Thread *thread = checkCurrentThread(s);
-
-    std::string value;
-    bool res = getQuestVar(q, name, value);
-    if (res)
-    {
-        push(s, value);
-        return 1;
-    }
-    QuestCallback *f = new QuestThreadCallback(&LuaScript::getQuestCallback,
-                                               getScript(s));
-    recoverQuestVar(q, name, f);
-
-    thread->mState = Script::ThreadExpectingString;
-    return lua_yield(s, 0);
+    push(s, getQuestVar(q, name));
+    return 1;
 }
 
 /** LUA chr_set_quest (being)
@@ -1350,7 +1342,7 @@ static int entity_walk(lua_State *s)
     if (lua_gettop(s) >= 4)
     {
         const double speedTps = luaL_checknumber(s, 4);
-        auto *tpsSpeedAttribute = attributeManager->getAttributeInfo(ATTR_MOVE_SPEED_TPS);
+        auto *tpsSpeedAttribute = attributeManager->getCoreAttributes().moveSpeedTps;
         beingComponent->setAttribute(*being, tpsSpeedAttribute, speedTps);
     }
 
@@ -1627,8 +1619,9 @@ static int entity_warp(lua_State *s)
 
     Map *map = m->getMap();
 
-    // If the wanted warp place is unwalkable
-    if (!map->getWalk(x / map->getTileWidth(), y / map->getTileHeight()))
+    // If the wanted warp place is unwalkable. Maps that are not active on
+    // this server are not read, the place is checked by the other server.
+    if (map && !map->getWalk(x / map->getTileWidth(), y / map->getTileHeight()))
     {
         int c = 50;
         LOG_INFO("warp called with a non-walkable place.");
@@ -2088,9 +2081,10 @@ static int entity_get_mapid(lua_State *s)
 /** LUA chr_request_quest (being)
  * chr_request_quest(handle character, string questvariable, Ref function)
  **
- * Requests the questvar from the account server. This will make it available in
- * the quest cache after some time. The passed function will be called back as
- * soon the quest var is available.
+ * Calls the passed function with the character, the name of the quest variable
+ * and its value. The quest variables are always known by the game server, so
+ * this happens immediately. Kept for the scripts written when they had to be
+ * requested from the account server.
  */
 static int chr_request_quest(lua_State *s)
 {
@@ -2099,26 +2093,15 @@ static int chr_request_quest(lua_State *s)
     luaL_argcheck(s, name[0] != 0, 2, "empty variable name");
     luaL_checktype(s, 3, LUA_TFUNCTION);
 
-    std::string value;
-    bool res = getQuestVar(ch, name, value);
-    if (res)
-    {
-        // Already cached, call passed callback immediately
-        Script *script = getScript(s);
-        Script::Ref callback;
-        script->assignCallback(callback);
-
-        script->prepare(callback);
-        script->push(ch);
-        script->push(name);
-        script->push(value);
-        script->execute(ch->getMap());
-
-        return 0;
-    }
+    Script *script = getScript(s);
+    Script::Ref callback;
+    script->assignCallback(callback);
 
-    QuestCallback *f = new QuestRefCallback(getScript(s), name);
-    recoverQuestVar(ch, name, f);
+    script->prepare(callback);
+    script->push(ch);
+    script->push(name);
+    script->push(getQuestVar(ch, name));
+    script->execute(ch->getMap());
 
     return 0;
 }
@@ -2126,10 +2109,11 @@ static int chr_request_quest(lua_State *s)
 /** LUA chr_try_get_quest (being)
  * chr_try_get_quest(handle character, string questvariable)
  **
- * Callback for checking if a quest variable is available in cache.
+ * Same as chr_get_quest, which no longer needs to wait for the account
+ * server.
  *
- * **Return value:** It will return the variable if it is or nil
- * if it is not in cache.
+ * **Return value:** The quest variable named `name` for the given character,
+ * an empty string if it was never set.
  */
 static int chr_try_get_quest(lua_State *s)
 {
@@ -2137,12 +2121,7 @@ static int chr_try_get_quest(lua_State *s)
     const char *name = luaL_checkstring(s, 2);
     luaL_argcheck(s, name[0] != 0, 2, "empty variable name");
 
-    std::string value;
-    bool res = getQuestVar(q, name, value);
-    if (res)
-        push(s, value);
-    else
-        lua_pushnil(s);
+    push(s, getQuestVar(q, name));
     return 1;
 }
 
@@ -2156,7 +2135,7 @@ static int chr_try_get_quest(lua_State *s)
 static int get_character_by_name(lua_State *s)
 {
     const char *name = luaL_checkstring(s, 1);
-    push(s, gameHandler->getCharacterByNameSlow(name));
+    push(s, gameHandler->getCharacterByName(name));
     return 1;
 }
 
@@ -2624,6 +2603,39 @@ static int get_path_length(lua_State *s)
     return 1;
 }
 
+/** LUA is_reachable (mapinformation)
+ * is_reachable(int startX, int startY, int destX, int destY)
+ * is_reachable(int startX, int startY, int destX, int destY,
+ *              string walkmask)
+ **
+ * Tells whether the target coordinates can be reached from the start ones
+ * when only the walls of the map are taken into account. Unlike
+ * ''get_path_length'' no path is searched, so this is cheap enough to be
+ * called for many targets.
+ *
+ * If no ''walkmask'' is passed '''w''' is used.
+ *
+ * **Return value:** True if a path between both locations may exist.
+ */
+static int is_reachable(lua_State *s)
+{
+    const int startX = luaL_checkint(s, 1);
+    const int startY = luaL_checkint(s, 2);
+    const int destX = luaL_checkint(s, 3);
+    const int destY = luaL_checkint(s, 4);
+    unsigned char walkmask = Map::BLOCKMASK_WALL;
+    if (lua_gettop(s) > 4)
+        walkmask = checkWalkMask(s, 5);
+
+    Map *map = checkCurrentMap(s)->getMap();
+    lua_pushboolean(s, map->isReachable(startX / map->getTileWidth(),
+                                        startY / map->getTileHeight(),
+                                        destX / map->getTileWidth(),
+                                        destY / map->getTileHeight(),
+                                        walkmask));
+    return 1;
+}
+
 /** LUA map_get_pvp (mapinformation)
  * map_get_pvp()
  **
@@ -2850,6 +2862,93 @@ static int get_beings_in_circle(lua_State *s)
     return 1;
 }
 
+/** LUA get_beings_in_sight (area)
+ * get_beings_in_sight(int x, int y, int radius)
+ * get_beings_in_sight(handle actor, int radius)
+ **
+ * Same as ''get_beings_in_circle'', but only beings that are not hidden
+ * behind walls as seen from the center are returned. Useful for area of
+ * effects and aggro checks.
+ *
+ * **Return value:** This function returns a lua table of all visible beings
+ * in a circle of radius (in pixels) `radius` centered either at the pixel at
+ * (`x`, `y`) or at the position of `being`.
+ */
+static int get_beings_in_sight(lua_State *s)
+{
+    int x, y, r;
+    if (lua_isuserdata(s, 1))
+    {
+        Entity *b = checkActor(s, 1);
+        const Point &pos = b->getComponent<ActorComponent>()->getPosition();
+        x = pos.x;
+        y = pos.y;
+        r = luaL_checkint(s, 2);
+    }
+    else
+    {
+        x = luaL_checkint(s, 1);
+        y = luaL_checkint(s, 2);
+        r = luaL_checkint(s, 3);
+    }
+
+    MapComposite *m = checkCurrentMap(s);
+    const Map &map = *m->getMap();
+    const Point center(x, y);
+
+    lua_newtable(s);
+    int tableStackPosition = lua_gettop(s);
+    int tableIndex = 1;
+    for (BeingIterator i(m->getAroundPointIterator(center, r)); i; ++i)
+    {
+        Entity *b = *i;
+        char t = b->getType();
+        if (t == OBJECT_NPC || t == OBJECT_CHARACTER || t == OBJECT_MONSTER)
+        {
+            auto *actorComponent = b->getComponent<ActorComponent>();
+            const Point &pos = actorComponent->getPosition();
+            if (Collision::circleWithCircle(pos, actorComponent->getSize(),
+                                            center, r) &&
+                Collision::lineOfSight(map, center, pos))
+            {
+                push(s, b);
+                lua_rawseti(s, tableStackPosition, tableIndex);
+                tableIndex++;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/** LUA has_line_of_sight (area)
+ * has_line_of_sight(int x1, int y1, int x2, int y2)
+ * has_line_of_sight(handle actor1, handle actor2)
+ **
+ * Checks whether the straight line between two pixel positions or two actors
+ * crosses a wall. This is much cheaper than ''get_path_length''.
+ *
+ * **Return value:** True if no wall is in the way.
+ */
+static int has_line_of_sight(lua_State *s)
+{
+    Point from, to;
+    if (lua_isuserdata(s, 1))
+    {
+        from = checkActor(s, 1)->getComponent<ActorComponent>()->getPosition();
+        to = checkActor(s, 2)->getComponent<ActorComponent>()->getPosition();
+    }
+    else
+    {
+        from = Point(luaL_checkint(s, 1), luaL_checkint(s, 2));
+        to = Point(luaL_checkint(s, 3), luaL_checkint(s, 4));
+    }
+
+    Map *map = checkCurrentMap(s)->getMap();
+    lua_pushboolean(s, Collision::lineOfSight(*map, from, to));
+    return 1;
+}
+
 /** LUA get_beings_in_rectangle (area)
  * get_beings_in_rectangle(int x, int y, int width, int height)
  **
@@ -3048,7 +3147,7 @@ static int attributeinfo_get_name(lua_State *s)
 static int get_status_effect(lua_State *s)
 {
     const char *name = luaL_checkstring(s, 1);
-    LuaStatusEffect::push(s, StatusManager::getStatusByName(name));
+    LuaStatusEffect::push(s, statusManager->getStatusByName(name));
     return 1;
 }
 
@@ -3368,7 +3467,8 @@ static int require_loader(lua_State *s)
 
 
 LuaScript::LuaScript():
-    nbArgs(-1)
+    nbArgs(-1),
+    mPreparedFunction(-1)
 {
     mRootState = luaL_newstate();
     mCurrentState = mRootState;
@@ -3427,6 +3527,8 @@ LuaScript::LuaScript():
         { "monster_create",                 monster_create                    },
         { "trigger_create",                 trigger_create                    },
         { "get_beings_in_circle",           get_beings_in_circle              },
+        { "get_beings_in_sight",            get_beings_in_sight               },
+        { "has_line_of_sight",              has_line_of_sight                 },
         { "get_beings_in_rectangle",        get_beings_in_rectangle           },
         { "get_character_by_name",          get_character_by_name             },
         { "effect_create",                  effect_create                     },
@@ -3435,6 +3537,7 @@ LuaScript::LuaScript():
         { "get_map_property",               get_map_property                  },
         { "is_walkable",                    is_walkable                       },
         { "get_path_length",                get_path_length                   },
+        { "is_reachable",                   is_reachable                      },
         { "map_get_pvp",                    map_get_pvp                       },
         { "item_drop",                      item_drop                         },
         { "log",                            log                               },
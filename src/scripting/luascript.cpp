@@ -25,10 +25,14 @@
 #include "scripting/scriptmanager.h"
 
 #include "game-server/charactercomponent.h"
+#include "game-server/flightrecorder.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
+#include "utils/profiler.h"
 
 #include <cassert>
 #include <cstring>
+#include <sstream>
 
 Script::Ref LuaScript::mDeathNotificationCallback;
 Script::Ref LuaScript::mRemoveNotificationCallback;
@@ -48,6 +52,22 @@ void LuaScript::prepare(Ref function)
     lua_rawgeti(mCurrentState, LUA_REGISTRYINDEX, function.value);
     assert(lua_isfunction(mCurrentState, -1));
     nbArgs = 0;
+    mPreparedFunction = function.value;
+}
+
+/**
+ * Names the function at the given stack index after where it was defined,
+ * for the profiler.
+ */
+const char *LuaScript::getFunctionName(int index)
+{
+    lua_Debug ar;
+    lua_pushvalue(mCurrentState, index);
+    lua_getinfo(mCurrentState, ">S", &ar);
+
+    std::ostringstream name;
+    name << "lua:" << ar.short_src << ':' << ar.linedefined;
+    return Profiler::intern(name.str());
 }
 
 Script::Thread *LuaScript::newThread()
@@ -129,7 +149,15 @@ int LuaScript::execute(const Context &context)
 
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+
+    const char *previousFunction = Profiler::getScriptFunction();
+    if (Profiler::isRunning())
+        Profiler::setScriptFunction(getFunctionName(-(tmpNbArgs + 1)));
+
+    const uint64_t start = Metrics::now();
     int res = lua_pcall(mCurrentState, tmpNbArgs, 1, 1);
+    FlightRecorder::noteScript(mPreparedFunction, Metrics::now() - start);
+    Profiler::setScriptFunction(previousFunction);
 
     if (res || !(lua_isnil(mCurrentState, -1) || lua_isnumber(mCurrentState, -1)))
     {
@@ -157,11 +185,16 @@ bool LuaScript::resume()
 
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+
+    // The function of a suspended thread is not on its stack anymore
+    const char *previousFunction = Profiler::getScriptFunction();
+    Profiler::setScriptFunction("lua:thread");
 #if LUA_VERSION_NUM < 502
     int result = lua_resume(mCurrentState, tmpNbArgs);
 #else
     int result = lua_resume(mCurrentState, nullptr, tmpNbArgs);
 #endif
+    Profiler::setScriptFunction(previousFunction);
 
     if (result == 0)                // Thread is done
     {
@@ -274,23 +307,6 @@ void LuaScript::processRemoveEvent(Entity *entity)
     }
 }
 
-/**
- * Called when the server has recovered the value of a quest variable.
- */
-void LuaScript::getQuestCallback(Entity *q,
-                                 const std::string &value,
-                                 Script *script)
-{
-    auto *characterComponent = q->getComponent<CharacterComponent>();
-    Script::Thread *thread = characterComponent->getNpcThread();
-    if (!thread || thread->mState != Script::ThreadExpectingString)
-        return;
-
-    script->prepareResume(thread);
-    script->push(value);
-    characterComponent->resumeNpcThread();
-}
-
 /**
  * Called when the server has recovered the post for a user.
  */
@@ -67,10 +67,6 @@ class LuaScript : public Script
 
         void unref(Ref &ref);
 
-        static void getQuestCallback(Entity *,
-                                     const std::string &value,
-                                     Script *);
-
         static void getPostCallback(Entity *,
                                     const std::string &sender,
                                     const std::string &letter,
@@ -100,9 +96,12 @@ class LuaScript : public Script
                 int mRef;
         };
 
+        const char *getFunctionName(int index);
+
         lua_State *mRootState;
         lua_State *mCurrentState;
         int nbArgs;
+        int mPreparedFunction;  /**< Registry index, for the flight recorder */
 
         static Ref mDeathNotificationCallback;
         static Ref mRemoveNotificationCallback;
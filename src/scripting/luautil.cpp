@@ -24,10 +24,13 @@
 #include <string.h>
 
 #include "game-server/charactercomponent.h"
+#include "game-server/item.h"
 #include "game-server/itemmanager.h"
 #include "game-server/monster.h"
 #include "game-server/monstermanager.h"
 #include "game-server/npc.h"
+#include "game-server/statuseffect.h"
+#include "game-server/statusmanager.h"
 
 #include "utils/logger.h"
 
@@ -165,6 +168,49 @@ Entity *LuaUserData<Entity>::check(lua_State *L, int narg)
 }
 
 
+int LuaUserDataKey<ItemClass>::get(ItemClass *itemClass)
+{
+    return itemClass->getDatabaseID();
+}
+
+ItemClass *LuaUserDataKey<ItemClass>::find(int id)
+{
+    return itemManager->getItem(id);
+}
+
+int LuaUserDataKey<MonsterClass>::get(MonsterClass *monsterClass)
+{
+    return monsterClass->getId();
+}
+
+MonsterClass *LuaUserDataKey<MonsterClass>::find(int id)
+{
+    return monsterManager->getMonster(id);
+}
+
+int LuaUserDataKey<StatusEffect>::get(StatusEffect *statusEffect)
+{
+    return statusEffect->getId();
+}
+
+StatusEffect *LuaUserDataKey<StatusEffect>::find(int id)
+{
+    return statusManager->getStatus(id);
+}
+
+int LuaUserDataKey<AbilityManager::AbilityInfo>::get(
+        AbilityManager::AbilityInfo *abilityInfo)
+{
+    return abilityInfo->id;
+}
+
+AbilityManager::AbilityInfo *LuaUserDataKey<AbilityManager::AbilityInfo>::find(
+        int id)
+{
+    return abilityManager->getAbilityInfo(id);
+}
+
+
 Script *getScript(lua_State *s)
 {
     lua_pushlightuserdata(s, (void *)&LuaScript::registryKey);
@@ -39,6 +39,7 @@ extern "C" {
 
 #include "game-server/abilitymanager.h"
 #include "game-server/attributemanager.h"
+#include "utils/idregistry.h"
 
 class CharacterComponent;
 class Entity;
@@ -85,6 +86,61 @@ private:
 };
 
 
+/**
+ * Tells how the userdata of a type refers to its objects. By default, it holds
+ * a pointer to them.
+ */
+template <typename T>
+struct LuaUserDataKey
+{
+    typedef T *Type;
+
+    static Type get(T *object) { return object; }
+    static T *find(Type key) { return key; }
+    static void push(lua_State *s, Type key) { lua_pushlightuserdata(s, key); }
+};
+
+/**
+ * The types of the game data are referred to by ID, so that the userdata
+ * scripts keep refers to the current version of the game data after it was
+ * reloaded.
+ */
+struct LuaGameDataKey
+{
+    typedef int Type;
+
+    static void push(lua_State *s, Type key) { lua_pushinteger(s, key); }
+};
+
+template <>
+struct LuaUserDataKey<ItemClass> : LuaGameDataKey
+{
+    static Type get(ItemClass *itemClass);
+    static ItemClass *find(Type id);
+};
+
+template <>
+struct LuaUserDataKey<MonsterClass> : LuaGameDataKey
+{
+    static Type get(MonsterClass *monsterClass);
+    static MonsterClass *find(Type id);
+};
+
+template <>
+struct LuaUserDataKey<StatusEffect> : LuaGameDataKey
+{
+    static Type get(StatusEffect *statusEffect);
+    static StatusEffect *find(Type id);
+};
+
+template <>
+struct LuaUserDataKey<AbilityManager::AbilityInfo> : LuaGameDataKey
+{
+    static Type get(AbilityManager::AbilityInfo *abilityInfo);
+    static AbilityManager::AbilityInfo *find(Type id);
+};
+
+
 /**
  * A helper class for pushing and checking custom Lua userdata types.
  */
@@ -134,12 +190,13 @@ public:
         }
         else
         {
-            lua_pushlightuserdata(s, object);
+            const Key key = LuaUserDataKey<T>::get(object);
+            LuaUserDataKey<T>::push(s, key);
 
             if (!mUserDataCache.retrieve(s))
             {
-                void *userData = lua_newuserdata(s, sizeof(T*));
-                * static_cast<T**>(userData) = object;
+                void *userData = lua_newuserdata(s, sizeof(Key));
+                * static_cast<Key*>(userData) = key;
 
 #if LUA_VERSION_NUM < 502
                 luaL_newmetatable(s, mTypeName);
@@ -154,16 +211,20 @@ public:
     }
 
     /**
-     * Returns the argument at position \a narg when it is of the right type,
-     * and raises a Lua error otherwise.
+     * Returns the argument at position \a narg when it is of the right type
+     * and its object still exists, and raises a Lua error otherwise.
      */
     static T *check(lua_State *L, int narg)
     {
         void *userData = luaL_checkudata(L, narg, mTypeName);
-        return *(static_cast<T**>(userData));
+        T *object = LuaUserDataKey<T>::find(*(static_cast<Key*>(userData)));
+        luaL_argcheck(L, object, narg, "object no longer exists");
+        return object;
     }
 
 private:
+    typedef typename LuaUserDataKey<T>::Type Key;
+
     static const char *mTypeName;
     static UserDataCache mUserDataCache;
 };
@@ -308,6 +369,22 @@ void pushSTLContainer(lua_State *s, const std::map<Tkey, Tval> &container)
     }
 }
 
+/*  Pushes an ID REGISTRY */
+template <typename T>
+void pushSTLContainer(lua_State *s, const utils::IdRegistry<T> &container)
+{
+    lua_createtable(s, 0, container.size());
+    int table = lua_gettop(s);
+
+    for (typename utils::IdRegistry<T>::const_iterator i = container.begin(),
+         i_end = container.end(); i != i_end; ++i)
+    {
+        push(s, i->first);
+        push(s, i->second);
+        lua_settable(s, table);
+    }
+}
+
 /*  Pushes an STL SET */
 template <typename T>
 void pushSTLContainer(lua_State *s, const std::set<T> &container)
@@ -0,0 +1,132 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDREGISTRY_H
+#define IDREGISTRY_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace utils
+{
+
+/**
+ * Finds objects by their ID with a single indexed load.
+ *
+ * The IDs used in the game data are small and mostly contiguous, so the
+ * objects are kept in a vector indexed by ID. The few IDs too large for
+ * that, or negative, are remapped through a hash table instead.
+ *
+ * T is meant to be a pointer, a default constructed T is returned when
+ * nothing matches. Iterating goes over (ID, object) pairs in the order the
+ * objects were inserted.
+ */
+template< class T >
+class IdRegistry
+{
+        typedef std::pair<int, T> Entry;
+        typedef std::vector<Entry> Entries;
+
+    public:
+        typedef typename Entries::const_iterator const_iterator;
+
+        /**
+         * IDs from this one on are remapped rather than indexed directly.
+         */
+        static const int MAX_DIRECT_ID = 0x10000;
+
+        /**
+         * Adds an object. An object already known under this ID is replaced.
+         */
+        void insert(int id, T value)
+        {
+            if (contains(id))
+            {
+                for (typename Entries::iterator it = mEntries.begin(),
+                     it_end = mEntries.end(); it != it_end; ++it)
+                {
+                    if (it->first == id)
+                        it->second = value;
+                }
+            }
+            else
+            {
+                mEntries.push_back(Entry(id, value));
+            }
+
+            if (id >= 0 && id < MAX_DIRECT_ID)
+            {
+                if (unsigned(id) >= mDirect.size())
+                    mDirect.resize(id + 1);
+                mDirect[id] = value;
+            }
+            else
+            {
+                mRemapped[id] = value;
+            }
+        }
+
+        T value(int id) const
+        {
+            if (unsigned(id) < mDirect.size())
+                return mDirect[id];
+            if (mRemapped.empty())
+                return T();
+
+            typename Remapped::const_iterator i = mRemapped.find(id);
+            return i != mRemapped.end() ? i->second : T();
+        }
+
+        bool contains(int id) const
+        {
+            return value(id) != T();
+        }
+
+        unsigned size() const
+        { return mEntries.size(); }
+
+        bool empty() const
+        { return mEntries.empty(); }
+
+        void clear()
+        {
+            mEntries.clear();
+            mDirect.clear();
+            mRemapped.clear();
+        }
+
+        const_iterator begin() const
+        { return mEntries.begin(); }
+
+        const_iterator end() const
+        { return mEntries.end(); }
+
+    private:
+        typedef std::unordered_map<int, T> Remapped;
+
+        Entries mEntries;
+        std::vector<T> mDirect;     /**< Indexed by ID */
+        Remapped mRemapped;         /**< IDs out of the direct range */
+};
+
+} // namespace utils
+
+#endif // IDREGISTRY_H
@@ -22,11 +22,21 @@
 #include "logger.h"
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
+#include "utils/metrics.h"
 #include "utils/string.h"
 #include "utils/time.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
 
 #ifdef WIN32
 #include <windows.h>
@@ -58,6 +68,164 @@ static std::string mLastCallDate;
  * from the last call date.
  */
 static std::string mOldDate;
+/** Keeps the lines of different threads apart. */
+static std::mutex mOutputMutex;
+
+/** How long the writer sleeps when there is nothing to write, in ms. */
+static const int WRITER_IDLE_TIME = 10;
+
+/**
+ * A formatted line waiting to be written.
+ */
+struct LogRecord
+{
+    std::string text;
+    Logger::Level level;
+};
+
+/**
+ * A bounded queue any thread can push to and only the writer pops from.
+ *
+ * Each cell carries a sequence number telling whether it is free for the
+ * producer at a given position or filled for the consumer, so that pushing
+ * only takes a compare-and-swap on the position (the queue of Dmitry
+ * Vyukov).
+ */
+class LogQueue
+{
+    public:
+        LogQueue():
+            mMask(0),
+            mPushPosition(0),
+            mPopPosition(0)
+        {}
+
+        /**
+         * Sets the capacity, rounded up to a power of two. Only to be called
+         * while nobody uses the queue.
+         */
+        void reset(unsigned capacity)
+        {
+            unsigned size = 1;
+            while (size < capacity)
+                size <<= 1;
+
+            mCells = std::vector<Cell>(size);
+            for (unsigned i = 0; i < size; ++i)
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            mMask = size - 1;
+            mPushPosition.store(0, std::memory_order_relaxed);
+            mPopPosition = 0;
+        }
+
+        /**
+         * Returns false when the queue is full.
+         */
+        bool push(LogRecord &record)
+        {
+            size_t position = mPushPosition.load(std::memory_order_relaxed);
+            Cell *cell;
+            for (;;)
+            {
+                cell = &mCells[position & mMask];
+                const size_t sequence =
+                        cell->sequence.load(std::memory_order_acquire);
+                const intptr_t difference =
+                        intptr_t(sequence) - intptr_t(position);
+
+                if (difference == 0)
+                {
+                    if (mPushPosition.compare_exchange_weak(
+                                position, position + 1,
+                                std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mPushPosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->record.text.swap(record.text);
+            cell->record.level = record.level;
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Returns false when the queue is empty. Only called by the writer.
+         */
+        bool pop(LogRecord &record)
+        {
+            Cell &cell = mCells[mPopPosition & mMask];
+            if (cell.sequence.load(std::memory_order_acquire) !=
+                mPopPosition + 1)
+                return false;
+
+            record.text.swap(cell.record.text);
+            record.level = cell.record.level;
+            cell.record.text.clear();
+            cell.sequence.store(mPopPosition + mMask + 1,
+                                std::memory_order_release);
+            ++mPopPosition;
+            return true;
+        }
+
+        /** The number of records pushed so far. */
+        size_t getPushed() const
+        { return mPushPosition.load(std::memory_order_acquire); }
+
+        /** The number of records popped so far. */
+        size_t getPopped() const
+        { return mPopPosition; }
+
+    private:
+        struct Cell
+        {
+            Cell() : sequence(0) {}
+            Cell(const Cell &) : sequence(0) {}
+
+            std::atomic<size_t> sequence;
+            LogRecord record;
+        };
+
+        std::vector<Cell> mCells;
+        size_t mMask;
+        std::atomic<size_t> mPushPosition;
+        size_t mPopPosition;
+};
+
+static LogQueue mQueue;
+/** The thread writing the queued records, when running. */
+static std::thread *mWriter;
+static std::atomic<bool> mAsync(false);
+static std::atomic<bool> mStopping(false);
+/** Records dropped because the queue was full, not reported yet. */
+static std::atomic<unsigned> mDropped(0);
+/** For waiting until the writer caught up. */
+static std::mutex mFlushMutex;
+static std::condition_variable mWritten;
+static std::condition_variable mWakeWriter;
+static size_t mWrittenCount;
+
+static const char *prefixes[] =
+{
+#ifdef T_COL_LOG
+    "[\033[45mFTL\033[0m]",
+    "[\033[41mERR\033[0m]",
+    "[\033[43mWRN\033[0m]",
+#else
+    "[FTL]",
+    "[ERR]",
+    "[WRN]",
+#endif
+    "[INF]",
+    "[DBG]"
+};
 
 /**
   * Check whether the day has changed since the last call.
@@ -91,21 +259,161 @@ void Logger::initialize(const std::string &logFile)
     setLogRotation(Configuration::getBoolValue("log_enableRotation", false));
     setMaxLogfileSize(Configuration::getValue("log_maxFileSize", 1024));
     setSwitchLogEachDay(Configuration::getBoolValue("log_perDay", false));
+
+    // Hand the writing over to a thread of its own
+    const int queueSize = Configuration::getValue("log_queueSize", 8192);
+    if (queueSize > 0 && !mWriter)
+    {
+        mQueue.reset(queueSize);
+        mStopping = false;
+        mAsync = true;
+        mWriter = new std::thread(&Logger::writeQueued);
+        std::atexit(&Logger::deinitialize);
+    }
 }
 
-void Logger::output(std::ostream &os, const std::string &msg, const char *prefix)
+void Logger::deinitialize()
 {
+    if (!mWriter)
+        return;
+
+    mStopping = true;
+    mWakeWriter.notify_one();
+    mWriter->join();
+    delete mWriter;
+    mWriter = 0;
+}
+
+std::string Logger::format(const std::string &msg, Level atVerbosity)
+{
+    std::string line;
+    line.reserve(msg.size() + 18);
+
     if (mHasTimestamp)
     {
-        os << "[" << getCurrentTime() << "]" << ' ';
+        char timestamp[16];
+        const time_t now = time(0);
+        tm local;
+#ifdef WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        strftime(timestamp, sizeof(timestamp), "[%H:%M:%S] ", &local);
+        line += timestamp;
     }
 
-    if (prefix)
+    line += prefixes[atVerbosity];
+    line += ' ';
+    line += msg;
+    line += '\n';
+    return line;
+}
+
+void Logger::write(const std::string &line, Level atVerbosity)
+{
+    bool open = mLogFile.is_open();
+
+    if (open)
+        mLogFile << line;
+
+    if (!open || mTeeMode)
+        (atVerbosity <= Warn ? std::cerr : std::cout) << line << std::flush;
+}
+
+void Logger::writeQueued()
+{
+    static Metrics::Counter &droppedCounter =
+            Metrics::counter("manaserv_log_dropped_total",
+                             "Log messages dropped because the queue of the "
+                             "log writer was full.");
+
+    LogRecord record;
+    for (;;)
     {
-        os << prefix << ' ';
+        // Stopping is checked before popping, so that nothing pushed before
+        // is left behind
+        const bool stopping = mStopping;
+
+        bool wrote = false;
+        try
+        {
+            while (mQueue.pop(record))
+            {
+                write(record.text, record.level);
+                wrote = true;
+            }
+
+            if (const unsigned dropped = mDropped.exchange(0))
+            {
+                droppedCounter.increment(dropped);
+                std::ostringstream os;
+                os << dropped << " log messages were dropped.";
+                write(format(os.str(), Warn), Warn);
+                wrote = true;
+            }
+
+            if (wrote)
+            {
+                if (mLogFile.is_open())
+                {
+                    mLogFile.flush();
+                    switchLogs();
+                }
+            }
+        }
+        catch (const std::ios::failure &e)
+        {
+            std::cerr << "Unable to write the log: " << e.what() << std::endl;
+            mLogFile.clear();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mFlushMutex);
+            mWrittenCount = mQueue.getPopped();
+            mWritten.notify_all();
+
+            if (stopping)
+            {
+                mAsync = false;
+                break;
+            }
+
+            if (!wrote)
+            {
+                mWakeWriter.wait_for(
+                        lock, std::chrono::milliseconds(WRITER_IDLE_TIME));
+            }
+        }
     }
 
-    os << msg << std::endl;
+    // Messages logged while the writer stopped. Loggers still pushing now
+    // see it stopped and call writeRemaining() too, see output(); the
+    // fence pairs with theirs.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> lock(mOutputMutex);
+    writeRemaining();
+}
+
+void Logger::writeRemaining()
+{
+    LogRecord record;
+    while (mQueue.pop(record))
+        write(record.text, record.level);
+    if (mLogFile.is_open())
+        mLogFile.flush();
+}
+
+void Logger::flush()
+{
+    if (!mAsync)
+        return;
+
+    const size_t pushed = mQueue.getPushed();
+    std::unique_lock<std::mutex> lock(mFlushMutex);
+    mWakeWriter.notify_one();
+    while (mAsync && mWrittenCount < pushed)
+        mWritten.wait(lock);
 }
 
 void Logger::setLogFile(const std::string &logFile, bool append)
@@ -138,36 +446,44 @@ void Logger::setLogFile(const std::string &logFile, bool append)
 
 void Logger::output(const std::string &msg, Level atVerbosity)
 {
-    if (mVerbosity >= atVerbosity)
-    {
-        static const char *prefixes[] =
-        {
-        #ifdef T_COL_LOG
-            "[\033[45mFTL\033[0m]",
-            "[\033[41mERR\033[0m]",
-            "[\033[43mWRN\033[0m]",
-        #else
-            "[FTL]",
-            "[ERR]",
-            "[WRN]",
-        #endif
-            "[INF]",
-            "[DBG]"
-        };
+    if (mVerbosity < atVerbosity)
+        return;
 
-        bool open = mLogFile.is_open();
+    if (mAsync)
+    {
+        LogRecord record;
+        record.text = format(msg, atVerbosity);
+        record.level = atVerbosity;
+        const bool pushed = mQueue.push(record);
 
-        if (open)
+        // The writer may have stopped since the check, after its last look
+        // at the queue
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mAsync)
         {
-            output(mLogFile, msg, prefixes[atVerbosity]);
-            switchLogs();
-        }
+            if (!pushed)
+                ++mDropped;
 
-        if (!open || mTeeMode)
-        {
-            output(atVerbosity <= Warn ? std::cerr : std::cout,
-                   msg, prefixes[atVerbosity]);
+            // The process is likely to end right after a fatal error
+            if (atVerbosity == Fatal)
+                flush();
+            return;
         }
+
+        std::lock_guard<std::mutex> lock(mOutputMutex);
+        writeRemaining();
+        if (!pushed)
+            write(record.text, atVerbosity);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mOutputMutex);
+
+    write(format(msg, atVerbosity), atVerbosity);
+    if (mLogFile.is_open())
+    {
+        mLogFile.flush();
+        switchLogs();
     }
 }
 
@@ -36,8 +36,10 @@ namespace utils
  * By default, the messages will be timestamped but the logger can be
  * configured to not prefix the messages with a timestamp.
  *
- * Limitations:
- *     - not thread-safe.
+ * Once initialized, the messages are formatted by the thread logging them
+ * and queued for a thread of their own to write them, so that logging never
+ * waits on the disk. When the queue is full, messages are dropped and the
+ * number of dropped messages is logged later. Logging is thread-safe.
  *
  * Example of use:
  *
@@ -83,8 +85,24 @@ class Logger
             Debug
         };
 
+        /**
+         * Opens the log file, reads the logging options and starts the
+         * thread writing the messages, unless log_queueSize is 0.
+         */
         static void initialize(const std::string &logFile);
 
+        /**
+         * Writes the queued messages and stops the writing thread. Later
+         * messages are written directly. Also called when the process
+         * exits.
+         */
+        static void deinitialize();
+
+        /**
+         * Waits until the messages logged so far are written.
+         */
+        static void flush();
+
         /**
          * Sets the log file.
          *
@@ -175,16 +193,29 @@ class Logger
         static bool mSwitchLogEachDay;
 
         /**
-         * Logs a generic message.
-         *
-         * @param os the output stream.
-         * @param msg the message to log.
-         * @param prefix the message prefix.
+         * Returns the line to write for a message, with its timestamp and
+         * prefix.
+         */
+        static std::string format(const std::string &msg, Level atVerbosity);
+
+        /**
+         * Writes a formatted line to the log file and/or the standard
+         * outputs.
          *
          * @exception std::ios::failure.
          */
-        static void output(std::ostream &os, const std::string &msg,
-                           const char *prefix);
+        static void write(const std::string &line, Level atVerbosity);
+
+        /**
+         * Body of the writing thread.
+         */
+        static void writeQueued();
+
+        /**
+         * Writes the records left in the queue once the writing thread
+         * stopped. To be called with the output mutex held.
+         */
+        static void writeRemaining();
 
         /**
          * Switch the log file based on a maximum size
@@ -0,0 +1,282 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/metrics.h"
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace Metrics
+{
+
+/**
+ * The histogram buckets are exported up to this power of two, a bit over a
+ * minute in microseconds. The values above only show in the +Inf bucket.
+ */
+static const unsigned EXPORTED_MAX_EXPONENT = 26;
+
+enum MetricType
+{
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+struct Family
+{
+    std::string help;
+    MetricType type;
+    std::vector<std::pair<std::string, void *> > series;  /**< By labels */
+};
+
+/**
+ * Metrics are registered from static initializers of other files too, so
+ * the registry is made on first use.
+ */
+struct Registry
+{
+    std::mutex mutex;
+    std::map<std::string, Family> families;
+    std::list<Counter> counters;
+    std::list<Gauge> gauges;
+    std::list<Histogram> histograms;
+};
+
+static Registry &registry()
+{
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+Histogram::Histogram(double scale):
+    mScale(scale),
+    mCount(0),
+    mSum(0)
+{
+    for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+        mBuckets[i] = 0;
+}
+
+unsigned Histogram::getBucket(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return value;
+
+    unsigned exponent = SUB_BUCKET_BITS;
+    while (exponent + 1 < MAX_EXPONENT && (value >> (exponent + 1)))
+        ++exponent;
+
+    if (value >> MAX_EXPONENT)
+        return BUCKET_COUNT - 1;
+
+    const unsigned subBucket =
+            (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t Histogram::getBucketUpperBound(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    const unsigned exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const uint64_t subBucket = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + subBucket + 1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    mBuckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(value, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getBucketCount(unsigned bucket) const
+{
+    return mBuckets[bucket].load(std::memory_order_relaxed);
+}
+
+ScopedTimer::ScopedTimer(Histogram &histogram):
+    mHistogram(histogram),
+    mStart(now())
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    mHistogram.record(now() - mStart);
+}
+
+uint64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+            steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Finds the series with the given name and labels, or registers the one
+ * made by the given function. Called with the mutex locked.
+ */
+template< class T, class Make >
+static T &getSeries(const std::string &name, const std::string &help,
+                    MetricType type, const std::string &labels, Make make)
+{
+    Family &family = registry().families[name];
+    if (family.series.empty())
+    {
+        family.help = help;
+        family.type = type;
+    }
+
+    for (std::vector<std::pair<std::string, void *> >::const_iterator it =
+         family.series.begin(), it_end = family.series.end();
+         it != it_end; ++it)
+    {
+        if (it->first == labels)
+            return *static_cast<T *>(it->second);
+    }
+
+    T &metric = make();
+    family.series.push_back(std::make_pair(labels, (void *) &metric));
+    return metric;
+}
+
+Counter &counter(const std::string &name, const std::string &help,
+                 const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    return getSeries<Counter>(name, help, COUNTER, labels, [] () -> Counter & {
+        registry().counters.emplace_back();
+        return registry().counters.back();
+    });
+}
+
+Gauge &gauge(const std::string &name, const std::string &help,
+             const std::string &labels)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    return getSeries<Gauge>(name, help, GAUGE, labels, [] () -> Gauge & {
+        registry().gauges.emplace_back();
+        return registry().gauges.back();
+    });
+}
+
+Histogram &histogram(const std::string &name, const std::string &help,
+                     const std::string &labels, double scale)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    return getSeries<Histogram>(name, help, HISTOGRAM, labels,
+                                [scale] () -> Histogram & {
+        registry().histograms.emplace_back(scale);
+        return registry().histograms.back();
+    });
+}
+
+static std::string withLabels(const std::string &labels,
+                              const std::string &extra = std::string())
+{
+    if (labels.empty() && extra.empty())
+        return std::string();
+    if (labels.empty() || extra.empty())
+        return "{" + labels + extra + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+static void formatHistogram(std::ostream &out, const std::string &name,
+                            const std::string &labels,
+                            const Histogram &histogram)
+{
+    // Every bucket is exported, so that quantiles computed from them keep
+    // the resolution of the sub-buckets. The total is counted from the
+    // buckets, so that it matches them even when values are recorded
+    // meanwhile.
+    uint64_t count = 0;
+    for (unsigned bucket = 0; bucket < Histogram::BUCKET_COUNT; ++bucket)
+    {
+        count += histogram.getBucketCount(bucket);
+
+        const uint64_t bound = Histogram::getBucketUpperBound(bucket);
+        if (bound >> EXPORTED_MAX_EXPONENT)
+            continue;
+
+        std::ostringstream le;
+        le.precision(12);
+        le << "le=\"" << bound * histogram.getScale() << "\"";
+        out << name << "_bucket" << withLabels(labels, le.str()) << ' '
+            << count << '\n';
+    }
+
+    out << name << "_bucket" << withLabels(labels, "le=\"+Inf\"") << ' '
+        << count << '\n';
+    out << name << "_sum" << withLabels(labels) << ' '
+        << histogram.getSum() * histogram.getScale() << '\n';
+    out << name << "_count" << withLabels(labels) << ' ' << count << '\n';
+}
+
+std::string format()
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    std::ostringstream out;
+    out.precision(12);
+
+    const std::map<std::string, Family> &families = registry().families;
+    for (std::map<std::string, Family>::const_iterator it = families.begin(),
+         it_end = families.end(); it != it_end; ++it)
+    {
+        const std::string &name = it->first;
+        const Family &family = it->second;
+
+        static const char *typeNames[] = { "counter", "gauge", "histogram" };
+        out << "# HELP " << name << ' ' << family.help << '\n';
+        out << "# TYPE " << name << ' ' << typeNames[family.type] << '\n';
+
+        for (std::vector<std::pair<std::string, void *> >::const_iterator s =
+             family.series.begin(), s_end = family.series.end();
+             s != s_end; ++s)
+        {
+            switch (family.type)
+            {
+                case COUNTER:
+                    out << name << withLabels(s->first) << ' '
+                        << static_cast<Counter *>(s->second)->getValue()
+                        << '\n';
+                    break;
+                case GAUGE:
+                    out << name << withLabels(s->first) << ' '
+                        << static_cast<Gauge *>(s->second)->getValue()
+                        << '\n';
+                    break;
+                case HISTOGRAM:
+                    formatHistogram(out, name, s->first,
+                                    *static_cast<Histogram *>(s->second));
+                    break;
+            }
+        }
+    }
+
+    return out.str();
+}
+
+} // namespace Metrics
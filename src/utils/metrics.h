@@ -0,0 +1,171 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Counters, gauges and histograms describing what the server is doing,
+ * exported in the Prometheus text format.
+ *
+ * A metric is registered once under a name and a set of labels, usually in a
+ * function-level static, and updated with atomic operations afterwards so
+ * that it can be read from another thread at any time.
+ */
+namespace Metrics
+{
+    /**
+     * A value that only goes up, like a number of messages.
+     */
+    class Counter
+    {
+        public:
+            Counter() : mValue(0) {}
+
+            void increment(uint64_t amount = 1)
+            { mValue.fetch_add(amount, std::memory_order_relaxed); }
+
+            uint64_t getValue() const
+            { return mValue.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<uint64_t> mValue;
+    };
+
+    /**
+     * A value that goes up and down, like the length of a queue.
+     */
+    class Gauge
+    {
+        public:
+            Gauge() : mValue(0) {}
+
+            void set(int64_t value)
+            { mValue.store(value, std::memory_order_relaxed); }
+
+            void add(int64_t amount)
+            { mValue.fetch_add(amount, std::memory_order_relaxed); }
+
+            int64_t getValue() const
+            { return mValue.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<int64_t> mValue;
+    };
+
+    /**
+     * Counts recorded values in buckets of logarithmic size, each power of
+     * two being split in SUB_BUCKETS linear buckets. This keeps the relative
+     * error of a quantile under 1/SUB_BUCKETS whatever the magnitude of the
+     * values, like an HDR histogram does.
+     *
+     * The values are integers, microseconds or bytes typically. They are
+     * multiplied by the scale of the histogram when exported, so that times
+     * come out in seconds as Prometheus expects.
+     */
+    class Histogram
+    {
+        public:
+            static const unsigned SUB_BUCKET_BITS = 3;
+            static const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+            /** Values from 2^MAX_EXPONENT on share the last bucket. */
+            static const unsigned MAX_EXPONENT = 40;
+
+            static const unsigned BUCKET_COUNT =
+                    (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+            explicit Histogram(double scale = 1.0);
+
+            void record(uint64_t value);
+
+            uint64_t getCount() const
+            { return mCount.load(std::memory_order_relaxed); }
+
+            uint64_t getSum() const
+            { return mSum.load(std::memory_order_relaxed); }
+
+            double getScale() const
+            { return mScale; }
+
+            /**
+             * Returns the number of values recorded in a bucket.
+             */
+            uint64_t getBucketCount(unsigned bucket) const;
+
+            /**
+             * Returns the largest value counted in a bucket, unscaled. The
+             * values are integers, so this is the inclusive bound that
+             * Prometheus expects.
+             */
+            static uint64_t getBucketUpperBound(unsigned bucket);
+
+        private:
+            static unsigned getBucket(uint64_t value);
+
+            const double mScale;
+            std::atomic<uint64_t> mCount;
+            std::atomic<uint64_t> mSum;
+            std::atomic<uint64_t> mBuckets[BUCKET_COUNT];
+    };
+
+    /**
+     * Records the time spent in a scope, in microseconds.
+     */
+    class ScopedTimer
+    {
+        public:
+            explicit ScopedTimer(Histogram &histogram);
+            ~ScopedTimer();
+
+        private:
+            Histogram &mHistogram;
+            uint64_t mStart;
+    };
+
+    /**
+     * Returns a monotonic time in microseconds, for measuring durations.
+     */
+    uint64_t now();
+
+    /**
+     * Return the metric with the given name and labels, registering it on
+     * first use. The labels are given in the Prometheus syntax, like
+     * <code>phase="move"</code>. Metrics are never unregistered.
+     */
+    Counter &counter(const std::string &name, const std::string &help,
+                     const std::string &labels = std::string());
+    Gauge &gauge(const std::string &name, const std::string &help,
+                 const std::string &labels = std::string());
+    Histogram &histogram(const std::string &name, const std::string &help,
+                         const std::string &labels = std::string(),
+                         double scale = 1.0);
+
+    /**
+     * Returns all the metrics in the Prometheus text exposition format.
+     */
+    std::string format();
+}
+
+#endif // METRICS_H
@@ -0,0 +1,106 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <string>
+#include <unordered_map>
+
+namespace utils
+{
+
+/**
+ * Finds objects by ID or by name in constant time.
+ *
+ * The owner has to keep the index in sync, by inserting objects when they
+ * appear, removing them when they go away and renaming them when their name
+ * changes. Names are matched exactly, case included, like the linear
+ * searches this replaces did.
+ *
+ * T is meant to be a pointer, a default constructed T is returned when
+ * nothing matches.
+ */
+template< class T >
+class NameIndex
+{
+    public:
+        /**
+         * Adds an object. An object already known under this ID is replaced.
+         */
+        void insert(int id, const std::string &name, T value)
+        {
+            remove(id);
+            Entry &entry = mById[id];
+            entry.name = name;
+            entry.value = value;
+            mByName[name] = id;
+        }
+
+        /**
+         * Removes the object with the given ID, if any.
+         */
+        void remove(int id)
+        {
+            typename ById::iterator i = mById.find(id);
+            if (i == mById.end())
+                return;
+
+            typename ByName::iterator n = mByName.find(i->second.name);
+            if (n != mByName.end() && n->second == id)
+                mByName.erase(n);
+            mById.erase(i);
+        }
+
+        T findById(int id) const
+        {
+            typename ById::const_iterator i = mById.find(id);
+            return i != mById.end() ? i->second.value : T();
+        }
+
+        T findByName(const std::string &name) const
+        {
+            typename ByName::const_iterator n = mByName.find(name);
+            return n != mByName.end() ? findById(n->second) : T();
+        }
+
+        void clear()
+        {
+            mById.clear();
+            mByName.clear();
+        }
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            T value;
+        };
+
+        typedef std::unordered_map<int, Entry> ById;
+        typedef std::unordered_map<std::string, int> ByName;
+
+        ById mById;
+        ByName mByName;
+};
+
+} // namespace utils
+
+#endif // NAMEINDEX_H
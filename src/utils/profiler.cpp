@@ -0,0 +1,423 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/profiler.h"
+
+#include "common/configuration.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <stdint.h>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define HAVE_PROFILER
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <sys/time.h>
+#endif
+
+namespace Profiler
+{
+
+/** Deepest stack recorded, the outermost frames are cut. */
+static const unsigned MAX_DEPTH = 48;
+
+/** Number of distinct stacks that can be counted, a power of two. */
+static const unsigned TABLE_SIZE = 8192;
+
+/** Slots looked at before giving up on a sample. */
+static const unsigned MAX_PROBES = 32;
+
+/** Frames of the signal handler and of the signal trampoline. */
+static const unsigned SKIPPED_FRAMES = 2;
+
+/**
+ * A stack and the number of times it was sampled. The slot belongs to the
+ * stack whose hash was written first, and its frames can be read once it is
+ * ready.
+ */
+struct Stack
+{
+    std::atomic<uint64_t> hash;
+    std::atomic<unsigned> count;
+    std::atomic<bool> ready;
+    const char *phase;
+    const char *script;
+    unsigned depth;
+    void *frames[MAX_DEPTH];
+};
+
+static Stack *stacks;
+static std::atomic<bool> running(false);
+static std::atomic<unsigned> sampleCount(0);
+static std::atomic<unsigned> droppedCount(0);
+static volatile sig_atomic_t toggleRequested = 0;
+static int defaultFrequency;
+static std::string outputFile;
+
+static thread_local const char *currentPhase;
+static thread_local const char *currentScript;
+
+#ifdef HAVE_PROFILER
+
+static uint64_t hashStack(void **frames, unsigned depth,
+                          const char *phase, const char *script)
+{
+    // FNV-1a over the addresses
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned i = 0; i < depth; ++i)
+    {
+        hash ^= uint64_t(uintptr_t(frames[i]));
+        hash *= 1099511628211ULL;
+    }
+    hash ^= uint64_t(uintptr_t(phase));
+    hash *= 1099511628211ULL;
+    hash ^= uint64_t(uintptr_t(script));
+    hash *= 1099511628211ULL;
+    return hash ? hash : 1;
+}
+
+/**
+ * The SIGPROF handler. Only touches the preallocated table.
+ */
+static void takeSample(int)
+{
+    const int savedErrno = errno;
+
+    void *frames[MAX_DEPTH + SKIPPED_FRAMES];
+    const int found = backtrace(frames, MAX_DEPTH + SKIPPED_FRAMES);
+    const unsigned skipped =
+            found > int(SKIPPED_FRAMES) ? SKIPPED_FRAMES : 0;
+    void **stack = frames + skipped;
+    const unsigned depth = found - skipped;
+
+    const char *phase = currentPhase;
+    const char *script = currentScript;
+    const uint64_t hash = hashStack(stack, depth, phase, script);
+
+    sampleCount.fetch_add(1, std::memory_order_relaxed);
+
+    for (unsigned probe = 0; probe < MAX_PROBES; ++probe)
+    {
+        Stack &slot = stacks[(hash + probe) & (TABLE_SIZE - 1)];
+        uint64_t slotHash = slot.hash.load(std::memory_order_acquire);
+
+        if (slotHash == 0 &&
+            slot.hash.compare_exchange_strong(slotHash, hash))
+        {
+            slot.phase = phase;
+            slot.script = script;
+            slot.depth = depth;
+            for (unsigned i = 0; i < depth; ++i)
+                slot.frames[i] = stack[i];
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            slot.ready.store(true, std::memory_order_release);
+            errno = savedErrno;
+            return;
+        }
+
+        // Set by the compare-and-swap when another sample won the slot
+        if (slotHash == hash)
+        {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            errno = savedErrno;
+            return;
+        }
+    }
+
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    errno = savedErrno;
+}
+
+/**
+ * Turns a line of backtrace_symbols(), like
+ * <code>./manaserv-game(_ZN8GameState6updateEi+0x2a) [0x4a2b3c]</code>,
+ * into a frame name. Frames without a known symbol are named after their
+ * module and offset, for addr2line.
+ */
+static std::string getFrameName(const char *symbol)
+{
+    std::string line(symbol);
+    std::string name;
+
+    const std::string::size_type open = line.find('(');
+    const std::string::size_type close = line.find(')', open);
+    if (open != std::string::npos && close != std::string::npos)
+    {
+        std::string::size_type end = line.find('+', open);
+        if (end == std::string::npos || end > close)
+            end = close;
+        name = line.substr(open + 1, end - open - 1);
+
+        if (!name.empty())
+        {
+            int status;
+            char *demangled =
+                    abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+            if (status == 0 && demangled)
+                name = demangled;
+            std::free(demangled);
+        }
+        else
+        {
+            std::string module = line.substr(0, open);
+            const std::string::size_type slash = module.rfind('/');
+            if (slash != std::string::npos)
+                module.erase(0, slash + 1);
+            name = module + line.substr(end, close - end);
+        }
+    }
+    else
+    {
+        name = line;
+    }
+
+    // Semicolons separate the frames in the folded format
+    for (std::string::iterator it = name.begin(); it != name.end(); ++it)
+    {
+        if (*it == ';' || *it == '\n')
+            *it = ':';
+    }
+    return name;
+}
+
+#endif // HAVE_PROFILER
+
+static void requestToggle(int)
+{
+    toggleRequested = 1;
+}
+
+void initialize(const std::string &file)
+{
+    defaultFrequency = Configuration::getValue("profile_frequency", 99);
+    outputFile = file;
+
+#ifdef SIGUSR2
+    signal(SIGUSR2, requestToggle);
+#endif
+}
+
+void update()
+{
+    if (!toggleRequested)
+        return;
+    toggleRequested = 0;
+
+    if (isRunning())
+    {
+        stop();
+        if (write())
+            LOG_INFO("Profiler: wrote " << getSampleCount()
+                     << " samples to " << outputFile);
+    }
+    else if (start())
+    {
+        LOG_INFO("Profiler: started.");
+    }
+}
+
+bool start(int frequency)
+{
+#ifdef HAVE_PROFILER
+    if (running)
+        return false;
+
+    if (frequency <= 0)
+        frequency = defaultFrequency > 0 ? defaultFrequency : 99;
+
+    if (!stacks)
+        stacks = new Stack[TABLE_SIZE];
+    for (unsigned i = 0; i < TABLE_SIZE; ++i)
+    {
+        stacks[i].hash.store(0, std::memory_order_relaxed);
+        stacks[i].count.store(0, std::memory_order_relaxed);
+        stacks[i].ready.store(false, std::memory_order_relaxed);
+    }
+    sampleCount = 0;
+    droppedCount = 0;
+
+    // The first call loads the unwinder, which must not happen in the
+    // signal handler
+    void *frame;
+    backtrace(&frame, 1);
+
+    struct sigaction action;
+    action.sa_handler = takeSample;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, 0);
+
+    itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = std::max(1, 1000000 / frequency);
+    timer.it_value = timer.it_interval;
+
+    running = true;
+    if (setitimer(ITIMER_PROF, &timer, 0) != 0)
+    {
+        LOG_ERROR("Profiler: unable to start the timer.");
+        running = false;
+        signal(SIGPROF, SIG_IGN);
+        return false;
+    }
+    return true;
+#else
+    (void) frequency;
+    LOG_WARN("Profiler: not available on this system.");
+    return false;
+#endif
+}
+
+void stop()
+{
+#ifdef HAVE_PROFILER
+    if (!running)
+        return;
+
+    itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 0;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, 0);
+
+    // A signal still pending would otherwise kill the process
+    signal(SIGPROF, SIG_IGN);
+    running = false;
+#endif
+}
+
+bool isRunning()
+{
+    return running;
+}
+
+bool write()
+{
+#ifdef HAVE_PROFILER
+    if (!stacks)
+        return false;
+
+    // Name every address once
+    std::map<void *, std::string> frameNames;
+    for (unsigned i = 0; i < TABLE_SIZE; ++i)
+    {
+        const Stack &stack = stacks[i];
+        if (!stack.ready.load(std::memory_order_acquire))
+            continue;
+        for (unsigned f = 0; f < stack.depth; ++f)
+            frameNames[stack.frames[f]];
+    }
+
+    std::vector<void *> addresses;
+    for (std::map<void *, std::string>::const_iterator it =
+         frameNames.begin(), it_end = frameNames.end(); it != it_end; ++it)
+    {
+        addresses.push_back(it->first);
+    }
+
+    if (!addresses.empty())
+    {
+        char **symbols = backtrace_symbols(&addresses[0], addresses.size());
+        for (unsigned i = 0; i < addresses.size(); ++i)
+            frameNames[addresses[i]] = symbols ? getFrameName(symbols[i])
+                                               : std::string("?");
+        std::free(symbols);
+    }
+
+    // Different return addresses in the same functions fold together
+    std::map<std::string, unsigned> folded;
+    for (unsigned i = 0; i < TABLE_SIZE; ++i)
+    {
+        const Stack &stack = stacks[i];
+        if (!stack.ready.load(std::memory_order_acquire))
+            continue;
+
+        std::string line = stack.phase ? stack.phase : "-";
+        if (stack.script)
+            line += std::string(";") + stack.script;
+        for (unsigned f = stack.depth; f-- > 0;)
+            line += ";" + frameNames[stack.frames[f]];
+
+        folded[line] += stack.count.load(std::memory_order_relaxed);
+    }
+
+    std::ofstream out(outputFile.c_str(), std::ios::trunc);
+    for (std::map<std::string, unsigned>::const_iterator it = folded.begin(),
+         it_end = folded.end(); it != it_end; ++it)
+    {
+        out << it->first << ' ' << it->second << '\n';
+    }
+
+    if (!out)
+    {
+        LOG_ERROR("Profiler: unable to write " << outputFile);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned getSampleCount()
+{
+    return sampleCount;
+}
+
+unsigned getDroppedCount()
+{
+    return droppedCount;
+}
+
+void setPhase(const char *phase)
+{
+    currentPhase = phase;
+}
+
+void setScriptFunction(const char *function)
+{
+    currentScript = function;
+}
+
+const char *getScriptFunction()
+{
+    return currentScript;
+}
+
+const char *intern(const std::string &string)
+{
+    static std::mutex mutex;
+    static std::set<std::string> *strings = new std::set<std::string>;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings->insert(string).first->c_str();
+}
+
+} // namespace Profiler
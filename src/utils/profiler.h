@@ -0,0 +1,104 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2013  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+/**
+ * A sampling profiler, for finding where the CPU time goes on hosts where
+ * no external profiler can be used.
+ *
+ * While it runs, a SIGPROF timer interrupts the process at the given
+ * frequency of CPU time, and the signal handler counts the stack it
+ * interrupted in a fixed-size table, without locking or allocating. The
+ * stacks are tagged with the phase of the tick and the script function
+ * being run by the interrupted thread, when set.
+ *
+ * The counted stacks are written in the folded format read by the flame
+ * graph tools: one line per stack, its frames from the outermost separated
+ * by semicolons, followed by the number of samples.
+ *
+ * Only available on systems with backtrace(), such as glibc and macOS.
+ */
+namespace Profiler
+{
+    /**
+     * Reads the options and sets up SIGUSR2 to toggle the profiler. When
+     * stopped that way, the stacks are written to the given file.
+     */
+    void initialize(const std::string &defaultFile);
+
+    /**
+     * Starts or stops the profiler when requested by SIGUSR2. Meant to be
+     * called from the main loop.
+     */
+    void update();
+
+    /**
+     * Starts sampling, forgetting the stacks counted before.
+     *
+     * @param frequency samples per second of CPU time, or 0 for the
+     *                  configured frequency.
+     * @return false when the profiler is running already or is not
+     *         available.
+     */
+    bool start(int frequency = 0);
+
+    /**
+     * Stops sampling. The counted stacks are kept until the next start.
+     */
+    void stop();
+
+    bool isRunning();
+
+    /**
+     * Writes the counted stacks in the folded format, to the file given
+     * to initialize().
+     *
+     * @return false when the file could not be written.
+     */
+    bool write();
+
+    /**
+     * Returns the number of samples taken since the last start, and the
+     * number of those that did not fit in the table.
+     */
+    unsigned getSampleCount();
+    unsigned getDroppedCount();
+
+    /**
+     * Tags the samples of the calling thread with the given phase or script
+     * function until changed. The strings must live as long as the
+     * program, see intern(). Null clears the tag.
+     */
+    void setPhase(const char *phase);
+    void setScriptFunction(const char *function);
+    const char *getScriptFunction();
+
+    /**
+     * Returns a copy of the given string that is never freed, the same for
+     * equal strings.
+     */
+    const char *intern(const std::string &string);
+}
+
+#endif // PROFILER_H
@@ -89,7 +89,11 @@ namespace utils
      */
     template<typename T> class NameMap
     {
+        typedef std::map<std::string, T> Map;
+
     public:
+        typedef typename Map::const_iterator const_iterator;
+
         NameMap()
             : mDefault()
         {}
@@ -120,9 +124,20 @@ namespace utils
             mMap.clear();
         }
 
-    private:
-        typedef std::map<std::string, T> Map;
+        /**
+         * Iterates the entries, by lower case name.
+         */
+        const_iterator begin() const
+        {
+            return mMap.begin();
+        }
 
+        const_iterator end() const
+        {
+            return mMap.end();
+        }
+
+    private:
         Map mMap;
         const T mDefault;
     };
@@ -19,6 +19,8 @@
  */
 
 #include <algorithm>
+#include <cctype>
+#include <queue>
 
 #include "utils/stringfilter.h"
 
@@ -28,8 +30,34 @@
 namespace utils
 {
 
+/**
+ * Case folds a byte, optionally reading common leetspeak substitutes as the
+ * letters they stand for.
+ */
+static unsigned char foldByte(unsigned char c, bool leetspeak)
+{
+    if (leetspeak)
+    {
+        switch (c)
+        {
+            case '0': return 'O';
+            case '1': case '!': case '|': return 'I';
+            case '3': return 'E';
+            case '4': case '@': return 'A';
+            case '5': case '$': return 'S';
+            case '7': case '+': return 'T';
+            case '8': return 'B';
+            default: break;
+        }
+    }
+    return std::toupper(c);
+}
+
 StringFilter::StringFilter():
-    mInitialized(false)
+    mInitialized(false),
+    mWholeWords(false),
+    mLeetspeak(false),
+    mSymbolCount(0)
 {
     loadSlangFilterList();
 }
@@ -42,6 +70,10 @@ StringFilter::~StringFilter()
 bool StringFilter::loadSlangFilterList()
 {
     mInitialized = false;
+    mSlangs.clear();
+
+    mWholeWords = Configuration::getBoolValue("SlangsWholeWords", false);
+    mLeetspeak = Configuration::getBoolValue("SlangsLeetspeak", false);
 
     const std::string slangsList = Configuration::getValue("SlangsList",
                                                            std::string());
@@ -49,10 +81,13 @@ bool StringFilter::loadSlangFilterList()
         std::istringstream iss(slangsList);
         std::string tmp;
         while (getline(iss, tmp, ','))
-            mSlangs.push_back(tmp);
-        mInitialized = true;
+            if (!tmp.empty())
+                mSlangs.push_back(tmp);
+        mInitialized = !mSlangs.empty();
     }
 
+    buildMatcher();
+
     return mInitialized;
 }
 
@@ -69,6 +104,108 @@ void StringFilter::writeSlangFilterList()
     //mConfig->setValue("SlangsList", slangsList);
 }
 
+void StringFilter::buildMatcher()
+{
+    // Give a symbol to each folded byte used by a slang
+    unsigned char folded[256];
+    unsigned char symbolOfFolded[256];
+    std::fill(symbolOfFolded, symbolOfFolded + 256, 0);
+    mSymbolCount = 1;
+
+    for (int c = 0; c < 256; ++c)
+        folded[c] = foldByte(c, mLeetspeak);
+
+    for (Slangs::const_iterator i = mSlangs.begin(); i != mSlangs.end(); ++i)
+    {
+        for (std::string::const_iterator c = i->begin(); c != i->end(); ++c)
+        {
+            unsigned char f = folded[(unsigned char) *c];
+            if (!symbolOfFolded[f])
+                symbolOfFolded[f] = mSymbolCount++;
+        }
+    }
+
+    for (int c = 0; c < 256; ++c)
+        mSymbols[c] = symbolOfFolded[folded[c]];
+
+    // Build the trie, node 0 being the root
+    mTransitions.assign(mSymbolCount, -1);
+    mMatchLengths.assign(1, 0);
+
+    for (Slangs::const_iterator i = mSlangs.begin(); i != mSlangs.end(); ++i)
+    {
+        int node = 0;
+        for (std::string::const_iterator c = i->begin(); c != i->end(); ++c)
+        {
+            int &next = mTransitions[node * mSymbolCount +
+                                     mSymbols[(unsigned char) *c]];
+            if (next == -1)
+            {
+                next = mMatchLengths.size();
+                mMatchLengths.push_back(0);
+                mTransitions.resize(mTransitions.size() + mSymbolCount, -1);
+            }
+            // The resize may have moved the table, read it again
+            node = mTransitions[node * mSymbolCount +
+                                mSymbols[(unsigned char) *c]];
+        }
+        mMatchLengths[node] = i->size();
+    }
+
+    // Compute the failure links breadth first, and turn missing trie edges
+    // into the transition the failure link would take.
+    const unsigned nodeCount = mMatchLengths.size();
+    std::vector<int> failure(nodeCount, 0);
+    mMatchLinks.assign(nodeCount, -1);
+
+    std::queue<int> pending;
+    for (unsigned symbol = 0; symbol < mSymbolCount; ++symbol)
+    {
+        int &next = mTransitions[symbol];
+        if (next == -1)
+            next = 0;
+        else
+            pending.push(next);
+    }
+
+    while (!pending.empty())
+    {
+        const int node = pending.front();
+        pending.pop();
+
+        const int fallback = failure[node];
+        mMatchLinks[node] = mMatchLengths[fallback] ? fallback
+                                                    : mMatchLinks[fallback];
+
+        for (unsigned symbol = 0; symbol < mSymbolCount; ++symbol)
+        {
+            int &next = mTransitions[node * mSymbolCount + symbol];
+            const int fallbackNext = mTransitions[fallback * mSymbolCount +
+                                                  symbol];
+            if (next == -1)
+            {
+                next = fallbackNext;
+            }
+            else
+            {
+                failure[next] = fallbackNext;
+                pending.push(next);
+            }
+        }
+    }
+}
+
+bool StringFilter::isWholeWord(const std::string &text,
+                               size_t end, unsigned length)
+{
+    const size_t start = end + 1 - length;
+    if (start > 0 && std::isalnum((unsigned char) text[start - 1]))
+        return false;
+    if (end + 1 < text.size() && std::isalnum((unsigned char) text[end + 1]))
+        return false;
+    return true;
+}
+
 bool StringFilter::filterContent(const std::string &text) const
 {
     if (!mInitialized) {
@@ -76,26 +213,23 @@ bool StringFilter::filterContent(const std::string &text) const
         return true;
     }
 
-    bool isContentClean = true;
-    std::string upperCaseText = text;
-
-    std::transform(text.begin(), text.end(), upperCaseText.begin(),
-            (int(*)(int))std::toupper);
-
-    for (Slangs::const_iterator i = mSlangs.begin(); i != mSlangs.end(); ++i)
+    int node = 0;
+    for (size_t i = 0; i < text.size(); ++i)
     {
-        // We look for slangs into the sentence.
-        std::string upperCaseSlang = *i;
-        std::transform(upperCaseSlang.begin(), upperCaseSlang.end(),
-                upperCaseSlang.begin(), (int(*)(int))std::toupper);
-
-        if (upperCaseText.compare(upperCaseSlang)) {
-            isContentClean = false;
-            break;
+        node = mTransitions[node * mSymbolCount +
+                            mSymbols[(unsigned char) text[i]]];
+
+        // Walk the slangs that end here, longest first
+        int match = mMatchLengths[node] ? node : mMatchLinks[node];
+        while (match != -1)
+        {
+            if (!mWholeWords || isWholeWord(text, i, mMatchLengths[match]))
+                return false;
+            match = mMatchLinks[match];
         }
     }
 
-    return isContentClean;
+    return true;
 }
 
 bool StringFilter::isEmailValid(const std::string &email) const
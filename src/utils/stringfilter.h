@@ -23,6 +23,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 namespace utils
 {
@@ -54,6 +55,7 @@ class StringFilter
 
         /**
         * Useful to filter slangs automatically, by instance.
+        * The text is scanned once, whatever the size of the slang list.
         * @return true if the sentence is slangs clear.
         */
         bool filterContent(const std::string &text) const;
@@ -71,10 +73,35 @@ class StringFilter
         bool findDoubleQuotes(const std::string &text) const;
 
     private:
+        /**
+         * Compiles the slang list into an Aho-Corasick automaton.
+         */
+        void buildMatcher();
+
+        /**
+         * Returns whether a slang of the given length that ends at \a end
+         * stands on its own in the text.
+         */
+        static bool isWholeWord(const std::string &text,
+                                size_t end, unsigned length);
+
         typedef std::list<std::string> Slangs;
         typedef Slangs::iterator SlangIterator;
         Slangs mSlangs;    /**< the formatted Slangs list */
         bool mInitialized;                 /**< Set if the list is loaded */
+        bool mWholeWords;   /**< Only match slangs that are whole words */
+        bool mLeetspeak;    /**< Read digits and symbols as letters */
+
+        /**
+         * The automaton. Bytes are case folded (and leetspeak normalized)
+         * into symbols, bytes that appear in no slang share symbol 0. The
+         * transition table is complete, so scanning a byte is one lookup.
+         */
+        unsigned char mSymbols[256];
+        unsigned mSymbolCount;
+        std::vector<int> mTransitions;  /**< node * mSymbolCount + symbol */
+        std::vector<unsigned> mMatchLengths; /**< slang ending at node, or 0 */
+        std::vector<int> mMatchLinks;   /**< next node with a match, or -1 */
 };
 
 } // ::utils
@@ -20,105 +20,296 @@
 
 #include "utils/tokencollector.h"
 
-/* We are optimistic and we assume that clients connect as soon as possible.
-   It means that pending data are mainly outdated ones, except for the newer
-   ones. So we search the lists backward (from newer to older) for already
-   inserted data. On the contrary, data are removed when there was a network
-   failure, especially a timeout. So we search the lists forward when removing
-   data, in order to start from the older ones. */
+#include <algorithm>
+#include <functional>
 
-void TokenCollectorBase::insertClient(const std::string &token, intptr_t data)
+/* Values of the hash table buckets that do not hold an item. A removed item
+   leaves a tombstone behind, so that probing continues past it. */
+static const int EMPTY = -1;
+static const int DELETED = -2;
+
+static size_t mixBits(size_t h)
+{
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+static size_t tokenHash(const std::string &token, bool isClient)
+{
+    return std::hash<std::string>()(token) * 2 + (isClient ? 1 : 0);
+}
+
+static size_t dataHash(intptr_t data)
+{
+    return mixBits((size_t) data);
+}
+
+template< class Matches >
+int TokenCollectorBase::find(const Index &index, size_t hash,
+                             Matches matches) const
 {
-    for (std::list<Item>::reverse_iterator it = mPendingConnects.rbegin(),
-         it_end = mPendingConnects.rend(); it != it_end; ++it)
+    if (index.buckets.empty())
+        return -1;
+
+    // The table is never more than half full, so probing always ends on an
+    // empty bucket.
+    const size_t mask = index.buckets.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask)
     {
-        if (it->token == token)
-        {
-            foundMatch(data, it->data);
-            mPendingConnects.erase(--it.base());
-            return;
-        }
+        const int item = index.buckets[pos];
+        if (item == EMPTY)
+            return -1;
+        if (item != DELETED && matches(mItems[item]))
+            return pos;
     }
+}
 
-    time_t current = time(nullptr);
+size_t TokenCollectorBase::hashOf(const Index &index, int item) const
+{
+    const Item &i = mItems[item];
+    return &index == &mTokens ? tokenHash(i.token, i.isClient)
+                              : dataHash(i.data);
+}
+
+void TokenCollectorBase::rehash(Index &index)
+{
+    std::vector<int> items;
+    for (std::vector<int>::const_iterator it = index.buckets.begin(),
+         it_end = index.buckets.end(); it != it_end; ++it)
+    {
+        if (*it >= 0)
+            items.push_back(*it);
+    }
+
+    size_t size = 16;
+    while (size < (items.size() + 1) * 4)
+        size *= 2;
+
+    index.buckets.assign(size, EMPTY);
+    index.used = 0;
+
+    for (std::vector<int>::const_iterator it = items.begin(),
+         it_end = items.end(); it != it_end; ++it)
+    {
+        insertInIndex(index, hashOf(index, *it), *it);
+    }
+}
+
+void TokenCollectorBase::insertInIndex(Index &index, size_t hash, int item)
+{
+    if ((index.used + 1) * 2 > index.buckets.size())
+        rehash(index);
+
+    const size_t mask = index.buckets.size() - 1;
+    size_t pos = hash & mask;
+    while (index.buckets[pos] >= 0)
+        pos = (pos + 1) & mask;
+
+    if (index.buckets[pos] == EMPTY)
+        ++index.used;
+    index.buckets[pos] = item;
+}
+
+void TokenCollectorBase::removeFromIndex(Index &index, size_t hash, int item)
+{
+    const size_t mask = index.buckets.size() - 1;
+    size_t pos = hash & mask;
+    while (index.buckets[pos] != item)
+        pos = (pos + 1) & mask;
+
+    index.buckets[pos] = DELETED;
+}
+
+int TokenCollectorBase::findToken(const std::string &token,
+                                  bool isClient) const
+{
+    int pos = find(mTokens, tokenHash(token, isClient),
+                   [&](const Item &item) {
+                       return item.isClient == isClient && item.token == token;
+                   });
+    return pos == -1 ? -1 : mTokens.buckets[pos];
+}
+
+int TokenCollectorBase::findClient(intptr_t data) const
+{
+    int pos = find(mClients, dataHash(data),
+                   [&](const Item &item) { return item.data == data; });
+    return pos == -1 ? -1 : mClients.buckets[pos];
+}
+
+int TokenCollectorBase::addItem(const std::string &token, intptr_t data,
+                                bool isClient, time_t timeStamp)
+{
+    int index;
+    if (mFreeItems.empty())
+    {
+        index = mItems.size();
+        mItems.push_back(Item());
+    }
+    else
+    {
+        index = mFreeItems.back();
+        mFreeItems.pop_back();
+    }
 
-    Item item;
+    Item &item = mItems[index];
     item.token = token;
     item.data = data;
-    item.timeStamp = current;
-    mPendingClients.push_back(item);
+    item.timeStamp = timeStamp;
+    item.isClient = isClient;
+
+    // Append to the wheel bucket of its second, keeping buckets sorted by age
+    Bucket &bucket = mWheel[timeStamp & (WHEEL_SIZE - 1)];
+    item.previous = bucket.last;
+    item.next = -1;
+    if (bucket.last != -1)
+        mItems[bucket.last].next = index;
+    else
+        bucket.first = index;
+    bucket.last = index;
+
+    insertInIndex(mTokens, tokenHash(token, isClient), index);
+    if (isClient)
+        insertInIndex(mClients, dataHash(data), index);
+
+    return index;
+}
+
+void TokenCollectorBase::removeItem(int index)
+{
+    Item &item = mItems[index];
+
+    removeFromIndex(mTokens, tokenHash(item.token, item.isClient), index);
+    if (item.isClient)
+        removeFromIndex(mClients, dataHash(item.data), index);
+
+    Bucket &bucket = mWheel[item.timeStamp & (WHEEL_SIZE - 1)];
+    if (item.previous != -1)
+        mItems[item.previous].next = item.next;
+    else
+        bucket.first = item.next;
+    if (item.next != -1)
+        mItems[item.next].previous = item.previous;
+    else
+        bucket.last = item.previous;
+
+    item.token.clear();
+    mFreeItems.push_back(index);
+}
+
+/* Items are removed from the collector before the handler is called, so that
+   the handler may safely use the collector again. */
+
+void TokenCollectorBase::insertClient(const std::string &token, intptr_t data)
+{
+    int connect = findToken(token, false);
+    if (connect != -1)
+    {
+        intptr_t connectData = mItems[connect].data;
+        removeItem(connect);
+        foundMatch(data, connectData);
+        return;
+    }
+
+    time_t current = time(nullptr);
+
+    // A client sending a token again only keeps the last one
+    int previous = findClient(data);
+    if (previous != -1)
+        removeItem(previous);
+
+    // An older client waiting with the same token is given up on
+    int other = findToken(token, true);
+    if (other != -1)
+    {
+        intptr_t otherData = mItems[other].data;
+        removeItem(other);
+        removedClient(otherData);
+    }
+
+    addItem(token, data, true, current);
 
     removeOutdated(current);
 }
 
 void TokenCollectorBase::insertConnect(const std::string &token, intptr_t data)
 {
-    for (std::list<Item>::reverse_iterator it = mPendingClients.rbegin(),
-         it_end = mPendingClients.rend(); it != it_end; ++it)
+    int client = findToken(token, true);
+    if (client != -1)
     {
-        if (it->token == token)
-        {
-            foundMatch(it->data, data);
-            mPendingClients.erase(--it.base());
-            return;
-        }
+        intptr_t clientData = mItems[client].data;
+        removeItem(client);
+        foundMatch(clientData, data);
+        return;
     }
 
     time_t current = time(nullptr);
 
-    Item item;
-    item.token = token;
-    item.data = data;
-    item.timeStamp = current;
-    mPendingConnects.push_back(item);
+    // Older data waiting with the same token are given up on
+    int other = findToken(token, false);
+    if (other != -1)
+    {
+        intptr_t otherData = mItems[other].data;
+        removeItem(other);
+        removedConnect(otherData);
+    }
+
+    addItem(token, data, false, current);
 
     removeOutdated(current);
 }
 
 void TokenCollectorBase::removeClient(intptr_t data)
 {
-    for (std::list<Item>::iterator it = mPendingClients.begin(),
-         it_end = mPendingClients.end(); it != it_end; ++it)
-    {
-        if (it->data == data)
-        {
-            mPendingClients.erase(it);
-            return;
-        }
-    }
+    int client = findClient(data);
+    if (client != -1)
+        removeItem(client);
 }
 
 void TokenCollectorBase::removeOutdated(time_t current)
 {
-    // Timeout happens after 30 seconds. Much longer may actually pass, though.
-    time_t threshold = current - 30;
-    if (threshold < mLastCheck) return;
+    time_t threshold = current - TIMEOUT;
+    if (threshold <= mLastCheck)
+        return;
 
-    std::list<Item>::iterator it;
+    // Visit the buckets of the seconds elapsed since the last check, all of
+    // them when a whole turn of the wheel has passed.
+    const time_t from = mLastCheck;
+    const time_t seconds = std::min<time_t>(threshold - from, WHEEL_SIZE);
+    mLastCheck = threshold;
 
-    it = mPendingConnects.begin();
-    while (it != mPendingConnects.end() && it->timeStamp < threshold)
+    for (time_t second = from; second < from + seconds; ++second)
     {
-        removedConnect(it->data);
-        it = mPendingConnects.erase(it);
-    }
+        Bucket &bucket = mWheel[second & (WHEEL_SIZE - 1)];
+        while (bucket.first != -1 &&
+               mItems[bucket.first].timeStamp < threshold)
+        {
+            const Item &item = mItems[bucket.first];
+            const intptr_t data = item.data;
+            const bool isClient = item.isClient;
+            removeItem(bucket.first);
 
-    it = mPendingClients.begin();
-    while (it != mPendingClients.end() && it->timeStamp < threshold)
-    {
-        removedClient(it->data);
-        it = mPendingClients.erase(it);
+            if (isClient)
+                removedClient(data);
+            else
+                removedConnect(data);
+        }
     }
-
-    mLastCheck = current;
 }
 
 TokenCollectorBase::TokenCollectorBase():
     mLastCheck(time(nullptr))
 {
+    for (int i = 0; i < WHEEL_SIZE; ++i)
+    {
+        mWheel[i].first = -1;
+        mWheel[i].last = -1;
+    }
 }
 
 TokenCollectorBase::~TokenCollectorBase()
 {
-    // Not declared inline, as the list destructors are not trivial.
+    // Not declared inline, as the container destructors are not trivial.
 }
@@ -23,11 +23,16 @@
 
 #include <stdint.h>
 #include <string>
-#include <list>
+#include <vector>
 #include <time.h>
 
 /**
  * Base class containing the generic implementation of TokenCollector.
+ *
+ * Pending items live in a pool and are found through open addressing hash
+ * tables, by token and, for clients, by user data. Expiry uses a wheel of
+ * one second buckets, so matching, removing and expiring items cost the
+ * same whatever the number of pending items.
  */
 class TokenCollectorBase
 {
@@ -36,25 +41,64 @@ class TokenCollectorBase
             std::string token; /**< Cookie used by the client. */
             intptr_t data;     /**< User data. */
             time_t timeStamp;  /**< Creation time. */
+            bool isClient;     /**< Pending client, or pending connect. */
+            int previous;      /**< Previous item in the wheel bucket. */
+            int next;          /**< Next item in the wheel bucket. */
         };
 
         /**
-         * List containing client already connected. Newer clients are at the
-         * back of the list.
+         * An open addressing hash table of item indices, with linear probing.
          */
-        std::list<Item> mPendingClients;
+        struct Index
+        {
+            Index(): used(0) {}
+
+            std::vector<int> buckets;
+            unsigned used;      /**< Buckets holding an item or a tombstone */
+        };
+
+        struct Bucket
+        {
+            int first;
+            int last;
+        };
 
         /**
-         * List containing server data waiting for clients. Newer data are at
-         * the back of the list.
+         * Seconds after which pending items are dropped. Much longer may
+         * actually pass, as outdated items are only looked for on insertion.
          */
-        std::list<Item> mPendingConnects;
+        static const int TIMEOUT = 30;
 
         /**
-         * Time at which the TokenCollector performed its last check.
+         * Number of buckets in the expiry wheel, a power of two larger than
+         * the timeout.
+         */
+        static const int WHEEL_SIZE = 64;
+
+        std::vector<Item> mItems;       /**< Pool of items. */
+        std::vector<int> mFreeItems;    /**< Unused entries of the pool. */
+        Index mTokens;                  /**< Items by token and kind. */
+        Index mClients;                 /**< Pending clients by data. */
+        Bucket mWheel[WHEEL_SIZE];      /**< Items by creation second. */
+
+        /**
+         * Items created before this time have been removed.
          */
         time_t mLastCheck;
 
+        int findToken(const std::string &token, bool isClient) const;
+        int findClient(intptr_t data) const;
+        int addItem(const std::string &token, intptr_t data,
+                    bool isClient, time_t timeStamp);
+        void removeItem(int item);
+
+        template< class Matches >
+        int find(const Index &index, size_t hash, Matches matches) const;
+        void insertInIndex(Index &index, size_t hash, int item);
+        void removeFromIndex(Index &index, size_t hash, int item);
+        void rehash(Index &index);
+        size_t hashOf(const Index &index, int item) const;
+
     protected:
 
         virtual void removedClient(intptr_t) = 0;
@@ -85,7 +129,9 @@ template< class T > struct _TC_CheckData< T * > {};
  *  - tokenMatched(Client, ServerData).
  *
  * The delete members will be called whenever the collector considers that a
- * token has become obsolete and it is about to remove it.
+ * token has become obsolete and it is about to remove it. This also happens
+ * when a token is registered again on the same side before being matched,
+ * for the older registration.
  */
 template< class Handler, class Client, class ServerData >
 class TokenCollector: private TokenCollectorBase
@@ -30,7 +30,7 @@ static void logZlibError(int error)
     switch (error)
     {
         case Z_MEM_ERROR:
-            LOG_ERROR("Out of memory while decompressing data!");
+            LOG_ERROR("Out of memory while (de)compressing data!");
             break;
         case Z_VERSION_ERROR:
             LOG_ERROR("Incompatible zlib version!");
@@ -39,7 +39,7 @@ static void logZlibError(int error)
             LOG_ERROR("Incorrect zlib compressed data!");
             break;
         default:
-            LOG_ERROR("Unknown error while decompressing data!");
+            LOG_ERROR("Unknown error while (de)compressing data!");
     }
 }
 
@@ -115,3 +115,28 @@ bool inflateMemory(char *in, unsigned inLength,
     inflateEnd(&strm);
     return true;
 }
+
+bool deflateMemory(const char *in, unsigned inLength,
+                   char *&out, unsigned &outLength)
+{
+    uLongf bufferSize = compressBound(inLength);
+    out = (char *)malloc(bufferSize);
+    if (!out)
+    {
+        logZlibError(Z_MEM_ERROR);
+        return false;
+    }
+
+    // Favor speed, this is used on data sent while the server runs
+    int ret = compress2((Bytef *)out, &bufferSize,
+                        (const Bytef *)in, inLength, Z_BEST_SPEED);
+    if (ret != Z_OK)
+    {
+        logZlibError(ret);
+        free(out);
+        return false;
+    }
+
+    outLength = bufferSize;
+    return true;
+}
@@ -29,4 +29,11 @@
 bool inflateMemory(char *in, unsigned inLength,
                    char *&out, unsigned &outLength);
 
+/**
+ * Deflates memory in the zlib format. The deflated memory is expected to be
+ * freed by the caller. Returns true if the deflation was sucessful.
+ */
+bool deflateMemory(const char *in, unsigned inLength,
+                   char *&out, unsigned &outLength);
+
 #endif
@@ -0,0 +1,226 @@
+/**
+ * Compares the character save and load throughput of the SQLite defaults
+ * with the settings the account server uses (see sqlite_journalMode and the
+ * following options in docs/manaserv.xml.example).
+ *
+ * Build:  g++ -O2 -o sqlitebench main.cpp -lsqlite3
+ * Usage:  sqlitebench <createTables.sql> [characters] [rounds]
+ *
+ * Each save is one transaction updating the character row, its attributes
+ * and its inventory, like Storage::updateCharacter. Each load runs the
+ * queries of Storage::getCharacter for the character, its attributes and its
+ * inventory.
+ */
+
+#include <sqlite3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static const int ATTRIBUTES = 20;
+static const int ITEMS = 15;
+
+static void check(sqlite3 *db, int result, const char *what)
+{
+    if (result != SQLITE_OK && result != SQLITE_DONE && result != SQLITE_ROW)
+    {
+        std::fprintf(stderr, "%s: %s\n", what, sqlite3_errmsg(db));
+        std::exit(1);
+    }
+}
+
+static void exec(sqlite3 *db, const std::string &sql)
+{
+    char *error = 0;
+    if (sqlite3_exec(db, sql.c_str(), 0, 0, &error) != SQLITE_OK)
+    {
+        std::fprintf(stderr, "%s: %s\n", sql.c_str(), error);
+        std::exit(1);
+    }
+}
+
+static sqlite3_stmt *prepare(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    check(db, sqlite3_prepare_v2(db, sql, -1, &stmt, 0), sql);
+    return stmt;
+}
+
+static void run(sqlite3_stmt *stmt)
+{
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        ;
+    sqlite3_reset(stmt);
+}
+
+struct Profile
+{
+    const char *name;
+    const char *pragmas;
+};
+
+static const Profile profiles[] =
+{
+    { "default (rollback journal, synchronous FULL)",
+      "PRAGMA journal_mode = DELETE; PRAGMA synchronous = FULL;" },
+    { "tuned (WAL, synchronous NORMAL, 8 MiB cache, 64 MiB mmap)",
+      "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;"
+      "PRAGMA cache_size = -8192; PRAGMA mmap_size = 67108864;" },
+};
+
+static void bench(const Profile &profile, const std::string &schema,
+                  int characters, int rounds)
+{
+    const char *file = "sqlitebench.db";
+    std::remove(file);
+    std::remove("sqlitebench.db-wal");
+    std::remove("sqlitebench.db-shm");
+
+    sqlite3 *db;
+    check(db, sqlite3_open(file, &db), "open");
+    exec(db, profile.pragmas);
+    exec(db, schema);
+
+    // Fill in the characters to save and load
+    exec(db, "BEGIN");
+    exec(db, "INSERT INTO mana_accounts VALUES "
+             "(1, 'bench', 'x', 'x', 1, 0, 0, 0, NULL, NULL)");
+    for (int id = 1; id <= characters; ++id)
+    {
+        std::ostringstream sql;
+        sql << "INSERT INTO mana_characters VALUES (" << id << ", 1, 'char"
+            << id << "', 0, 0, 0, 0, 0, 0, 0, 1, " << id << ");";
+        for (int attr = 1; attr <= ATTRIBUTES; ++attr)
+            sql << "INSERT INTO mana_char_attr VALUES (" << id << ", "
+                << attr << ", 10, 10);";
+        for (int slot = 0; slot < ITEMS; ++slot)
+            sql << "INSERT INTO mana_inventories VALUES (NULL, " << id << ", "
+                << slot << ", 1, 1, 0);";
+        exec(db, sql.str());
+    }
+    exec(db, "COMMIT");
+
+    sqlite3_stmt *updateChar = prepare(db,
+        "UPDATE mana_characters SET gender = ?, hair_style = ?, "
+        "hair_color = ?, char_pts = ?, correct_pts = ?, x = ?, y = ?, "
+        "map_id = ?, slot = ? WHERE id = ?");
+    sqlite3_stmt *updateAttr = prepare(db,
+        "UPDATE mana_char_attr SET attr_base = ?, attr_mod = ? "
+        "WHERE char_id = ? AND attr_id = ?");
+    sqlite3_stmt *deleteItems = prepare(db,
+        "DELETE FROM mana_inventories WHERE owner_id = ?");
+    sqlite3_stmt *insertItem = prepare(db,
+        "INSERT INTO mana_inventories VALUES (NULL, ?, ?, ?, ?, ?)");
+    sqlite3_stmt *selectChar = prepare(db,
+        "SELECT * FROM mana_characters WHERE id = ?");
+    sqlite3_stmt *selectAttrs = prepare(db,
+        "SELECT attr_id, attr_base, attr_mod FROM mana_char_attr "
+        "WHERE char_id = ?");
+    sqlite3_stmt *selectItems = prepare(db,
+        "SELECT id, owner_id, slot, class_id, amount, equipped "
+        "FROM mana_inventories WHERE owner_id = ? ORDER BY slot ASC");
+
+    typedef std::chrono::steady_clock Clock;
+
+    const Clock::time_point saveStart = Clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int id = 1; id <= characters; ++id)
+        {
+            exec(db, "BEGIN");
+
+            for (int col = 1; col <= 9; ++col)
+                sqlite3_bind_int(updateChar, col, round + col);
+            sqlite3_bind_int(updateChar, 10, id);
+            run(updateChar);
+
+            for (int attr = 1; attr <= ATTRIBUTES; ++attr)
+            {
+                sqlite3_bind_double(updateAttr, 1, round + attr);
+                sqlite3_bind_double(updateAttr, 2, round + attr * 1.5);
+                sqlite3_bind_int(updateAttr, 3, id);
+                sqlite3_bind_int(updateAttr, 4, attr);
+                run(updateAttr);
+            }
+
+            sqlite3_bind_int(deleteItems, 1, id);
+            run(deleteItems);
+            for (int slot = 0; slot < ITEMS; ++slot)
+            {
+                sqlite3_bind_int(insertItem, 1, id);
+                sqlite3_bind_int(insertItem, 2, slot);
+                sqlite3_bind_int(insertItem, 3, round + 1);
+                sqlite3_bind_int(insertItem, 4, 1);
+                sqlite3_bind_int(insertItem, 5, 0);
+                run(insertItem);
+            }
+
+            exec(db, "COMMIT");
+        }
+    }
+    const double saveTime =
+            std::chrono::duration<double>(Clock::now() - saveStart).count();
+
+    const Clock::time_point loadStart = Clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int id = 1; id <= characters; ++id)
+        {
+            sqlite3_bind_int(selectChar, 1, id);
+            run(selectChar);
+            sqlite3_bind_int(selectAttrs, 1, id);
+            run(selectAttrs);
+            sqlite3_bind_int(selectItems, 1, id);
+            run(selectItems);
+        }
+    }
+    const double loadTime =
+            std::chrono::duration<double>(Clock::now() - loadStart).count();
+
+    const int total = characters * rounds;
+    std::printf("%s\n  saves: %8.0f/s\n  loads: %8.0f/s\n", profile.name,
+                total / saveTime, total / loadTime);
+
+    sqlite3_finalize(updateChar);
+    sqlite3_finalize(updateAttr);
+    sqlite3_finalize(deleteItems);
+    sqlite3_finalize(insertItem);
+    sqlite3_finalize(selectChar);
+    sqlite3_finalize(selectAttrs);
+    sqlite3_finalize(selectItems);
+    sqlite3_close(db);
+
+    std::remove(file);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s <createTables.sql> [characters] [rounds]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file)
+    {
+        std::fprintf(stderr, "Unable to read %s\n", argv[1]);
+        return 1;
+    }
+    std::ostringstream schema;
+    schema << file.rdbuf();
+
+    const int characters = argc > 2 ? std::atoi(argv[2]) : 200;
+    const int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    for (unsigned i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i)
+        bench(profiles[i], schema.str(), characters, rounds);
+
+    return 0;
+}